@@ -0,0 +1,119 @@
+#include "buffer_pool.h"
+
+#include <cstring>
+
+using namespace godot;
+
+void BufferPool::set_device(RenderingDevice* device) {
+    m_device = device;
+}
+
+int64_t BufferPool::get_bucket_capacity(int64_t size) {
+    if (size <= MIN_CAPACITY) {
+        return MIN_CAPACITY;
+    }
+
+    int64_t power = MIN_CAPACITY;
+
+    while (power * 2 <= size) {
+        power *= 2;
+    }
+
+    const int64_t step = power / SIZE_CLASS_STEPS;
+
+    return (size + step - 1) / step * step;
+}
+
+RID BufferPool::acquire_storage(const PackedByteArray& data, uint64_t usage) {
+    return acquire(data, Bucket { get_bucket_capacity(data.size()), usage, false });
+}
+
+RID BufferPool::acquire_uniform(const PackedByteArray& data) {
+    return acquire(data, Bucket { get_bucket_capacity(data.size()), 0, true });
+}
+
+RID BufferPool::acquire(const PackedByteArray& data, const Bucket& bucket) {
+    RID buffer;
+
+    for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+        if (it->bucket == bucket) {
+            buffer = it->buffer;
+            m_idle.erase(it);
+            m_idle_bytes -= bucket.capacity;
+            break;
+        }
+    }
+
+    if (buffer.is_valid()) {
+        if (!data.is_empty()) {
+            m_device->buffer_update(buffer, 0, data.size(), data);
+        }
+    } else {
+        // The padding is zeroed once, reused buffers keep whatever the last owner left there.
+        PackedByteArray bytes;
+        bytes.resize(bucket.capacity);
+        bytes.fill(0);
+
+        if (!data.is_empty()) {
+            std::memcpy(bytes.ptrw(), data.ptr(), data.size());
+        }
+
+        buffer = bucket.uniform
+            ? m_device->uniform_buffer_create(bytes.size(), bytes, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT)
+            : m_device->storage_buffer_create(bytes.size(), bytes, bucket.usage, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
+
+        m_allocated_bytes += bucket.capacity;
+    }
+
+    m_in_use[buffer.get_id()] = PooledBuffer { bucket, buffer };
+
+    return buffer;
+}
+
+void BufferPool::release(const RID& buffer) {
+    const auto it = m_in_use.find(buffer.get_id());
+    ERR_FAIL_COND_MSG(it == m_in_use.end(), "Buffer was not acquired from this pool.");
+
+    m_idle.push_back(it->second);
+    m_idle_bytes += it->second.bucket.capacity;
+    m_in_use.erase(it);
+
+    trim();
+}
+
+void BufferPool::trim() {
+    size_t evicted = 0;
+
+    while (m_idle_bytes > MAX_IDLE_BYTES && evicted < m_idle.size()) {
+        const PooledBuffer& idle = m_idle[evicted++];
+
+        m_device->free_rid(idle.buffer);
+        m_idle_bytes -= idle.bucket.capacity;
+        m_allocated_bytes -= idle.bucket.capacity;
+    }
+
+    m_idle.erase(m_idle.begin(), m_idle.begin() + static_cast<std::ptrdiff_t>(evicted));
+}
+
+void BufferPool::take_all(Array& buffers) {
+    for (const PooledBuffer& idle : m_idle) {
+        buffers.push_back(idle.buffer);
+    }
+
+    for (const auto& [id, used] : m_in_use) {
+        buffers.push_back(used.buffer);
+    }
+
+    m_idle.clear();
+    m_in_use.clear();
+    m_allocated_bytes = 0;
+    m_idle_bytes = 0;
+}
+
+int64_t BufferPool::get_allocated_bytes() const {
+    return m_allocated_bytes;
+}
+
+int64_t BufferPool::get_idle_bytes() const {
+    return m_idle_bytes;
+}
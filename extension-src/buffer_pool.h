@@ -0,0 +1,79 @@
+#pragma once
+
+#include <godot_cpp/classes/rendering_device.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+// Recycles storage and uniform buffers of a rendering device. Buffers are created with a capacity rounded up to a
+// size class and handed back to the pool instead of being freed, so a later request of the same bucket, for
+// example after switching the field back to a resolution it had before, gets an existing buffer filled with
+// buffer_update() instead of a new allocation. Idle buffers are freed oldest first once they exceed
+// MAX_IDLE_BYTES.
+//
+// Each power of two from MIN_CAPACITY up is split into SIZE_CLASS_STEPS classes, so a buffer is at most a quarter
+// larger than requested. Field-sized buffers would waste up to half their size with power-of-two classes.
+//
+// Only used on the render thread.
+class BufferPool {
+public:
+    static constexpr int64_t MIN_CAPACITY = 256;
+    static constexpr int64_t SIZE_CLASS_STEPS = 4;
+    static constexpr int64_t MAX_IDLE_BYTES = 256 * 1024 * 1024;
+
+    BufferPool() = default;
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    void set_device(RenderingDevice* device);
+
+    // A storage buffer whose first data.size() bytes hold data. Bytes past that are undefined.
+    [[nodiscard]] RID acquire_storage(const PackedByteArray& data, uint64_t usage = 0);
+    [[nodiscard]] RID acquire_uniform(const PackedByteArray& data);
+
+    // Hands a buffer back. The caller frees the uniform sets that use it, the pool keeps the buffer alive.
+    void release(const RID& buffer);
+
+    // Every buffer of the pool, idle or in use, for freeing once the device is done with them. Leaves the pool empty.
+    void take_all(Array& buffers);
+
+    [[nodiscard]] int64_t get_allocated_bytes() const;
+    [[nodiscard]] int64_t get_idle_bytes() const;
+
+    [[nodiscard]] static int64_t get_bucket_capacity(int64_t size);
+
+private:
+    struct Bucket {
+        int64_t capacity { 0 };
+        uint64_t usage { 0 };
+        bool uniform { false };
+
+        bool operator==(const Bucket& other) const {
+            return capacity == other.capacity && usage == other.usage && uniform == other.uniform;
+        }
+    };
+
+    struct PooledBuffer {
+        Bucket bucket;
+        RID buffer;
+    };
+
+    [[nodiscard]] RID acquire(const PackedByteArray& data, const Bucket& bucket);
+    void trim();
+
+    RenderingDevice* m_device { nullptr };
+
+    // Oldest first.
+    std::vector<PooledBuffer> m_idle;
+    std::unordered_map<uint64_t, PooledBuffer> m_in_use;
+    int64_t m_allocated_bytes { 0 };
+    int64_t m_idle_bytes { 0 };
+};
+
+}
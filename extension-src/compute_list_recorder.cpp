@@ -0,0 +1,103 @@
+#include "compute_list_recorder.h"
+
+using namespace godot;
+
+ComputeListRecorder::ComputeListRecorder(RenderingDevice* device, bool split_lists)
+    : m_device(device), m_split_lists(split_lists) {
+}
+
+ComputeListRecorder::~ComputeListRecorder() {
+    end();
+}
+
+void ComputeListRecorder::bind_pipeline(const RID& pipeline) {
+    if (m_pipeline != pipeline) {
+        // Sets and push constants of the previous pass were created for a different shader.
+        m_uniform_sets.fill(RID());
+        m_push_constant = PackedByteArray();
+    }
+
+    m_pipeline = pipeline;
+}
+
+void ComputeListRecorder::bind_uniform_set(const RID& uniform_set, uint32_t set_index) {
+    ERR_FAIL_COND_MSG(set_index >= MAX_UNIFORM_SETS, "Uniform set index out of range.");
+
+    m_uniform_sets[set_index] = uniform_set;
+}
+
+void ComputeListRecorder::set_push_constant(const PackedByteArray& push_constant) {
+    m_push_constant = push_constant;
+    m_push_constant_dirty = true;
+}
+
+void ComputeListRecorder::dispatch(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z) {
+    begin_dispatch();
+    m_device->compute_list_dispatch(m_list, groups_x, groups_y, groups_z);
+    finish_dispatch();
+}
+
+void ComputeListRecorder::dispatch_indirect(const RID& buffer, uint32_t offset) {
+    begin_dispatch();
+    m_device->compute_list_dispatch_indirect(m_list, buffer, offset);
+    finish_dispatch();
+}
+
+void ComputeListRecorder::barrier() {
+    // Separate compute lists are already ordered against each other.
+    if (m_list >= 0) {
+        m_needs_barrier = true;
+    }
+}
+
+void ComputeListRecorder::end() {
+    if (m_list < 0) {
+        return;
+    }
+
+    m_device->compute_list_end();
+    m_list = -1;
+}
+
+void ComputeListRecorder::begin_dispatch() {
+    if (m_list < 0) {
+        m_list = m_device->compute_list_begin();
+        m_bound_pipeline = RID();
+        m_bound_uniform_sets.fill(RID());
+        m_needs_barrier = false;
+    }
+
+    if (m_needs_barrier) {
+        m_device->compute_list_add_barrier(m_list);
+        m_needs_barrier = false;
+    }
+
+    flush_binds();
+}
+
+void ComputeListRecorder::finish_dispatch() {
+    if (m_split_lists) {
+        end();
+    }
+}
+
+void ComputeListRecorder::flush_binds() {
+    if (m_bound_pipeline != m_pipeline) {
+        m_device->compute_list_bind_compute_pipeline(m_list, m_pipeline);
+        m_bound_pipeline = m_pipeline;
+        m_bound_uniform_sets.fill(RID());
+        m_push_constant_dirty = true;
+    }
+
+    for (uint32_t i = 0; i < MAX_UNIFORM_SETS; ++i) {
+        if (m_uniform_sets[i].is_valid() && m_bound_uniform_sets[i] != m_uniform_sets[i]) {
+            m_device->compute_list_bind_uniform_set(m_list, m_uniform_sets[i], i);
+            m_bound_uniform_sets[i] = m_uniform_sets[i];
+        }
+    }
+
+    if (m_push_constant_dirty && !m_push_constant.is_empty()) {
+        m_device->compute_list_set_push_constant(m_list, m_push_constant, m_push_constant.size());
+        m_push_constant_dirty = false;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <godot_cpp/classes/rendering_device.hpp>
+
+#include <array>
+
+namespace godot {
+
+// Records compute dispatches while tracking what is bound, so pipelines, uniform sets and push constants
+// are only submitted when they change. With split_lists every dispatch gets its own compute list and a full
+// set of binds, which is how the solver used to record its passes and is kept for benchmarking.
+class ComputeListRecorder {
+public:
+    static constexpr int MAX_UNIFORM_SETS = 8;
+
+    ComputeListRecorder(RenderingDevice* device, bool split_lists);
+    ~ComputeListRecorder();
+
+    ComputeListRecorder(const ComputeListRecorder&) = delete;
+    ComputeListRecorder& operator=(const ComputeListRecorder&) = delete;
+
+    void bind_pipeline(const RID& pipeline);
+    void bind_uniform_set(const RID& uniform_set, uint32_t set_index);
+    void set_push_constant(const PackedByteArray& push_constant);
+
+    void dispatch(uint32_t groups_x, uint32_t groups_y, uint32_t groups_z);
+
+    // Takes the group counts from three uints at offset in buffer, written by an earlier dispatch.
+    void dispatch_indirect(const RID& buffer, uint32_t offset);
+
+    // Makes the results of all previous dispatches visible to the following ones.
+    void barrier();
+
+    // Closes the current compute list. Recording can continue afterwards and will open a new one.
+    void end();
+
+private:
+    RenderingDevice* m_device;
+    bool m_split_lists;
+
+    int64_t m_list { -1 };
+    bool m_needs_barrier { false };
+
+    RID m_pipeline;
+    std::array<RID, MAX_UNIFORM_SETS> m_uniform_sets;
+    PackedByteArray m_push_constant;
+
+    RID m_bound_pipeline;
+    std::array<RID, MAX_UNIFORM_SETS> m_bound_uniform_sets;
+    bool m_push_constant_dirty { false };
+
+    void begin_dispatch();
+    void finish_dispatch();
+    void flush_binds();
+};
+
+}
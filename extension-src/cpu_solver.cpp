@@ -0,0 +1,809 @@
+#include "cpu_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+using namespace godot;
+
+namespace {
+
+constexpr uint8_t FLUID_NEG_X = 1;
+constexpr uint8_t FLUID_NEG_Y = 2;
+constexpr uint8_t FLUID_NEG_Z = 4;
+constexpr uint8_t FLUID_POS_X = 8;
+constexpr uint8_t FLUID_POS_Y = 16;
+constexpr uint8_t FLUID_POS_Z = 32;
+constexpr uint8_t FLUID_SELF = 64;
+constexpr uint8_t FLUID_NEIGHBOURS = 63;
+
+// Rounds to the nearest value representable as an IEEE half float, ties to even, like packHalf2x16.
+float round_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = bits & 0x80000000u;
+    const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u) {
+        return value;
+    }
+
+    if (magnitude >= 0x477FF000u) {
+        return std::copysign(std::numeric_limits<float>::infinity(), value);
+    }
+
+    if (magnitude < 0x38800000u) {
+        // Below the smallest normal half the spacing is a constant 2^-24.
+        return std::copysign(std::nearbyint(std::fabs(value) * 16777216.0f) / 16777216.0f, value);
+    }
+
+    // Keep 10 of the 23 mantissa bits.
+    const uint32_t lsb = (magnitude >> 13) & 1u;
+    bits = sign | ((magnitude + 0x0FFFu + lsb) & ~0x1FFFu);
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+
+    return result;
+}
+
+float flag(uint8_t mask, uint8_t bit) {
+    return (mask & bit) != 0 ? 1.0f : 0.0f;
+}
+
+}
+
+void CpuSolver::init(const Vector3i field_size, const float cell_size, const PackedFloat32Array& solid, const int thread_count) {
+    m_field_size = field_size;
+    m_cell_size = cell_size;
+    m_cell_count = field_size.x * field_size.y * field_size.z;
+
+    for (VelocityBuffers* buffers : { &m_velocity_buffers1, &m_velocity_buffers2 }) {
+        buffers->u.assign(m_cell_count, 0.0);
+        buffers->v.assign(m_cell_count, 0.0);
+        buffers->w.assign(m_cell_count, 0.0);
+    }
+
+    build_solid_mask(solid);
+    m_pressure.assign(m_cell_count, 0.0);
+
+    // Matches the clear color of the GPU output texture, cells on the boundary are never written.
+    m_output.resize(4 * m_cell_count);
+    for (int i = 0; i < m_cell_count; ++i) {
+        m_output[4 * i + 0] = 1.0;
+        m_output[4 * i + 1] = 0.0;
+        m_output[4 * i + 2] = 0.0;
+        m_output[4 * i + 3] = 1.0;
+    }
+
+    build_tiles();
+
+    m_thread_pool = std::make_unique<ThreadPool>(thread_count);
+}
+
+void CpuSolver::resize(const Vector3i field_size, const float cell_size, const PackedFloat32Array& solid,
+                       const int thread_count) {
+    const int cell_count = field_size.x * field_size.y * field_size.z;
+
+    VelocityBuffers resampled;
+    resampled.u.resize(cell_count);
+    resampled.v.resize(cell_count);
+    resampled.w.resize(cell_count);
+
+    for (int k = 0; k < field_size.z; ++k) {
+        for (int j = 0; j < field_size.y; ++j) {
+            for (int i = 0; i < field_size.x; ++i) {
+                const int idx = k * field_size.x * field_size.y + j * field_size.x + i;
+                const Vector3 cell(static_cast<float>(i), static_cast<float>(j), static_cast<float>(k));
+
+                resampled.u[idx] = interpolate_faces(m_velocity_buffers2.u, 0, (cell + Vector3(0.0, 0.5, 0.5)) * cell_size);
+                resampled.v[idx] = interpolate_faces(m_velocity_buffers2.v, 1, (cell + Vector3(0.5, 0.0, 0.5)) * cell_size);
+                resampled.w[idx] = interpolate_faces(m_velocity_buffers2.w, 2, (cell + Vector3(0.5, 0.5, 0.0)) * cell_size);
+            }
+        }
+    }
+
+    init(field_size, cell_size, solid, thread_count);
+    m_velocity_buffers2 = std::move(resampled);
+    // Solid tiles are never integrated, they have to hold the same faces in both buffers.
+    m_velocity_buffers1 = m_velocity_buffers2;
+}
+
+void CpuSolver::set_half_precision(const bool enabled) {
+    m_half_precision = enabled;
+}
+
+void CpuSolver::set_constants(const float over_relaxation, const float density) {
+    m_over_relaxation = over_relaxation;
+    m_density = density;
+}
+
+void CpuSolver::set_sparse(const bool enabled, const float activity_threshold) {
+    m_sparse = enabled;
+    m_activity_threshold = activity_threshold;
+}
+
+void CpuSolver::set_emitters(const EmitterList& emitters) {
+    m_emitters = emitters;
+}
+
+void CpuSolver::build_solid_mask(const PackedFloat32Array& solid) {
+    m_solid_mask.assign(m_cell_count, 0);
+
+    auto is_fluid = [&](int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < m_field_size.x && j < m_field_size.y && k < m_field_size.z &&
+               solid[to_index(i, j, k)] > 0.0f;
+    };
+
+    for (int k = 0; k < m_field_size.z; ++k) {
+        for (int j = 0; j < m_field_size.y; ++j) {
+            for (int i = 0; i < m_field_size.x; ++i) {
+                uint8_t mask = 0;
+
+                mask |= is_fluid(i - 1, j, k) ? FLUID_NEG_X : 0;
+                mask |= is_fluid(i, j - 1, k) ? FLUID_NEG_Y : 0;
+                mask |= is_fluid(i, j, k - 1) ? FLUID_NEG_Z : 0;
+                mask |= is_fluid(i + 1, j, k) ? FLUID_POS_X : 0;
+                mask |= is_fluid(i, j + 1, k) ? FLUID_POS_Y : 0;
+                mask |= is_fluid(i, j, k + 1) ? FLUID_POS_Z : 0;
+                mask |= is_fluid(i, j, k) ? FLUID_SELF : 0;
+
+                m_solid_mask[to_index(i, j, k)] = mask;
+            }
+        }
+    }
+}
+
+void CpuSolver::build_tiles() {
+    m_tiles = Vector3i(
+        (m_field_size.x + TILE_SIZE - 1) / TILE_SIZE,
+        (m_field_size.y + TILE_SIZE - 1) / TILE_SIZE,
+        (m_field_size.z + TILE_SIZE - 1) / TILE_SIZE
+    );
+
+    const int tile_count = m_tiles.x * m_tiles.y * m_tiles.z;
+    m_solid_tiles.assign(tile_count, 1);
+    m_moving_tiles.assign(tile_count, 0);
+    m_active_tiles.clear();
+    m_listed_tiles.assign(tile_count, 0);
+    m_tile_blocks.assign(tile_count, TileBlock());
+
+    for (int k = 0; k < m_field_size.z; ++k) {
+        for (int j = 0; j < m_field_size.y; ++j) {
+            for (int i = 0; i < m_field_size.x; ++i) {
+                if (m_solid_mask[to_index(i, j, k)] != 0) {
+                    const int tile = ((k / TILE_SIZE) * m_tiles.y + j / TILE_SIZE) * m_tiles.x + i / TILE_SIZE;
+                    m_solid_tiles[tile] = 0;
+                }
+            }
+        }
+    }
+
+    // Tiles a step skips keep their output, so all of it starts out as the resting field.
+    copy_to_output(m_velocity_buffers2, Vector3i(), m_field_size);
+}
+
+Vector3i CpuSolver::get_tile_origin(const int tile) const {
+    const int i = tile % m_tiles.x;
+    const int j = (tile / m_tiles.x) % m_tiles.y;
+    const int k = tile / (m_tiles.x * m_tiles.y);
+
+    return Vector3i(i, j, k) * TILE_SIZE;
+}
+
+bool CpuSolver::is_tile_moving(const Vector3i begin, const Vector3i end) const {
+    const VelocityBuffers& velocity = m_velocity_buffers2;
+
+    for (int k = begin.z; k < end.z; ++k) {
+        for (int j = begin.y; j < end.y; ++j) {
+            for (int i = begin.x; i < end.x; ++i) {
+                const int idx = to_index(i, j, k);
+                const float speed = std::max(std::abs(velocity.u[idx]), std::max(std::abs(velocity.v[idx]), std::abs(velocity.w[idx])));
+
+                if (speed > m_activity_threshold) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return m_emitters.reaches(begin, end);
+}
+
+void CpuSolver::update_active_tiles() {
+    const int tile_count = m_tiles.x * m_tiles.y * m_tiles.z;
+    m_active_tiles.clear();
+
+    // An emitter overlapping a wall still writes the wall's faces during integration.
+    auto is_skipped = [&](int tile) {
+        if (m_solid_tiles[tile] == 0) {
+            return false;
+        }
+
+        const Vector3i begin = get_tile_origin(tile);
+        return !m_emitters.reaches(begin, (begin + Vector3i(TILE_SIZE, TILE_SIZE, TILE_SIZE)).min(m_field_size));
+    };
+
+    if (!m_sparse) {
+        for (int tile = 0; tile < tile_count; ++tile) {
+            if (!is_skipped(tile)) {
+                m_active_tiles.push_back(tile);
+            }
+        }
+
+        return;
+    }
+
+    // Every tile writes only its own flag.
+    m_thread_pool->parallel_for(0, tile_count, [&](int tile_begin, int tile_end) {
+        for (int tile = tile_begin; tile < tile_end; ++tile) {
+            const Vector3i begin = get_tile_origin(tile);
+            const Vector3i end = (begin + Vector3i(TILE_SIZE, TILE_SIZE, TILE_SIZE)).min(m_field_size);
+            m_moving_tiles[tile] = !is_skipped(tile) && is_tile_moving(begin, end) ? 1 : 0;
+        }
+    });
+
+    // Like compact_active_bricks.glsl, tiles next to a moving one are listed as well so motion can spread.
+    for (int tile = 0; tile < tile_count; ++tile) {
+        if (is_skipped(tile)) {
+            continue;
+        }
+
+        const Vector3i t = get_tile_origin(tile) / TILE_SIZE;
+        const Vector3i t0 = (t - Vector3i(1, 1, 1)).max(Vector3i());
+        const Vector3i t1 = (t + Vector3i(1, 1, 1)).min(m_tiles - Vector3i(1, 1, 1));
+        bool active = false;
+
+        for (int k = t0.z; k <= t1.z && !active; ++k) {
+            for (int j = t0.y; j <= t1.y && !active; ++j) {
+                for (int i = t0.x; i <= t1.x && !active; ++i) {
+                    active = m_moving_tiles[(k * m_tiles.y + j) * m_tiles.x + i] != 0;
+                }
+            }
+        }
+
+        if (active) {
+            m_active_tiles.push_back(tile);
+        }
+    }
+}
+
+void CpuSolver::update_tile_blocks() {
+    std::fill(m_listed_tiles.begin(), m_listed_tiles.end(), 0);
+
+    for (const int tile : m_active_tiles) {
+        m_listed_tiles[tile] = 1;
+        TileBlock& block = m_tile_blocks[tile];
+
+        if (!block.mask.empty()) {
+            continue;
+        }
+
+        constexpr int block_size = TILE_STRIDE * TILE_STRIDE * TILE_STRIDE;
+        block.u.assign(block_size, 0.0);
+        block.v.assign(block_size, 0.0);
+        block.w.assign(block_size, 0.0);
+        block.pressure.assign(block_size, 0.0);
+        block.mask.assign(block_size, 0);
+
+        // The solids don't change after init, so the mask is copied once.
+        const Vector3i begin = get_tile_origin(tile);
+        const Vector3i end = (begin + Vector3i(TILE_SIZE, TILE_SIZE, TILE_SIZE)).min(m_field_size);
+
+        for (int k = begin.z; k < end.z; ++k) {
+            for (int j = begin.y; j < end.y; ++j) {
+                for (int i = begin.x; i < end.x; ++i) {
+                    block.mask[to_block_index(Vector3i(i, j, k) - begin)] = m_solid_mask[to_index(i, j, k)];
+                }
+            }
+        }
+    }
+}
+
+void CpuSolver::for_each_active_tile(const std::function<void(int tile, Vector3i begin, Vector3i end)>& function) {
+    m_thread_pool->parallel_for(0, static_cast<int>(m_active_tiles.size()), [&](int list_begin, int list_end) {
+        for (int n = list_begin; n < list_end; ++n) {
+            const int tile = m_active_tiles[n];
+            const Vector3i begin = get_tile_origin(tile);
+            function(tile, begin, (begin + Vector3i(TILE_SIZE, TILE_SIZE, TILE_SIZE)).min(m_field_size));
+        }
+    });
+}
+
+void CpuSolver::load_tile_block(TileBlock& block, const Vector3i begin, const Vector3i end) const {
+    const VelocityBuffers& velocity = m_velocity_buffers1;
+    // The halo stops at the domain, the last cells of the field never reach past it.
+    const Vector3i halo_end = (end + Vector3i(1, 1, 1)).min(m_field_size);
+
+    for (int k = begin.z; k < halo_end.z; ++k) {
+        for (int j = begin.y; j < halo_end.y; ++j) {
+            for (int i = begin.x; i < halo_end.x; ++i) {
+                const int idx = to_index(i, j, k);
+                const int local = to_block_index(Vector3i(i, j, k) - begin);
+
+                block.u[local] = velocity.u[idx];
+                block.v[local] = velocity.v[idx];
+                block.w[local] = velocity.w[idx];
+                block.pressure[local] = m_pressure[idx];
+            }
+        }
+    }
+}
+
+void CpuSolver::store_tile_block(const TileBlock& block, const Vector3i begin, const Vector3i end) {
+    VelocityBuffers& velocity = m_velocity_buffers1;
+
+    // The halo faces belong to the next tiles, which got them in the last exchange.
+    for (int k = begin.z; k < end.z; ++k) {
+        for (int j = begin.y; j < end.y; ++j) {
+            for (int i = begin.x; i < end.x; ++i) {
+                const int idx = to_index(i, j, k);
+                const int local = to_block_index(Vector3i(i, j, k) - begin);
+
+                velocity.u[idx] = block.u[local];
+                velocity.v[idx] = block.v[local];
+                velocity.w[idx] = block.w[local];
+                m_pressure[idx] = block.pressure[local];
+            }
+        }
+    }
+}
+
+void CpuSolver::exchange_halos(const int tile, const int parity, const Vector3i begin, const Vector3i end) {
+    TileBlock& block = m_tile_blocks[tile];
+    const Vector3i extent = end - begin;
+    const int tile_steps[3] = { 1, m_tiles.x, m_tiles.x * m_tiles.y };
+    const int block_steps[3] = { 1, TILE_STRIDE, TILE_STRIDE * TILE_STRIDE };
+    const int field_steps[3] = { 1, m_field_size.x, m_field_size.x * m_field_size.y };
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (end[axis] >= m_field_size[axis]) {
+            continue;
+        }
+
+        const int a_axis = (axis + 1) % 3;
+        const int b_axis = (axis + 2) % 3;
+
+        // The halo layer of this tile and the first layer of the next one. Tiles that aren't listed keep their
+        // faces in the shared buffers.
+        const int next = tile + tile_steps[axis];
+        std::vector<float>& halo = axis == 0 ? block.u : axis == 1 ? block.v : block.w;
+        float* const own = halo.data() + extent[axis] * block_steps[axis];
+        float* other;
+        const int* other_steps;
+
+        if (m_listed_tiles[next] != 0) {
+            TileBlock& next_block = m_tile_blocks[next];
+            other = (axis == 0 ? next_block.u : axis == 1 ? next_block.v : next_block.w).data();
+            other_steps = block_steps;
+        } else {
+            std::vector<float>& faces = axis == 0 ? m_velocity_buffers1.u : axis == 1 ? m_velocity_buffers1.v : m_velocity_buffers1.w;
+            Vector3i face = begin;
+            face[axis] = end[axis];
+            other = faces.data() + to_index(face.x, face.y, face.z);
+            other_steps = field_steps;
+        }
+
+        // Only one of the two cells on either side of a face has the colour of the sweep. The face went to the next
+        // tile if it's the one in this tile.
+        const int colour = (begin.x + begin.y + begin.z + extent[axis] - 1) & 1;
+
+        for (int b = 0; b < extent[b_axis]; ++b) {
+            float* const own_row = own + b * block_steps[b_axis];
+            float* const other_row = other + b * other_steps[b_axis];
+            const int written = (colour + b + parity) & 1;
+
+            for (int a = written; a < extent[a_axis]; a += 2) {
+                other_row[a * other_steps[a_axis]] = own_row[a * block_steps[a_axis]];
+            }
+
+            for (int a = 1 - written; a < extent[a_axis]; a += 2) {
+                own_row[a * block_steps[a_axis]] = other_row[a * other_steps[a_axis]];
+            }
+        }
+    }
+}
+
+int CpuSolver::to_block_index(const Vector3i local) {
+    return (local.z * TILE_STRIDE + local.y) * TILE_STRIDE + local.x;
+}
+
+int CpuSolver::get_active_tile_count() const {
+    return static_cast<int>(m_active_tiles.size());
+}
+
+bool CpuSolver::is_initialized() const {
+    return m_thread_pool != nullptr;
+}
+
+Vector3i CpuSolver::get_field_size() const {
+    return m_field_size;
+}
+
+const std::vector<float>& CpuSolver::get_output() const {
+    return m_output;
+}
+
+Vector3 CpuSolver::sample_velocity(const Vector3 position) const {
+    return Vector3(
+        interpolate_faces(m_velocity_buffers2.u, 0, position),
+        interpolate_faces(m_velocity_buffers2.v, 1, position),
+        interpolate_faces(m_velocity_buffers2.w, 2, position)
+    );
+}
+
+void CpuSolver::step(const float delta_time, const int pressure_iterations) {
+    ThreadPool& pool = *m_thread_pool;
+    const int slices = m_field_size.z;
+
+    update_active_tiles();
+    update_tile_blocks();
+
+    for_each_active_tile([&](int, Vector3i begin, Vector3i end) {
+        integrate(m_velocity_buffers2, m_velocity_buffers1, delta_time, begin, end);
+    });
+
+    // Cells of one colour share no face, so tiles next to each other can run the same sweep at once. A sweep
+    // sees the faces the neighbouring tiles wrote in the one before through the exchange.
+    for_each_active_tile([&](int tile, Vector3i begin, Vector3i end) {
+        load_tile_block(m_tile_blocks[tile], begin, end);
+    });
+
+    for (int i = 0; i < pressure_iterations; ++i) {
+        for_each_active_tile([&](int tile, Vector3i begin, Vector3i end) {
+            solve_incompressibility(m_tile_blocks[tile], delta_time, i % 2, begin, end);
+        });
+
+        for_each_active_tile([&](int tile, Vector3i begin, Vector3i end) {
+            exchange_halos(tile, i % 2, begin, end);
+        });
+    }
+
+    for_each_active_tile([&](int tile, Vector3i begin, Vector3i end) {
+        store_tile_block(m_tile_blocks[tile], begin, end);
+    });
+
+    // Only touches the faces on the domain boundary.
+    pool.parallel_for(0, slices, [&](int k_begin, int k_end) {
+        extrapolate(m_velocity_buffers1, k_begin, k_end);
+    });
+
+    for_each_active_tile([&](int, Vector3i begin, Vector3i end) {
+        advect(m_velocity_buffers1, m_velocity_buffers2, delta_time, begin, end);
+    });
+
+    for_each_active_tile([&](int, Vector3i begin, Vector3i end) {
+        copy_to_output(m_velocity_buffers2, begin, end);
+    });
+}
+
+void CpuSolver::integrate(const VelocityBuffers& velocity_in, VelocityBuffers& velocity_out, const float delta_time,
+                          const Vector3i begin, const Vector3i end) {
+    for (int k = begin.z; k < end.z; ++k) {
+        for (int j = begin.y; j < end.y; ++j) {
+            for (int i = begin.x; i < end.x; ++i) {
+                const int idx = to_index(i, j, k);
+
+                // Gravity is disabled in integrate.glsl, so only the emitters change the input velocity.
+                const Vector3 velocity = m_emitters.apply(Vector3i(i, j, k),
+                    Vector3(velocity_in.u[idx], velocity_in.v[idx], velocity_in.w[idx]), delta_time);
+
+                velocity_out.u[idx] = quantize(static_cast<float>(velocity.x));
+                velocity_out.v[idx] = quantize(static_cast<float>(velocity.y));
+                velocity_out.w[idx] = quantize(static_cast<float>(velocity.z));
+
+                m_pressure[idx] = 0.0;
+            }
+        }
+    }
+}
+
+void CpuSolver::solve_incompressibility(TileBlock& block, const float delta_time, const int parity,
+                                        const Vector3i begin, const Vector3i end) {
+    const int max_i = std::min(end.x, m_field_size.x - 1);
+    const int max_j = std::min(end.y, m_field_size.y - 1);
+    const int max_k = std::min(end.z, m_field_size.z - 1);
+    const int min_i = std::max(begin.x, 1);
+
+    for (int k = std::max(begin.z, 1); k < max_k; ++k) {
+        for (int j = std::max(begin.y, 1); j < max_j; ++j) {
+            // Red-black ordering: within one pass no two updated cells share a face.
+            for (int i = min_i + ((min_i + j + k + parity) & 1); i < max_i; i += 2) {
+                const int idx_uvw0 = to_block_index(Vector3i(i, j, k) - begin);
+                const uint8_t mask = block.mask[idx_uvw0];
+
+                if ((mask & FLUID_NEIGHBOURS) == 0) {
+                    continue;
+                }
+
+                const float s[6] = {
+                    flag(mask, FLUID_NEG_X),
+                    flag(mask, FLUID_NEG_Y),
+                    flag(mask, FLUID_NEG_Z),
+                    flag(mask, FLUID_POS_X),
+                    flag(mask, FLUID_POS_Y),
+                    flag(mask, FLUID_POS_Z),
+                };
+                const float s_sum = s[0] + s[1] + s[2] + s[3] + s[4] + s[5];
+
+                const int idx_u1 = idx_uvw0 + 1;
+                const int idx_v1 = idx_uvw0 + TILE_STRIDE;
+                const int idx_w1 = idx_uvw0 + TILE_STRIDE * TILE_STRIDE;
+
+                const float d = block.u[idx_u1] - block.u[idx_uvw0] +
+                                block.v[idx_v1] - block.v[idx_uvw0] +
+                                block.w[idx_w1] - block.w[idx_uvw0];
+                const float p = (-1.0f / s_sum) * d * m_over_relaxation;
+
+                block.u[idx_uvw0] = quantize(block.u[idx_uvw0] - s[0] * p);
+                block.u[idx_u1] = quantize(block.u[idx_u1] + s[3] * p);
+                block.v[idx_uvw0] = quantize(block.v[idx_uvw0] - s[1] * p);
+                block.v[idx_v1] = quantize(block.v[idx_v1] + s[4] * p);
+                block.w[idx_uvw0] = quantize(block.w[idx_uvw0] - s[2] * p);
+                block.w[idx_w1] = quantize(block.w[idx_w1] + s[5] * p);
+
+                block.pressure[idx_uvw0] = quantize(block.pressure[idx_uvw0] + p * m_density * m_cell_size / delta_time);
+            }
+        }
+    }
+}
+
+void CpuSolver::extrapolate(VelocityBuffers& velocity, const int k_begin, const int k_end) const {
+    const int max_i = m_field_size.x - 1;
+    const int max_j = m_field_size.y - 1;
+    const int max_k = m_field_size.z - 1;
+
+    for (int k = k_begin; k < k_end; ++k) {
+        for (int j = 0; j < m_field_size.y; ++j) {
+            velocity.u[to_index(0, j, k)] = 0.0;
+            velocity.u[to_index(max_i, j, k)] = 0.0;
+        }
+
+        for (int i = 0; i < m_field_size.x; ++i) {
+            velocity.v[to_index(i, 0, k)] = 0.0;
+            velocity.v[to_index(i, max_j, k)] = 0.0;
+        }
+
+        if (k == 0 || k == max_k) {
+            for (int j = 0; j < m_field_size.y; ++j) {
+                for (int i = 0; i < m_field_size.x; ++i) {
+                    velocity.w[to_index(i, j, k)] = 0.0;
+                }
+            }
+        }
+    }
+}
+
+void CpuSolver::advect(const VelocityBuffers& velocity_in, VelocityBuffers& velocity_out, const float delta_time,
+                       const Vector3i begin, const Vector3i end) const {
+    const float cell_size = m_cell_size;
+    const auto& u_in = velocity_in.u;
+    const auto& v_in = velocity_in.v;
+    const auto& w_in = velocity_in.w;
+
+    for (int k = std::max(begin.z, 1); k < end.z; ++k) {
+        for (int j = std::max(begin.y, 1); j < end.y; ++j) {
+            for (int i = std::max(begin.x, 1); i < end.x; ++i) {
+                const int idx = to_index(i, j, k);
+
+                const float u0 = u_in[idx];
+                const float v0 = v_in[idx];
+                const float w0 = w_in[idx];
+
+                const uint8_t mask = m_solid_mask[idx];
+                const bool is_fluid = (mask & FLUID_SELF) != 0;
+
+                const float x = static_cast<float>(i) * cell_size;
+                const float y = static_cast<float>(j) * cell_size;
+                const float z = static_cast<float>(k) * cell_size;
+
+                if (is_fluid && (mask & FLUID_NEG_X) != 0) {
+                    const float vel_v = (v0 + fetch(v_in, to_index(i, j + 1, k)) +
+                                         fetch(v_in, to_index(i - 1, j, k)) + fetch(v_in, to_index(i - 1, j + 1, k))) * 0.25f;
+                    const float vel_w = (w0 + fetch(w_in, to_index(i, j, k + 1)) +
+                                         fetch(w_in, to_index(i - 1, j, k)) + fetch(w_in, to_index(i - 1, j, k + 1))) * 0.25f;
+
+                    const float position[3] = {
+                        x - u0 * delta_time,
+                        y + 0.5f * cell_size - vel_v * delta_time,
+                        z + 0.5f * cell_size - vel_w * delta_time,
+                    };
+
+                    velocity_out.u[idx] = quantize(sample_field(u_in, 0, position));
+                }
+
+                if (is_fluid && (mask & FLUID_NEG_Y) != 0) {
+                    const float vel_u = (u0 + fetch(u_in, to_index(i + 1, j, k)) +
+                                         fetch(u_in, to_index(i, j - 1, k)) + fetch(u_in, to_index(i + 1, j - 1, k))) * 0.25f;
+                    const float vel_w = (w0 + fetch(w_in, to_index(i, j, k + 1)) +
+                                         fetch(w_in, to_index(i, j - 1, k)) + fetch(w_in, to_index(i, j - 1, k + 1))) * 0.25f;
+
+                    const float position[3] = {
+                        x + 0.5f * cell_size - vel_u * delta_time,
+                        y - v0 * delta_time,
+                        z + 0.5f * cell_size - vel_w * delta_time,
+                    };
+
+                    velocity_out.v[idx] = quantize(sample_field(v_in, 1, position));
+                }
+
+                if (is_fluid && (mask & FLUID_NEG_Z) != 0) {
+                    const float vel_u = (u0 + fetch(u_in, to_index(i + 1, j, k)) +
+                                         fetch(u_in, to_index(i, j, k - 1)) + fetch(u_in, to_index(i + 1, j, k - 1))) * 0.25f;
+                    const float vel_v = (v0 + fetch(v_in, to_index(i, j + 1, k)) +
+                                         fetch(v_in, to_index(i, j, k - 1)) + fetch(v_in, to_index(i, j + 1, k - 1))) * 0.25f;
+
+                    const float position[3] = {
+                        x + 0.5f * cell_size - vel_u * delta_time,
+                        y + 0.5f * cell_size - vel_v * delta_time,
+                        z - w0 * delta_time,
+                    };
+
+                    velocity_out.w[idx] = quantize(sample_field(w_in, 2, position));
+                }
+            }
+        }
+    }
+}
+
+void CpuSolver::copy_to_output(const VelocityBuffers& velocity, const Vector3i begin, const Vector3i end) {
+    const int max_i = std::min(end.x, m_field_size.x - 1);
+    const int max_j = std::min(end.y, m_field_size.y - 1);
+    const int max_k = std::min(end.z, m_field_size.z - 1);
+
+    for (int k = std::max(begin.z, 1); k < max_k; ++k) {
+        for (int j = std::max(begin.y, 1); j < max_j; ++j) {
+            for (int i = std::max(begin.x, 1); i < max_i; ++i) {
+                const int idx = to_index(i, j, k);
+                float* out = &m_output[4 * idx];
+
+                if ((m_solid_mask[idx] & FLUID_NEIGHBOURS) == 0) {
+                    out[0] = out[1] = out[2] = out[3] = 0.0;
+                    continue;
+                }
+
+                out[0] = quantize((velocity.u[idx] + velocity.u[to_index(i + 1, j, k)]) * 0.5f);
+                out[1] = quantize((velocity.v[idx] + velocity.v[to_index(i, j + 1, k)]) * 0.5f);
+                out[2] = quantize((velocity.w[idx] + velocity.w[to_index(i, j, k + 1)]) * 0.5f);
+                out[3] = m_pressure[idx];
+            }
+        }
+    }
+}
+
+float CpuSolver::sample_field(const std::vector<float>& field, const int dim, const float (&position)[3]) const {
+    const int faces[3] = { m_field_size.x, m_field_size.y, m_field_size.z };
+    const float cell_size = m_cell_size;
+
+    float pos[3];
+    float ijk1[3];
+    float ijk_max[3];
+
+    for (int c = 0; c < 3; ++c) {
+        ijk_max[c] = static_cast<float>(faces[c] - 1);
+        pos[c] = std::clamp(position[c], 0.0f, cell_size * ijk_max[c]);
+
+        const float d = c == dim ? 0.0f : 0.5f * cell_size;
+        ijk1[c] = std::min(std::floor((pos[c] - d) / cell_size), ijk_max[c]);
+    }
+
+    auto corner = [&](float di, float dj, float dk) {
+        return fetch(field, to_index(
+            static_cast<int>(std::min(ijk1[0] + di, ijk_max[0])),
+            static_cast<int>(std::min(ijk1[1] + dj, ijk_max[1])),
+            static_cast<int>(std::min(ijk1[2] + dk, ijk_max[2]))
+        ));
+    };
+
+    const float vel1 = corner(0.0, 0.0, 0.0);
+    const float vel2 = corner(0.0, 1.0, 0.0);
+    const float vel3 = corner(0.0, 0.0, 1.0);
+    const float vel4 = corner(0.0, 1.0, 1.0);
+    const float vel5 = corner(1.0, 0.0, 0.0);
+    const float vel6 = corner(1.0, 1.0, 0.0);
+    const float vel7 = corner(1.0, 0.0, 1.0);
+    const float vel8 = corner(1.0, 1.0, 1.0);
+
+    // Like MAKE_SAMPLE_FN, the weights only use the fractional offset along the sampled dimension.
+    const float w1 = (pos[dim] - ijk1[dim] * cell_size) / cell_size;
+    const float w2 = 1.0f - w1;
+
+    return w1 * w1 * w1 * vel1 +
+           w1 * w2 * w1 * vel2 +
+           w1 * w1 * w2 * vel3 +
+           w1 * w2 * w2 * vel4 +
+           w2 * w1 * w1 * vel5 +
+           w2 * w2 * w1 * vel6 +
+           w2 * w1 * w2 * vel7 +
+           w2 * w2 * w2 * vel8;
+}
+
+float CpuSolver::quantize(const float value) const {
+    return m_half_precision ? round_to_half(value) : value;
+}
+
+FieldStats CpuSolver::compute_stats() const {
+    const VelocityBuffers& velocity = m_velocity_buffers2;
+    const float cell_volume = m_cell_size * m_cell_size * m_cell_size;
+    FieldStats stats;
+
+    for (int k = 1; k < m_field_size.z - 1; ++k) {
+        for (int j = 1; j < m_field_size.y - 1; ++j) {
+            for (int i = 1; i < m_field_size.x - 1; ++i) {
+                const int idx = to_index(i, j, k);
+                const uint8_t mask = m_solid_mask[idx];
+
+                if ((mask & FLUID_SELF) == 0) {
+                    continue;
+                }
+
+                const float u0 = velocity.u[idx];
+                const float v0 = velocity.v[idx];
+                const float w0 = velocity.w[idx];
+                const float u1 = velocity.u[to_index(i + 1, j, k)];
+                const float v1 = velocity.v[to_index(i, j + 1, k)];
+                const float w1 = velocity.w[to_index(i, j, k + 1)];
+
+                const float values[4] = { u0, v0, w0, m_pressure[idx] };
+                const Vector3 centre((u0 + u1) * 0.5f, (v0 + v1) * 0.5f, (w0 + w1) * 0.5f);
+
+                const float energy = 0.5f * m_density * static_cast<float>(centre.length_squared()) * cell_volume;
+                const float divergence = (mask & FLUID_NEIGHBOURS) != 0
+                    ? std::abs(u1 - u0 + v1 - v0 + w1 - w0) / m_cell_size
+                    : 0.0f;
+                const float face_speed = std::max(std::abs(u0), std::max(std::abs(v0), std::abs(w0)));
+
+                stats.add_cell(values, energy, divergence, face_speed);
+            }
+        }
+    }
+
+    return stats;
+}
+
+float CpuSolver::interpolate_faces(const std::vector<float>& field, const int dim, const Vector3 position) const {
+    const int faces[3] = { m_field_size.x, m_field_size.y, m_field_size.z };
+
+    int ijk[3];
+    float t[3];
+
+    for (int c = 0; c < 3; ++c) {
+        const float offset = c == dim ? 0.0f : 0.5f;
+        const float grid_pos = std::clamp(static_cast<float>(position[c]) / m_cell_size - offset, 0.0f,
+                                          static_cast<float>(faces[c] - 1));
+
+        ijk[c] = std::min(static_cast<int>(std::floor(grid_pos)), faces[c] - 2);
+        t[c] = grid_pos - static_cast<float>(ijk[c]);
+    }
+
+    auto corner = [&](int di, int dj, int dk) {
+        return fetch(field, to_index(ijk[0] + di, ijk[1] + dj, ijk[2] + dk));
+    };
+
+    auto mix = [](float a, float b, float weight) {
+        return a + (b - a) * weight;
+    };
+
+    const float c00 = mix(corner(0, 0, 0), corner(1, 0, 0), t[0]);
+    const float c10 = mix(corner(0, 1, 0), corner(1, 1, 0), t[0]);
+    const float c01 = mix(corner(0, 0, 1), corner(1, 0, 1), t[0]);
+    const float c11 = mix(corner(0, 1, 1), corner(1, 1, 1), t[0]);
+
+    return mix(mix(c00, c10, t[1]), mix(c01, c11, t[1]), t[2]);
+}
+
+int CpuSolver::to_index(const int i, const int j, const int k) const {
+    return k * m_field_size.x * m_field_size.y + j * m_field_size.x + i;
+}
+
+float CpuSolver::fetch(const std::vector<float>& field, const int index) const {
+    // Neighbour reads at the upper faces can leave the buffer, robust buffer access returns zero for those.
+    if (index < 0 || index >= m_cell_count) {
+        return 0.0;
+    }
+
+    return field[index];
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <godot_cpp/variant/packed_float32_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "emitter_list.h"
+#include "field_stats.h"
+#include "thread_pool.h"
+
+namespace godot {
+
+// CPU implementation of the five solver stages. Each stage mirrors its GLSL kernel in shaders/ operation
+// by operation, so the CPU backend can run headless and serve as a reference for the compute shaders.
+// Work is split into tiles of TILE_SIZE^3 cells and the list of tiles a step runs on is spread over a thread pool.
+// Every stage and every red-black sweep finishes on all tiles before the next one starts. The pressure solve runs
+// on a block of its own per tile, with a halo layer for the faces the tile shares with the next tile along each
+// axis, and the tiles exchange those faces between sweeps. The other stages read and write the shared buffers.
+class CpuSolver {
+public:
+    // The same bricks the GPU lists with sparse_bricks and bins the emitters into.
+    static constexpr int TILE_SIZE = 8;
+    // Cells along each axis of a tile block, the tile and its upper halo layer.
+    static constexpr int TILE_STRIDE = TILE_SIZE + 1;
+
+private:
+    struct VelocityBuffers {
+        std::vector<float> u;
+        std::vector<float> v;
+        std::vector<float> w;
+    };
+
+    // A tile's copy of the fields the pressure solve works on, TILE_STRIDE^3 values in k-j-i order starting at the
+    // tile's origin. Along each axis the layer past the tile holds the faces it shares with the next tile, which
+    // only the component normal to that layer uses.
+    struct TileBlock {
+        std::vector<float> u;
+        std::vector<float> v;
+        std::vector<float> w;
+        std::vector<float> pressure;
+        std::vector<uint8_t> mask;
+    };
+
+    Vector3i m_field_size;
+    float m_cell_size { 0.0 };
+    int m_cell_count { 0 };
+
+    VelocityBuffers m_velocity_buffers1;
+    VelocityBuffers m_velocity_buffers2;
+    // Same packing as build_solid_mask.glsl, one byte of neighbour flags per cell.
+    std::vector<uint8_t> m_solid_mask;
+    std::vector<float> m_pressure;
+    std::vector<float> m_output;
+
+    EmitterList m_emitters;
+
+    Vector3i m_tiles;
+    // Tiles without a fluid cell or a cell next to one. Nothing in them changes, so they are always skipped.
+    std::vector<uint8_t> m_solid_tiles;
+    // Per tile, whether it moves or holds an emitter, rebuilt each sparse step.
+    std::vector<uint8_t> m_moving_tiles;
+    // The tiles the next step runs on.
+    std::vector<int> m_active_tiles;
+    // Per tile, whether it is in m_active_tiles.
+    std::vector<uint8_t> m_listed_tiles;
+    // Allocated the first time a tile is listed.
+    std::vector<TileBlock> m_tile_blocks;
+
+    // Like sparse_bricks on the GPU, only tiles that move or are next to one take part in a step.
+    bool m_sparse { false };
+    float m_activity_threshold { 0.0001 };
+
+    // Rounds every stored value to fp16, to measure the error of the half precision GPU storage.
+    bool m_half_precision { false };
+
+    // The same defaults as shaders/specialization.glslinc.
+    float m_over_relaxation { 1.7 };
+    float m_density { 1000.0 };
+
+    std::unique_ptr<ThreadPool> m_thread_pool;
+
+    // The stages run on the cells from begin up to end, clipped to the cells the kernel covers.
+    void integrate(const VelocityBuffers& velocity_in, VelocityBuffers& velocity_out, float delta_time, Vector3i begin, Vector3i end);
+    void solve_incompressibility(TileBlock& block, float delta_time, int parity, Vector3i begin, Vector3i end);
+    void extrapolate(VelocityBuffers& velocity, int k_begin, int k_end) const;
+    void advect(const VelocityBuffers& velocity_in, VelocityBuffers& velocity_out, float delta_time, Vector3i begin, Vector3i end) const;
+    void copy_to_output(const VelocityBuffers& velocity, Vector3i begin, Vector3i end);
+
+    [[nodiscard]] float sample_field(const std::vector<float>& field, int dim, const float (&position)[3]) const;
+    [[nodiscard]] float interpolate_faces(const std::vector<float>& field, int dim, Vector3 position) const;
+
+    void build_solid_mask(const PackedFloat32Array& solid);
+    void build_tiles();
+    void update_active_tiles();
+    void update_tile_blocks();
+    [[nodiscard]] bool is_tile_moving(Vector3i begin, Vector3i end) const;
+    void for_each_active_tile(const std::function<void(int tile, Vector3i begin, Vector3i end)>& function);
+    [[nodiscard]] Vector3i get_tile_origin(int tile) const;
+
+    // Copies the pressure solve's fields of a tile and its halo into its block and back.
+    void load_tile_block(TileBlock& block, Vector3i begin, Vector3i end) const;
+    void store_tile_block(const TileBlock& block, Vector3i begin, Vector3i end);
+    // Hands the halo faces the tile's cells wrote in the last sweep to the next tiles, and takes the ones they wrote.
+    void exchange_halos(int tile, int parity, Vector3i begin, Vector3i end);
+    [[nodiscard]] static int to_block_index(Vector3i local);
+
+    [[nodiscard]] float quantize(float value) const;
+    [[nodiscard]] int to_index(int i, int j, int k) const;
+    [[nodiscard]] float fetch(const std::vector<float>& field, int index) const;
+
+public:
+    void init(Vector3i field_size, float cell_size, const PackedFloat32Array& solid, int thread_count);
+    // Starts over on a new grid whose faces are sampled from the current velocities, like resample_velocity.glsl.
+    void resize(Vector3i field_size, float cell_size, const PackedFloat32Array& solid, int thread_count);
+    // Binned for the same brick size as the GPU list.
+    void set_emitters(const EmitterList& emitters);
+    void set_half_precision(bool enabled);
+    void set_constants(float over_relaxation, float density);
+    void set_sparse(bool enabled, float activity_threshold);
+
+    void step(float delta_time, int pressure_iterations);
+
+    [[nodiscard]] bool is_initialized() const;
+    [[nodiscard]] Vector3i get_field_size() const;
+    // The number of tiles the last step ran on.
+    [[nodiscard]] int get_active_tile_count() const;
+
+    // Cell centred velocity (xyz) and pressure (w), four floats per cell in linear k-j-i order.
+    [[nodiscard]] const std::vector<float>& get_output() const;
+
+    // Trilinearly interpolated velocity at a position in grid space, like sample_velocities.glsl.
+    [[nodiscard]] Vector3 sample_velocity(Vector3 position) const;
+
+    // Same cells and quantities as field_stats.glsl.
+    [[nodiscard]] FieldStats compute_stats() const;
+};
+
+}
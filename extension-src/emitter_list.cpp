@@ -0,0 +1,178 @@
+#include "emitter_list.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+void EmitterList::clear() {
+    m_emitters.clear();
+    m_ranges.clear();
+    m_indices.clear();
+}
+
+void EmitterList::add(const Emitter& emitter) {
+    if (emitter.velocity.length() <= 0.0) {
+        return;
+    }
+
+    const bool empty = emitter.shape == SHAPE_SPHERE
+        ? emitter.extents.x < 0.0
+        : emitter.extents.x < 0.0 || emitter.extents.y < 0.0 || emitter.extents.z < 0.0;
+
+    if (empty) {
+        return;
+    }
+
+    m_emitters.push_back(emitter);
+}
+
+void EmitterList::build(const Vector3i faces, const int brick_size) {
+    m_brick_size = brick_size;
+    m_bricks = Vector3i(
+        (faces.x + brick_size - 1) / brick_size,
+        (faces.y + brick_size - 1) / brick_size,
+        (faces.z + brick_size - 1) / brick_size
+    );
+
+    const int brick_count = m_bricks.x * m_bricks.y * m_bricks.z;
+    std::vector<std::vector<uint32_t>> bins(brick_count);
+
+    for (size_t e = 0; e < m_emitters.size(); ++e) {
+        const Emitter& emitter = m_emitters[e];
+        const Vector3 reach = emitter.shape == SHAPE_SPHERE ? Vector3(1.0, 1.0, 1.0) * emitter.extents.x : emitter.extents;
+        const Vector3 lower = emitter.center - reach;
+        const Vector3 upper = emitter.center + reach;
+
+        Vector3i brick0;
+        Vector3i brick1;
+
+        for (int a = 0; a < 3; ++a) {
+            brick0[a] = std::max(0, static_cast<int>(std::floor(lower[a] / static_cast<float>(brick_size))));
+            brick1[a] = std::min(m_bricks[a] - 1, static_cast<int>(std::floor(upper[a] / static_cast<float>(brick_size))));
+        }
+
+        for (int k = brick0.z; k <= brick1.z; ++k) {
+            for (int j = brick0.y; j <= brick1.y; ++j) {
+                for (int i = brick0.x; i <= brick1.x; ++i) {
+                    bins[(k * m_bricks.y + j) * m_bricks.x + i].push_back(static_cast<uint32_t>(e));
+                }
+            }
+        }
+    }
+
+    m_ranges.resize(2 * brick_count);
+    m_indices.clear();
+
+    for (int b = 0; b < brick_count; ++b) {
+        m_ranges[2 * b] = static_cast<uint32_t>(m_indices.size());
+        m_ranges[2 * b + 1] = static_cast<uint32_t>(bins[b].size());
+        m_indices.insert(m_indices.end(), bins[b].begin(), bins[b].end());
+    }
+}
+
+int EmitterList::get_count() const {
+    return static_cast<int>(m_emitters.size());
+}
+
+PackedByteArray EmitterList::to_bytes() const {
+    const auto emitter_count = static_cast<uint32_t>(m_emitters.size());
+    const auto brick_count = static_cast<uint32_t>(m_ranges.size() / 2);
+    const uint32_t ranges_offset = emitter_count * EMITTER_WORDS;
+    const uint32_t indices_offset = ranges_offset + 2 * brick_count;
+
+    std::vector<uint32_t> words;
+    words.reserve(HEADER_WORDS + indices_offset + m_indices.size());
+    words.insert(words.end(), { emitter_count, brick_count, ranges_offset, indices_offset });
+
+    for (const Emitter& emitter : m_emitters) {
+        const float values[EMITTER_WORDS] = {
+            static_cast<float>(emitter.center.x), static_cast<float>(emitter.center.y), static_cast<float>(emitter.center.z), 0.0f,
+            static_cast<float>(emitter.extents.x), static_cast<float>(emitter.extents.y), static_cast<float>(emitter.extents.z), emitter.falloff,
+            static_cast<float>(emitter.velocity.x), static_cast<float>(emitter.velocity.y), static_cast<float>(emitter.velocity.z), 0.0f,
+        };
+
+        uint32_t record[EMITTER_WORDS];
+        std::memcpy(record, values, sizeof(record));
+        record[3] = emitter.shape;
+        words.insert(words.end(), std::begin(record), std::end(record));
+    }
+
+    for (size_t b = 0; b < brick_count; ++b) {
+        words.push_back(indices_offset + m_ranges[2 * b]);
+        words.push_back(m_ranges[2 * b + 1]);
+    }
+
+    words.insert(words.end(), m_indices.begin(), m_indices.end());
+
+    PackedByteArray bytes;
+    bytes.resize(static_cast<int64_t>(words.size() * sizeof(uint32_t)));
+    std::memcpy(bytes.ptrw(), words.data(), words.size() * sizeof(uint32_t));
+
+    return bytes;
+}
+
+Vector3 EmitterList::apply(const Vector3i ijk, Vector3 velocity, const float delta_time) const {
+    if (m_ranges.empty()) {
+        return velocity;
+    }
+
+    const Vector3i brick = ijk / m_brick_size;
+    const int b = (brick.z * m_bricks.y + brick.y) * m_bricks.x + brick.x;
+    const Vector3 position(ijk.x, ijk.y, ijk.z);
+
+    for (uint32_t n = 0; n < m_ranges[2 * b + 1]; ++n) {
+        const Emitter& emitter = m_emitters[m_indices[m_ranges[2 * b] + n]];
+        const float w = weight(emitter, position);
+
+        if (w <= 0.0f) {
+            continue;
+        }
+
+        const Vector3 target = emitter.velocity * delta_time;
+        velocity = w >= 1.0f ? target : velocity * (1.0f - w) + target * w;
+    }
+
+    return velocity;
+}
+
+bool EmitterList::reaches(const Vector3i begin, const Vector3i end) const {
+    if (m_ranges.empty()) {
+        return false;
+    }
+
+    const Vector3i brick0 = begin / m_brick_size;
+    const Vector3i brick1 = ((end - Vector3i(1, 1, 1)) / m_brick_size).min(m_bricks - Vector3i(1, 1, 1));
+
+    for (int k = brick0.z; k <= brick1.z; ++k) {
+        for (int j = brick0.y; j <= brick1.y; ++j) {
+            for (int i = brick0.x; i <= brick1.x; ++i) {
+                if (m_ranges[2 * ((k * m_bricks.y + j) * m_bricks.x + i) + 1] > 0) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+float EmitterList::weight(const Emitter& emitter, const Vector3 position) {
+    const Vector3 offset = position - emitter.center;
+    float distance;
+
+    // Distance to the surface, positive inside.
+    if (emitter.shape == SHAPE_SPHERE) {
+        distance = static_cast<float>(emitter.extents.x - offset.length());
+    } else {
+        const Vector3 inside = emitter.extents - offset.abs();
+        distance = static_cast<float>(std::min(inside.x, std::min(inside.y, inside.z)));
+    }
+
+    if (distance < 0.0f) {
+        return 0.0f;
+    }
+
+    return emitter.falloff > 0.0f ? std::min(distance / emitter.falloff, 1.0f) : 1.0f;
+}
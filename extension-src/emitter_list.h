@@ -0,0 +1,61 @@
+#pragma once
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// The emitters of a field in grid space, binned into bricks of cells so a cell only tests the emitters that can
+// reach it. to_bytes() writes the buffer shaders/emitters.glslinc reads: a header of four words (emitter count,
+// brick count, offset of the brick ranges, offset of the indices), EMITTER_WORDS words per emitter, an offset and
+// count per brick and the emitter indices of every brick. Offsets count words after the header.
+class EmitterList {
+public:
+    enum Shape : uint32_t {
+        SHAPE_BOX,
+        SHAPE_SPHERE,
+    };
+
+    // Positions are in cells, with cell ijk at (i, j, k).
+    struct Emitter {
+        Shape shape { SHAPE_BOX };
+        Vector3 center;
+        // Half size of a box, x holds the radius of a sphere.
+        Vector3 extents;
+        Vector3 velocity;
+        // Distance from the edge over which the emitter fades in, zero sets the velocity outright.
+        float falloff { 0.0 };
+    };
+
+    static constexpr int HEADER_WORDS = 4;
+    static constexpr int EMITTER_WORDS = 12;
+
+    void clear();
+    // Emitters without velocity or volume are left out, like the single emitter used to be.
+    void add(const Emitter& emitter);
+    void build(Vector3i faces, int brick_size);
+
+    [[nodiscard]] int get_count() const;
+    [[nodiscard]] PackedByteArray to_bytes() const;
+
+    // Same blend as applyEmitters in emitters.glslinc, in list order.
+    [[nodiscard]] Vector3 apply(Vector3i ijk, Vector3 velocity, float delta_time) const;
+    // Whether an emitter is binned to any brick the cells from begin up to end touch.
+    [[nodiscard]] bool reaches(Vector3i begin, Vector3i end) const;
+
+    [[nodiscard]] static float weight(const Emitter& emitter, Vector3 position);
+
+private:
+    std::vector<Emitter> m_emitters;
+    Vector3i m_bricks;
+    int m_brick_size { 1 };
+    // Offset into m_indices and count, per brick.
+    std::vector<uint32_t> m_ranges;
+    std::vector<uint32_t> m_indices;
+};
+
+}
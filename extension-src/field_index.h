@@ -0,0 +1,49 @@
+#pragma once
+
+#include <godot_cpp/variant/vector3i.hpp>
+
+namespace godot {
+
+// Cell order of the simulation grid buffers, the C++ side of shaders/field_index.glslinc. A brick size of 1 is
+// the linear k-j-i order, larger sizes store the grid as consecutive bricks of brick_size^3 cells padded up to
+// whole bricks.
+class FieldIndex {
+    Vector3i m_size;
+    Vector3i m_bricks;
+    int m_brick_size { 1 };
+
+public:
+    FieldIndex() = default;
+
+    FieldIndex(const Vector3i& size, int brick_size) :
+        m_size(size),
+        m_bricks((size.x + brick_size - 1) / brick_size, (size.y + brick_size - 1) / brick_size, (size.z + brick_size - 1) / brick_size),
+        m_brick_size(brick_size) {}
+
+    [[nodiscard]] static int linear(const Vector3i& items, int i, int j, int k) {
+        return k * items.x * items.y + j * items.x + i;
+    }
+
+    [[nodiscard]] int to_index(int i, int j, int k) const {
+        if (m_brick_size == 1) {
+            return linear(m_size, i, j, k);
+        }
+
+        const Vector3i brick(i / m_brick_size, j / m_brick_size, k / m_brick_size);
+        const Vector3i brick_items(m_brick_size, m_brick_size, m_brick_size);
+
+        return linear(m_bricks, brick.x, brick.y, brick.z) * get_brick_cells() +
+               linear(brick_items, i - brick.x * m_brick_size, j - brick.y * m_brick_size, k - brick.z * m_brick_size);
+    }
+
+    [[nodiscard]] int get_brick_cells() const {
+        return m_brick_size * m_brick_size * m_brick_size;
+    }
+
+    // Number of cells the buffers hold, including the padding of partial bricks.
+    [[nodiscard]] int get_capacity() const {
+        return m_bricks.x * m_bricks.y * m_bricks.z * get_brick_cells();
+    }
+};
+
+}
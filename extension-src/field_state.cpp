@@ -0,0 +1,102 @@
+#include "field_state.h"
+
+#include "godot_cpp/classes/file_access.hpp"
+
+using namespace godot;
+
+Error FieldState::save(const String& path, const bool compressed) const {
+    const Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+    ERR_FAIL_COND_V_MSG(file.is_null(), FileAccess::get_open_error(), "Can't open " + path + " for writing.");
+
+    file->store_32(MAGIC);
+    file->store_32(VERSION);
+    file->store_32(compressed ? FLAG_COMPRESSED : 0);
+    file->store_32(static_cast<uint32_t>(field_size.x));
+    file->store_32(static_cast<uint32_t>(field_size.y));
+    file->store_32(static_cast<uint32_t>(field_size.z));
+    file->store_float(cell_size);
+    file->store_32(precision);
+    file->store_32(layout);
+    file->store_32(static_cast<uint32_t>(wrap_offset.x));
+    file->store_32(static_cast<uint32_t>(wrap_offset.y));
+    file->store_32(static_cast<uint32_t>(wrap_offset.z));
+    file->store_32(SECTION_MAX);
+
+    for (uint32_t id = 0; id < SECTION_MAX; ++id) {
+        const PackedByteArray& bytes = sections[id];
+        const PackedByteArray stored = compressed ? bytes.compress(FileAccess::COMPRESSION_ZSTD) : bytes;
+
+        file->store_32(id);
+        file->store_64(static_cast<uint64_t>(bytes.size()));
+        file->store_64(static_cast<uint64_t>(stored.size()));
+        file->store_buffer(stored);
+    }
+
+    return file->get_error();
+}
+
+Error FieldState::load(const String& path) {
+    const Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ);
+    ERR_FAIL_COND_V_MSG(file.is_null(), FileAccess::get_open_error(), "Can't open " + path + " for reading.");
+
+    ERR_FAIL_COND_V_MSG(file->get_32() != MAGIC, ERR_FILE_UNRECOGNIZED, path + " is not a force field state.");
+
+    const uint32_t version = file->get_32();
+    ERR_FAIL_COND_V_MSG(version == 0 || version > VERSION, ERR_FILE_UNRECOGNIZED,
+        path + " has state version " + String::num_int64(version) + ", this build reads up to " + String::num_int64(VERSION) + ".");
+
+    const bool compressed = (file->get_32() & FLAG_COMPRESSED) != 0;
+
+    field_size.x = static_cast<int32_t>(file->get_32());
+    field_size.y = static_cast<int32_t>(file->get_32());
+    field_size.z = static_cast<int32_t>(file->get_32());
+    cell_size = file->get_float();
+    precision = file->get_32();
+    layout = file->get_32();
+
+    // Every field is made of whole 8^3 bricks, see FieldIndex.
+    ERR_FAIL_COND_V_MSG(field_size.x <= 0 || field_size.y <= 0 || field_size.z <= 0 ||
+            field_size.x % 8 != 0 || field_size.y % 8 != 0 || field_size.z % 8 != 0,
+        ERR_FILE_CORRUPT, path + " has an invalid field size " + String(field_size) + ".");
+    ERR_FAIL_COND_V_MSG(!(cell_size > 0.0f), ERR_FILE_CORRUPT, path + " has an invalid cell size.");
+
+    // Version 1 states come from fields that didn't scroll.
+    if (version >= 2) {
+        wrap_offset.x = static_cast<int32_t>(file->get_32());
+        wrap_offset.y = static_cast<int32_t>(file->get_32());
+        wrap_offset.z = static_cast<int32_t>(file->get_32());
+    }
+
+    const uint32_t section_count = file->get_32();
+    bool present[SECTION_MAX] = {};
+
+    for (uint32_t i = 0; i < section_count; ++i) {
+        const uint32_t id = file->get_32();
+        const uint64_t size = file->get_64();
+        const uint64_t stored_size = file->get_64();
+
+        // Sections of later versions are skipped.
+        if (id >= SECTION_MAX) {
+            file->seek(file->get_position() + stored_size);
+            continue;
+        }
+
+        PackedByteArray bytes = file->get_buffer(static_cast<int64_t>(stored_size));
+        ERR_FAIL_COND_V_MSG(static_cast<uint64_t>(bytes.size()) != stored_size, ERR_FILE_CORRUPT, path + " is truncated.");
+
+        if (compressed) {
+            bytes = bytes.decompress(static_cast<int64_t>(size), FileAccess::COMPRESSION_ZSTD);
+        }
+
+        ERR_FAIL_COND_V_MSG(static_cast<uint64_t>(bytes.size()) != size, ERR_FILE_CORRUPT, path + " has a corrupt section.");
+
+        sections[id] = bytes;
+        present[id] = true;
+    }
+
+    for (const bool section : present) {
+        ERR_FAIL_COND_V_MSG(!section, ERR_FILE_CORRUPT, path + " is missing a section.");
+    }
+
+    return OK;
+}
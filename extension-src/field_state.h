@@ -0,0 +1,49 @@
+#pragma once
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+
+namespace godot {
+
+// Snapshot of the simulation buffers of a field, as written by ForceField::save_state(). The buffers are stored
+// byte for byte in the precision and cell order of the field, so a snapshot loads straight back into the storage
+// buffers of a field with the same precision and layout.
+//
+// File layout, little endian:
+//   "FFST", version, flags, field size (3 x int32), cell size (float), precision, layout, wrap offset (3 x int32,
+//   since version 2), section count, then per section: id, size (uint64), stored size (uint64) and the stored bytes.
+// With FLAG_COMPRESSED every section is compressed on its own with zstd.
+class FieldState {
+public:
+    static constexpr uint32_t MAGIC = 0x54534646; // "FFST"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t FLAG_COMPRESSED = 1;
+
+    enum Section : uint32_t {
+        SECTION_VELOCITY_U,
+        SECTION_VELOCITY_V,
+        SECTION_VELOCITY_W,
+        SECTION_PRESSURE,
+        SECTION_SOLID,
+        SECTION_STATIC_SOLID,
+        SECTION_MAX,
+    };
+
+    Vector3i field_size;
+    float cell_size { 0.0 };
+    // ForceField::Precision and ForceField::FieldLayout.
+    uint32_t precision { 0 };
+    uint32_t layout { 0 };
+    // Where the window of a scrolling field starts in the buffers, see ForceField::scroll_target.
+    Vector3i wrap_offset;
+    PackedByteArray sections[SECTION_MAX];
+
+    [[nodiscard]] Error save(const String& path, bool compressed) const;
+    // Every section must be present.
+    [[nodiscard]] Error load(const String& path);
+};
+
+}
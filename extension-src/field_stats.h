@@ -0,0 +1,97 @@
+#pragma once
+
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace godot {
+
+// Summary of the simulation fields over the fluid cells, in the record layout shaders/field_stats.glsl reduces to:
+// min, max and sum of u, v, w and pressure, then kinetic energy, max |divergence|, max |face velocity| and the
+// number of fluid cells. The CPU solver fills the same record cell by cell.
+class FieldStats {
+public:
+    static constexpr int COLUMNS = 4;
+    static constexpr int SIZE = COLUMNS * 16;
+
+    FieldStats() {
+        constexpr float float_max = std::numeric_limits<float>::max();
+
+        m_values.fill(0.0f);
+
+        for (int c = 0; c < 4; ++c) {
+            m_values[COLUMN_MIN + c] = float_max;
+            m_values[COLUMN_MAX + c] = -float_max;
+        }
+    }
+
+    [[nodiscard]] static FieldStats from_bytes(const PackedByteArray& bytes) {
+        FieldStats stats;
+        const PackedFloat32Array values = bytes.to_float32_array();
+
+        for (int i = 0; i < std::min<int>(values.size(), COLUMNS * 4); ++i) {
+            stats.m_values[i] = values[i];
+        }
+
+        return stats;
+    }
+
+    // values holds u, v, w and pressure of the cell.
+    void add_cell(const float (&values)[4], float energy, float divergence, float face_speed) {
+        for (int c = 0; c < 4; ++c) {
+            m_values[COLUMN_MIN + c] = std::min(m_values[COLUMN_MIN + c], values[c]);
+            m_values[COLUMN_MAX + c] = std::max(m_values[COLUMN_MAX + c], values[c]);
+            m_values[COLUMN_SUM + c] += values[c];
+        }
+
+        m_values[KINETIC_ENERGY] += energy;
+        m_values[MAX_DIVERGENCE] = std::max(m_values[MAX_DIVERGENCE], divergence);
+        m_values[MAX_FACE_SPEED] = std::max(m_values[MAX_FACE_SPEED], face_speed);
+        m_values[FLUID_CELLS] += 1.0f;
+    }
+
+    [[nodiscard]] float get_max_face_speed() const {
+        return m_values[MAX_FACE_SPEED];
+    }
+
+    // The CFL number is the largest distance a face moves in one step, in cells.
+    [[nodiscard]] Dictionary to_dictionary(float delta_time, float cell_size) const {
+        static constexpr const char* names[4] = { "u", "v", "w", "pressure" };
+
+        const float cells = m_values[FLUID_CELLS];
+        Dictionary stats;
+
+        for (int c = 0; c < 4; ++c) {
+            const String name = names[c];
+
+            stats[name + "_min"] = cells > 0.0f ? m_values[COLUMN_MIN + c] : 0.0f;
+            stats[name + "_max"] = cells > 0.0f ? m_values[COLUMN_MAX + c] : 0.0f;
+            stats[name + "_mean"] = cells > 0.0f ? m_values[COLUMN_SUM + c] / cells : 0.0f;
+        }
+
+        stats["kinetic_energy"] = m_values[KINETIC_ENERGY];
+        stats["max_divergence"] = m_values[MAX_DIVERGENCE];
+        stats["max_cfl"] = cell_size > 0.0f ? m_values[MAX_FACE_SPEED] * delta_time / cell_size : 0.0f;
+        stats["fluid_cells"] = static_cast<int64_t>(std::lround(cells));
+
+        return stats;
+    }
+
+private:
+    static constexpr int COLUMN_MIN = 0;
+    static constexpr int COLUMN_MAX = 4;
+    static constexpr int COLUMN_SUM = 8;
+    static constexpr int KINETIC_ENERGY = 12;
+    static constexpr int MAX_DIVERGENCE = 13;
+    static constexpr int MAX_FACE_SPEED = 14;
+    static constexpr int FLUID_CELLS = 15;
+
+    std::array<float, COLUMNS * 4> m_values;
+};
+
+}
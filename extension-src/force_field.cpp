@@ -3,16 +3,28 @@
 #include <godot_cpp/classes/rendering_server.hpp>
 #include <godot_cpp/classes/rendering_device.hpp>
 
-#include "godot_cpp/classes/rd_shader_file.hpp"
-#include "godot_cpp/classes/resource_loader.hpp"
 #include "godot_cpp/classes/rd_texture_format.hpp"
 #include "godot_cpp/classes/rd_texture_view.hpp"
 #include "godot_cpp/classes/rd_uniform.hpp"
 #include "godot_cpp/variant/typed_array.hpp"
 
-#include "godot_cpp/classes/rd_shader_spirv.hpp"
 #include "godot_cpp/classes/input_event.hpp"
 #include "godot_cpp/classes/input_event_key.hpp"
+#include "godot_cpp/classes/image.hpp"
+#include "godot_cpp/classes/time.hpp"
+#include "godot_cpp/classes/performance.hpp"
+#include "godot_cpp/classes/box_shape3d.hpp"
+#include "godot_cpp/classes/capsule_shape3d.hpp"
+#include "godot_cpp/classes/collision_shape3d.hpp"
+#include "godot_cpp/classes/cylinder_shape3d.hpp"
+#include "godot_cpp/classes/mesh_instance3d.hpp"
+#include "godot_cpp/classes/sphere_shape3d.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 
 using namespace godot;
 
@@ -27,6 +39,13 @@ void ForceField::_bind_methods() {
 
     ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cell_size"), "set_cell_size", "get_cell_size");
 
+    ClassDB::bind_method(D_METHOD("resize", "field_size", "cell_size"), &ForceField::resize);
+
+    ClassDB::bind_method(D_METHOD("save_state", "path", "compressed"), &ForceField::save_state, DEFVAL(false));
+    ClassDB::bind_method(D_METHOD("load_state", "path"), &ForceField::load_state);
+
+    ClassDB::bind_static_method("ForceField", D_METHOD("get_shader_cache_stats"), &ForceField::get_shader_cache_stats);
+
     ClassDB::bind_method(D_METHOD("get_texture"), &ForceField::get_texture);
     ClassDB::bind_method(D_METHOD("set_texture"), &ForceField::set_texture);
 
@@ -48,6 +67,212 @@ void ForceField::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_emitter_velocity", "emitter_max"), &ForceField::set_emitter_velocity);
 
     ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "emitter_velocity"), "set_emitter_velocity", "get_emitter_velocity");
+
+    ClassDB::bind_method(D_METHOD("get_emitters"), &ForceField::get_emitters);
+    ClassDB::bind_method(D_METHOD("set_emitters", "emitters"), &ForceField::set_emitters);
+
+    ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "emitters", PROPERTY_HINT_ARRAY_TYPE, "ForceFieldEmitter"), "set_emitters", "get_emitters");
+
+    ClassDB::bind_method(D_METHOD("get_obstacles"), &ForceField::get_obstacles);
+    ClassDB::bind_method(D_METHOD("set_obstacles", "obstacles"), &ForceField::set_obstacles);
+
+    ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "obstacles", PROPERTY_HINT_TYPE_STRING,
+        String::num_int64(Variant::NODE_PATH) + "/" + String::num_int64(PROPERTY_HINT_NODE_PATH_VALID_TYPES) + ":CollisionShape3D,MeshInstance3D"),
+        "set_obstacles", "get_obstacles");
+
+    ClassDB::bind_method(D_METHOD("get_scroll_target"), &ForceField::get_scroll_target);
+    ClassDB::bind_method(D_METHOD("set_scroll_target", "target"), &ForceField::set_scroll_target);
+
+    ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "scroll_target", PROPERTY_HINT_NODE_PATH_VALID_TYPES, "Node3D"),
+        "set_scroll_target", "get_scroll_target");
+
+    ClassDB::bind_method(D_METHOD("get_parent_field"), &ForceField::get_parent_field);
+    ClassDB::bind_method(D_METHOD("set_parent_field", "field"), &ForceField::set_parent_field);
+
+    ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "parent_field", PROPERTY_HINT_NODE_PATH_VALID_TYPES, "ForceField"),
+        "set_parent_field", "get_parent_field");
+
+    ClassDB::bind_method(D_METHOD("get_backend"), &ForceField::get_backend);
+    ClassDB::bind_method(D_METHOD("set_backend", "backend"), &ForceField::set_backend);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "backend", PROPERTY_HINT_ENUM, "GPU,CPU"), "set_backend", "get_backend");
+
+    ClassDB::bind_method(D_METHOD("get_simulation_device"), &ForceField::get_simulation_device);
+    ClassDB::bind_method(D_METHOD("set_simulation_device", "device"), &ForceField::set_simulation_device);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "simulation_device", PROPERTY_HINT_ENUM, "Main,Local"), "set_simulation_device", "get_simulation_device");
+
+    ClassDB::bind_method(D_METHOD("get_cpu_thread_count"), &ForceField::get_cpu_thread_count);
+    ClassDB::bind_method(D_METHOD("set_cpu_thread_count", "count"), &ForceField::set_cpu_thread_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "cpu_thread_count", PROPERTY_HINT_RANGE, "0,256"), "set_cpu_thread_count", "get_cpu_thread_count");
+
+    ClassDB::bind_method(D_METHOD("get_cpu_texture"), &ForceField::get_cpu_texture);
+    ClassDB::bind_method(D_METHOD("set_cpu_texture", "texture"), &ForceField::set_cpu_texture);
+
+    ADD_PROPERTY(
+        PropertyInfo(Variant::OBJECT, "cpu_texture", PROPERTY_HINT_RESOURCE_TYPE, "ImageTexture3D"), "set_cpu_texture", "get_cpu_texture");
+
+    ClassDB::bind_method(D_METHOD("get_field_data"), &ForceField::get_field_data);
+
+    ClassDB::bind_method(D_METHOD("get_benchmark_mode"), &ForceField::get_benchmark_mode);
+    ClassDB::bind_method(D_METHOD("set_benchmark_mode", "enabled"), &ForceField::set_benchmark_mode);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "benchmark_mode"), "set_benchmark_mode", "get_benchmark_mode");
+
+    ClassDB::bind_method(D_METHOD("get_benchmark_results"), &ForceField::get_benchmark_results);
+
+    ClassDB::bind_method(D_METHOD("get_pass_profiling"), &ForceField::get_pass_profiling);
+    ClassDB::bind_method(D_METHOD("set_pass_profiling", "enabled"), &ForceField::set_pass_profiling);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "pass_profiling"), "set_pass_profiling", "get_pass_profiling");
+
+    ClassDB::bind_method(D_METHOD("get_pass_timings"), &ForceField::get_pass_timings);
+    ClassDB::bind_method(D_METHOD("get_step_traffic", "fused"), &ForceField::get_step_traffic);
+
+    ClassDB::bind_method(D_METHOD("sample_velocities", "points"), &ForceField::sample_velocities);
+
+    ClassDB::bind_method(D_METHOD("get_field_stats"), &ForceField::get_field_stats);
+
+    ADD_SIGNAL(MethodInfo("velocities_sampled", PropertyInfo(Variant::PACKED_VECTOR3_ARRAY, "points"),
+        PropertyInfo(Variant::PACKED_VECTOR3_ARRAY, "velocities")));
+
+    ClassDB::bind_method(D_METHOD("get_time_step"), &ForceField::get_time_step);
+    ClassDB::bind_method(D_METHOD("set_time_step", "time_step"), &ForceField::set_time_step);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "time_step", PROPERTY_HINT_RANGE, "0.001,0.1,0.001,suffix:s"), "set_time_step", "get_time_step");
+
+    ClassDB::bind_method(D_METHOD("get_max_substeps"), &ForceField::get_max_substeps);
+    ClassDB::bind_method(D_METHOD("set_max_substeps", "substeps"), &ForceField::set_max_substeps);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_substeps", PROPERTY_HINT_RANGE, "1,16"), "set_max_substeps", "get_max_substeps");
+
+    ClassDB::bind_method(D_METHOD("get_adaptive_time_step"), &ForceField::get_adaptive_time_step);
+    ClassDB::bind_method(D_METHOD("set_adaptive_time_step", "enabled"), &ForceField::set_adaptive_time_step);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "adaptive_time_step"), "set_adaptive_time_step", "get_adaptive_time_step");
+
+    ClassDB::bind_method(D_METHOD("get_cfl_target"), &ForceField::get_cfl_target);
+    ClassDB::bind_method(D_METHOD("set_cfl_target", "target"), &ForceField::set_cfl_target);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "cfl_target", PROPERTY_HINT_RANGE, "0.1,5.0,0.1"), "set_cfl_target", "get_cfl_target");
+
+    ClassDB::bind_method(D_METHOD("get_last_time_step"), &ForceField::get_last_time_step);
+    ClassDB::bind_method(D_METHOD("get_last_substep_count"), &ForceField::get_last_substep_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "last_time_step", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_last_time_step");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "last_substep_count", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_last_substep_count");
+
+    ClassDB::bind_method(D_METHOD("get_max_iterations"), &ForceField::get_max_iterations);
+    ClassDB::bind_method(D_METHOD("set_max_iterations", "iterations"), &ForceField::set_max_iterations);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_iterations", PROPERTY_HINT_RANGE, "2,1000"), "set_max_iterations", "get_max_iterations");
+
+    ClassDB::bind_method(D_METHOD("get_tolerance"), &ForceField::get_tolerance);
+    ClassDB::bind_method(D_METHOD("set_tolerance", "tolerance"), &ForceField::set_tolerance);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "tolerance", PROPERTY_HINT_RANGE, "0,1,0.00001,or_greater"), "set_tolerance", "get_tolerance");
+
+    ClassDB::bind_method(D_METHOD("get_residual_check_interval"), &ForceField::get_residual_check_interval);
+    ClassDB::bind_method(D_METHOD("set_residual_check_interval", "interval"), &ForceField::set_residual_check_interval);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "residual_check_interval", PROPERTY_HINT_RANGE, "2,100,2"), "set_residual_check_interval", "get_residual_check_interval");
+
+    ClassDB::bind_method(D_METHOD("get_last_residual"), &ForceField::get_last_residual);
+    ClassDB::bind_method(D_METHOD("get_last_residual_l2"), &ForceField::get_last_residual_l2);
+    ClassDB::bind_method(D_METHOD("get_last_iteration_count"), &ForceField::get_last_iteration_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "last_residual", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_last_residual");
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "last_residual_l2", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_last_residual_l2");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "last_iteration_count", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_last_iteration_count");
+
+    ClassDB::bind_method(D_METHOD("get_precision"), &ForceField::get_precision);
+    ClassDB::bind_method(D_METHOD("set_precision", "precision"), &ForceField::set_precision);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "precision", PROPERTY_HINT_ENUM, "FP32,FP16"), "set_precision", "get_precision");
+
+    ClassDB::bind_method(D_METHOD("get_precision_error_report", "steps"), &ForceField::get_precision_error_report, DEFVAL(60));
+
+    ClassDB::bind_method(D_METHOD("get_field_layout"), &ForceField::get_field_layout);
+    ClassDB::bind_method(D_METHOD("set_field_layout", "layout"), &ForceField::set_field_layout);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "field_layout", PROPERTY_HINT_ENUM, "Linear,Brick 4,Brick 8"), "set_field_layout", "get_field_layout");
+
+    ClassDB::bind_method(D_METHOD("get_over_relaxation"), &ForceField::get_over_relaxation);
+    ClassDB::bind_method(D_METHOD("set_over_relaxation", "factor"), &ForceField::set_over_relaxation);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "over_relaxation", PROPERTY_HINT_RANGE, "1.0,1.99,0.01"), "set_over_relaxation", "get_over_relaxation");
+
+    ClassDB::bind_method(D_METHOD("get_density"), &ForceField::get_density);
+    ClassDB::bind_method(D_METHOD("set_density", "density"), &ForceField::set_density);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "density", PROPERTY_HINT_RANGE, "0.001,10000,0.001,or_greater"), "set_density", "get_density");
+
+    ClassDB::bind_method(D_METHOD("get_workgroup_size"), &ForceField::get_workgroup_size);
+    ClassDB::bind_method(D_METHOD("set_workgroup_size", "size"), &ForceField::set_workgroup_size);
+
+    ADD_PROPERTY(PropertyInfo(Variant::VECTOR3I, "workgroup_size"), "set_workgroup_size", "get_workgroup_size");
+
+    ClassDB::bind_method(D_METHOD("get_advection_shared_tiles"), &ForceField::get_advection_shared_tiles);
+    ClassDB::bind_method(D_METHOD("set_advection_shared_tiles", "enabled"), &ForceField::set_advection_shared_tiles);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "advection_shared_tiles"), "set_advection_shared_tiles", "get_advection_shared_tiles");
+
+    ClassDB::bind_method(D_METHOD("get_pressure_shared_tiles"), &ForceField::get_pressure_shared_tiles);
+    ClassDB::bind_method(D_METHOD("set_pressure_shared_tiles", "enabled"), &ForceField::set_pressure_shared_tiles);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "pressure_shared_tiles"), "set_pressure_shared_tiles", "get_pressure_shared_tiles");
+
+    ClassDB::bind_method(D_METHOD("get_fused_kernels"), &ForceField::get_fused_kernels);
+    ClassDB::bind_method(D_METHOD("set_fused_kernels", "enabled"), &ForceField::set_fused_kernels);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "fused_kernels"), "set_fused_kernels", "get_fused_kernels");
+
+    ClassDB::bind_method(D_METHOD("get_pressure_solver"), &ForceField::get_pressure_solver);
+    ClassDB::bind_method(D_METHOD("set_pressure_solver", "solver"), &ForceField::set_pressure_solver);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "pressure_solver", PROPERTY_HINT_ENUM, "Red-Black,Multigrid"), "set_pressure_solver", "get_pressure_solver");
+
+    ClassDB::bind_method(D_METHOD("get_multigrid_levels"), &ForceField::get_multigrid_levels);
+    ClassDB::bind_method(D_METHOD("set_multigrid_levels", "levels"), &ForceField::set_multigrid_levels);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "multigrid_levels", PROPERTY_HINT_RANGE, "1,8"), "set_multigrid_levels", "get_multigrid_levels");
+
+    ClassDB::bind_method(D_METHOD("get_multigrid_cycles"), &ForceField::get_multigrid_cycles);
+    ClassDB::bind_method(D_METHOD("set_multigrid_cycles", "cycles"), &ForceField::set_multigrid_cycles);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "multigrid_cycles", PROPERTY_HINT_RANGE, "1,16"), "set_multigrid_cycles", "get_multigrid_cycles");
+
+    ClassDB::bind_method(D_METHOD("get_multigrid_smoothing_iterations"), &ForceField::get_multigrid_smoothing_iterations);
+    ClassDB::bind_method(D_METHOD("set_multigrid_smoothing_iterations", "iterations"), &ForceField::set_multigrid_smoothing_iterations);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "multigrid_smoothing_iterations", PROPERTY_HINT_RANGE, "2,32,2"), "set_multigrid_smoothing_iterations", "get_multigrid_smoothing_iterations");
+
+    ClassDB::bind_method(D_METHOD("get_sparse_bricks"), &ForceField::get_sparse_bricks);
+    ClassDB::bind_method(D_METHOD("set_sparse_bricks", "enabled"), &ForceField::set_sparse_bricks);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "sparse_bricks"), "set_sparse_bricks", "get_sparse_bricks");
+
+    ClassDB::bind_method(D_METHOD("get_activity_threshold"), &ForceField::get_activity_threshold);
+    ClassDB::bind_method(D_METHOD("set_activity_threshold", "threshold"), &ForceField::set_activity_threshold);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "activity_threshold", PROPERTY_HINT_RANGE, "0,0.1,0.00001,or_greater"), "set_activity_threshold", "get_activity_threshold");
+
+    ClassDB::bind_method(D_METHOD("get_active_brick_count"), &ForceField::get_active_brick_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "active_brick_count", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_active_brick_count");
+
+    BIND_ENUM_CONSTANT(BACKEND_GPU);
+    BIND_ENUM_CONSTANT(BACKEND_CPU);
+    BIND_ENUM_CONSTANT(SIMULATION_DEVICE_MAIN);
+    BIND_ENUM_CONSTANT(SIMULATION_DEVICE_LOCAL);
+    BIND_ENUM_CONSTANT(PRECISION_FP32);
+    BIND_ENUM_CONSTANT(PRECISION_FP16);
+    BIND_ENUM_CONSTANT(FIELD_LAYOUT_LINEAR);
+    BIND_ENUM_CONSTANT(FIELD_LAYOUT_BRICK4);
+    BIND_ENUM_CONSTANT(FIELD_LAYOUT_BRICK8);
+    BIND_ENUM_CONSTANT(PRESSURE_SOLVER_RED_BLACK);
+    BIND_ENUM_CONSTANT(PRESSURE_SOLVER_MULTIGRID);
 }
 
 ForceField::ForceField() {
@@ -55,394 +280,3507 @@ ForceField::ForceField() {
 
     m_field_size = Vector3i(32, 32, 32);
     m_cell_size = 0.2;
+    m_requested_field_size = m_field_size;
+    m_requested_cell_size = m_cell_size;
+}
+
+void ForceField::_notification(int what) {
+    if (what != NOTIFICATION_PREDELETE || m_backend != BACKEND_GPU) {
+        return;
+    }
+
+    // Runs what is still queued for the local device, after that only this thread touches it.
+    m_simulation_thread.stop();
+
+    if (!m_compute_ready) {
+        return;
+    }
+
+    RenderingServer* rendering_server = RenderingServer::get_singleton();
+
+    // Lets the steps and resizes still queued for this field finish, after that nothing else touches its
+    // resources and they can be gathered here. They are freed on the render thread once this object is gone.
+    rendering_server->force_sync();
+
+    if (m_texture.is_valid()) {
+        m_texture->set_texture_rd_rid(RID());
+    }
+
+    // Sets on a parent's buffers may be gone already, they are only freed if not.
+    rendering_server->call_on_render_thread(callable_mp_static(&ForceField::free_nest_parent_sets).bind(take_nest_parent_sets()));
+
+    // Uniform sets first, freeing a buffer they use would free them as well.
+    Array rids;
+
+    for (const RID& uniform_set : m_uniform_sets) {
+        rids.push_back(uniform_set);
+    }
+
+    rids.push_back(m_rd_texture);
+    m_buffer_pool.take_all(rids);
+
+    Array shaders;
+    Array pipelines;
+
+    for (const ShaderCache::Program& program : m_programs) {
+        shaders.push_back(program.shader);
+        pipelines.push_back(program.pipeline);
+    }
+
+    m_uniform_sets.clear();
+    m_programs.clear();
+    m_rd_texture = RID();
+    m_compute_ready = false;
+
+    if (m_local_device != nullptr) {
+        free_device_resources(m_local_device, rids, shaders, pipelines);
+        memdelete(m_local_device);
+        m_local_device = nullptr;
+
+        // Only the display textures live on the main device.
+        rids.clear();
+        shaders.clear();
+        pipelines.clear();
+
+        for (RID& texture : m_display_textures) {
+            if (texture.is_valid()) {
+                rids.push_back(texture);
+                texture = RID();
+            }
+        }
+    }
+
+    rendering_server->call_on_render_thread(callable_mp_static(&ForceField::free_compute_resources).bind(rids, shaders, pipelines));
+}
+
+void ForceField::free_compute_resources(const Array& rids, const Array& shaders, const Array& pipelines) {
+    free_device_resources(RenderingServer::get_singleton()->get_rendering_device(), rids, shaders, pipelines);
+}
+
+void ForceField::free_device_resources(RenderingDevice* device, const Array& rids, const Array& shaders, const Array& pipelines) {
+    for (int64_t i = 0; i < rids.size(); ++i) {
+        device->free_rid(rids[i]);
+    }
+
+    for (int64_t i = 0; i < shaders.size(); ++i) {
+        ShaderCache::get_singleton().release(device, ShaderCache::Program { shaders[i], pipelines[i] });
+    }
+}
+
+void ForceField::_enter_tree() {
+    add_pass_monitors();
+}
+
+void ForceField::_exit_tree() {
+    remove_pass_monitors();
+    unlink_parent();
+}
+
+void ForceField::_ready() {
+    UtilityFunctions::print("ForceField Ready");
+
+    if (m_backend == BACKEND_CPU) {
+        init_cpu();
+        return;
+    }
+
+    if (m_simulation_device == SIMULATION_DEVICE_LOCAL) {
+        m_simulation_thread.start();
+    }
+
+    call_on_simulation_thread(callable_mp(this, &ForceField::init_compute));
+}
+
+void ForceField::_process(double delta) {
+    if (!m_compute_ready) {
+        return;
+    }
+
+    if (m_emitters_dirty) {
+        update_emitters();
+    }
+
+    if (m_backend == BACKEND_GPU) {
+        const std::vector<ObstacleList::Region> exposed = update_scroll();
+        update_obstacles(delta, exposed);
+        update_nest_link();
+    }
+
+    if (uses_local_device()) {
+        present_local_output();
+
+        // The local device is still working on an earlier frame. Nothing waits for it, the time is carried over
+        // to the next frame that finds it idle, at most max_substeps steps of it.
+        if (!m_simulation_thread.is_idle()) {
+            const double max_time = m_max_substeps * static_cast<double>(m_last_time_step);
+            m_time_accumulator = std::min(m_time_accumulator + delta, max_time);
+            return;
+        }
+    }
+
+    // Fixed steps are taken out of the real frame time, so the simulation keeps pace with the clock whatever
+    // the frame rate. Time beyond max_substeps steps is dropped rather than carried into later frames.
+    const float step = get_step_size();
+    m_time_accumulator += delta;
+
+    int substeps = static_cast<int>(m_time_accumulator / step);
+
+    if (substeps > m_max_substeps) {
+        substeps = m_max_substeps;
+        m_time_accumulator = std::fmod(m_time_accumulator, static_cast<double>(step));
+    } else {
+        m_time_accumulator -= substeps * static_cast<double>(step);
+    }
+
+    m_last_time_step = step;
+    m_last_substep_count = substeps;
+
+    for (int i = 0; i < substeps; ++i) {
+        if (m_backend == BACKEND_CPU) {
+            run_cpu(step);
+            continue;
+        }
+
+        // Only the last substep of a frame writes the texture.
+        call_on_simulation_thread(callable_mp(this, &ForceField::run_compute).bind(step, i == substeps - 1));
+    }
+
+    if (uses_local_device() && substeps > 0) {
+        call_on_simulation_thread(callable_mp(this, &ForceField::finish_local_frame));
+    }
+}
+
+float ForceField::get_step_size() {
+    if (!m_adaptive_time_step) {
+        return m_time_step;
+    }
+
+    float max_face_speed;
+
+    if (m_backend == BACKEND_CPU) {
+        max_face_speed = m_cpu_solver.compute_stats().get_max_face_speed();
+    } else {
+        // Keeps the stats record coming, each step size uses the most recent one.
+        m_field_stats_requested = true;
+
+        std::lock_guard lock(m_field_stats_mutex);
+        max_face_speed = m_max_face_speed;
+    }
+
+    if (max_face_speed <= 0.0f) {
+        return m_time_step;
+    }
+
+    return std::clamp(m_cfl_target * m_requested_cell_size / max_face_speed, MIN_TIME_STEP, m_time_step);
+}
+
+void ForceField::_input(const Ref<InputEvent>& event) {
+    if (event->is_class("InputEventKey")) {
+        Ref<InputEventKey> event_key = event;
+
+        if (event_key->is_pressed() && event_key->get_keycode() == KEY_D) {
+            UtilityFunctions::print("Debug Key pressed.");
+            m_print_debug_info = true;
+        }
+    }
+}
+
+Vector3i ForceField::get_field_size() const {
+    return m_requested_field_size;
+}
+
+void ForceField::set_field_size(Vector3i size) {
+    resize(size, m_requested_cell_size);
+}
+
+float ForceField::get_cell_size() const {
+    return m_requested_cell_size;
+}
+
+void ForceField::set_cell_size(float size) {
+    resize(m_requested_field_size, size);
+}
+
+Error ForceField::save_state(const String& path, bool compressed) {
+    ERR_FAIL_COND_V_MSG(m_backend != BACKEND_GPU, ERR_UNAVAILABLE, "Field states are only available on the GPU backend.");
+    ERR_FAIL_COND_V_MSG(!m_compute_ready, ERR_UNCONFIGURED, "The field has to be in the tree and started to save its state.");
+
+    call_on_simulation_thread(callable_mp(this, &ForceField::read_state));
+    wait_for_simulation_thread();
+
+    FieldState state;
+
+    {
+        std::lock_guard lock(m_state_mutex);
+        state = m_saved_state;
+        m_saved_state = FieldState();
+    }
+
+    return state.save(path, compressed);
+}
+
+Error ForceField::load_state(const String& path) {
+    ERR_FAIL_COND_V_MSG(m_backend != BACKEND_GPU, ERR_UNAVAILABLE, "Field states are only available on the GPU backend.");
+
+    FieldState state;
+    const Error error = state.load(path);
+
+    if (error != OK) {
+        return error;
+    }
+
+    ERR_FAIL_COND_V_MSG(state.precision != static_cast<uint32_t>(m_storage_precision) || state.layout != static_cast<uint32_t>(m_field_layout),
+        ERR_INVALID_DATA, path + " was saved with a different precision or field layout.");
+    ERR_FAIL_COND_V_MSG(!fits_device(state.field_size), ERR_INVALID_DATA,
+        path + " has a field of " + String(state.field_size) + " cells, more than this device holds.");
+
+    // Queued before the state is handed over, so it arrives on a grid of its size.
+    resize(state.field_size, state.cell_size);
+
+    std::lock_guard lock(m_state_mutex);
+    m_pending_state = state;
+    m_has_pending_state = true;
+
+    return OK;
+}
+
+void ForceField::read_state() {
+    FieldState state;
+    state.field_size = m_field_size;
+    state.cell_size = m_cell_size;
+    state.precision = m_storage_precision;
+    state.layout = m_field_layout;
+    state.wrap_offset = m_wrap_offset;
+
+    // Only the cells, the pool rounds the buffers up.
+    const uint32_t field_bytes = get_field_buffer_size();
+    const uint32_t solid_bytes = get_field_index().get_capacity() * 4;
+
+    state.sections[FieldState::SECTION_VELOCITY_U] = m_device->buffer_get_data(m_velocity_buffers2.u, 0, field_bytes);
+    state.sections[FieldState::SECTION_VELOCITY_V] = m_device->buffer_get_data(m_velocity_buffers2.v, 0, field_bytes);
+    state.sections[FieldState::SECTION_VELOCITY_W] = m_device->buffer_get_data(m_velocity_buffers2.w, 0, field_bytes);
+    state.sections[FieldState::SECTION_PRESSURE] = m_device->buffer_get_data(m_pressure_buffer, 0, field_bytes);
+    state.sections[FieldState::SECTION_SOLID] = m_device->buffer_get_data(m_solid_buffer, 0, solid_bytes);
+    state.sections[FieldState::SECTION_STATIC_SOLID] = m_device->buffer_get_data(m_static_solid_buffer, 0, solid_bytes);
+
+    std::lock_guard lock(m_state_mutex);
+    m_saved_state = state;
+}
+
+void ForceField::apply_pending_state() {
+    FieldState state;
+
+    {
+        std::lock_guard lock(m_state_mutex);
+
+        // Steps queued before the resize to the state's grid leave it for a later one.
+        if (!m_has_pending_state || m_pending_state.field_size != m_field_size || m_pending_state.cell_size != m_cell_size) {
+            return;
+        }
+
+        state = m_pending_state;
+        m_pending_state = FieldState();
+        m_has_pending_state = false;
+    }
+
+    const int64_t field_bytes = get_field_buffer_size();
+    const int64_t solid_bytes = get_field_index().get_capacity() * 4;
+
+    for (uint32_t section = 0; section < FieldState::SECTION_MAX; ++section) {
+        const int64_t expected = section < FieldState::SECTION_SOLID ? field_bytes : solid_bytes;
+        ERR_FAIL_COND_MSG(state.sections[section].size() != expected, "Field state doesn't match the buffers of the field.");
+    }
+
+    // The file contents go into the buffers as they are. Both velocity buffers get them, in sparse mode the
+    // inactive bricks of either aren't rewritten.
+    const auto upload = [this](const RID& buffer, const PackedByteArray& bytes) {
+        m_device->buffer_update(buffer, 0, bytes.size(), bytes);
+    };
+
+    for (const VelocityBuffers* velocity : { &m_velocity_buffers1, &m_velocity_buffers2 }) {
+        upload(velocity->u, state.sections[FieldState::SECTION_VELOCITY_U]);
+        upload(velocity->v, state.sections[FieldState::SECTION_VELOCITY_V]);
+        upload(velocity->w, state.sections[FieldState::SECTION_VELOCITY_W]);
+    }
+
+    upload(m_pressure_buffer, state.sections[FieldState::SECTION_PRESSURE]);
+    upload(m_solid_buffer, state.sections[FieldState::SECTION_SOLID]);
+    upload(m_static_solid_buffer, state.sections[FieldState::SECTION_STATIC_SOLID]);
+    update_wrap_offset(state.wrap_offset);
+    m_solid_mask_dirty = true;
+}
+
+void ForceField::wait_for_simulation_thread() {
+    if (uses_local_device()) {
+        m_simulation_thread.wait();
+    } else {
+        RenderingServer::get_singleton()->force_sync();
+    }
+}
+
+Dictionary ForceField::get_shader_cache_stats() {
+    return ShaderCache::get_singleton().get_stats();
+}
+
+void ForceField::resize(Vector3i field_size, float cell_size) {
+    // The GPU backend keeps one set of buffers for the whole field, it isn't split into tiles like on the CPU.
+    ERR_FAIL_COND_MSG(m_backend == BACKEND_GPU && !fits_device(field_size),
+        "A field of " + String(field_size) + " cells is more than this device holds.");
+
+    m_requested_field_size = field_size;
+    m_requested_cell_size = cell_size;
+
+    if (!m_compute_ready) {
+        m_field_size = field_size;
+        m_cell_size = cell_size;
+        return;
+    }
+
+    if (m_backend == BACKEND_CPU) {
+        m_field_size = field_size;
+        m_cell_size = cell_size;
+        m_cpu_solver.resize(m_field_size, m_cell_size, create_solid_data(m_field_size, true), m_cpu_thread_count);
+        m_cpu_solver.set_emitters(build_emitter_list());
+        return;
+    }
+
+    // Steps already queued still run on the old grid.
+    call_on_simulation_thread(callable_mp(this, &ForceField::resize_compute).bind(field_size, cell_size));
+}
+
+Ref<Texture3DRD> ForceField::get_texture() const {
+    return m_texture;
 }
 
-void ForceField::_ready() {
-    UtilityFunctions::print("ForceField Ready");
+void ForceField::set_texture(const Ref<Texture3DRD> &texture) {
+    m_texture = texture;
+
+    texture->set_texture_rd_rid(uses_local_device() ? m_display_textures[m_display_front] : m_rd_texture);
+    UtilityFunctions::print("Setting texture rendering device resource on given texture.");
+}
+
+Vector3 ForceField::get_emitter_position_min() const {
+    return m_emitter_min;
+}
+
+void ForceField::set_emitter_position_min(const Vector3 pos) {
+    m_emitter_min = pos;
+    mark_emitters_dirty();
+}
+
+Vector3 ForceField::get_emitter_position_max() const {
+    return m_emitter_max;
+}
+
+void ForceField::set_emitter_position_max(Vector3 pos) {
+    m_emitter_max = pos;
+    mark_emitters_dirty();
+}
+
+Vector3 ForceField::get_emitter_velocity() const {
+    return m_emitter_velocity;
+}
+
+void ForceField::set_emitter_velocity(Vector3 velocity) {
+    m_emitter_velocity = velocity;
+    mark_emitters_dirty();
+}
+
+TypedArray<NodePath> ForceField::get_obstacles() const {
+    return m_obstacles;
+}
+
+void ForceField::set_obstacles(const TypedArray<NodePath>& obstacles) {
+    m_obstacles = obstacles;
+}
+
+NodePath ForceField::get_scroll_target() const {
+    return m_scroll_target;
+}
+
+void ForceField::set_scroll_target(const NodePath& target) {
+    m_scroll_target = target;
+}
+
+NodePath ForceField::get_parent_field() const {
+    return m_parent_field;
+}
+
+void ForceField::set_parent_field(const NodePath& field) {
+    m_parent_field = field;
+}
+
+TypedArray<ForceFieldEmitter> ForceField::get_emitters() const {
+    return m_emitters;
+}
+
+void ForceField::set_emitters(const TypedArray<ForceFieldEmitter>& emitters) {
+    const Callable changed = callable_mp(this, &ForceField::mark_emitters_dirty);
+
+    for (int i = 0; i < m_emitters.size(); ++i) {
+        const Ref<ForceFieldEmitter> emitter = m_emitters[i];
+
+        if (emitter.is_valid() && emitter->is_connected("changed", changed)) {
+            emitter->disconnect("changed", changed);
+        }
+    }
+
+    m_emitters = emitters;
+
+    // The same resource may be listed twice, it only needs one connection.
+    for (int i = 0; i < m_emitters.size(); ++i) {
+        const Ref<ForceFieldEmitter> emitter = m_emitters[i];
+
+        if (emitter.is_valid() && !emitter->is_connected("changed", changed)) {
+            emitter->connect("changed", changed);
+        }
+    }
+
+    mark_emitters_dirty();
+}
+
+ForceField::Backend ForceField::get_backend() const {
+    return m_backend;
+}
+
+void ForceField::set_backend(Backend backend) {
+    m_backend = backend;
+}
+
+ForceField::SimulationDevice ForceField::get_simulation_device() const {
+    return m_simulation_device;
+}
+
+void ForceField::set_simulation_device(SimulationDevice device) {
+    m_simulation_device = device;
+}
+
+int ForceField::get_cpu_thread_count() const {
+    return m_cpu_thread_count;
+}
+
+void ForceField::set_cpu_thread_count(int count) {
+    m_cpu_thread_count = count;
+}
+
+Ref<ImageTexture3D> ForceField::get_cpu_texture() const {
+    return m_cpu_texture;
+}
+
+void ForceField::set_cpu_texture(const Ref<ImageTexture3D> &texture) {
+    m_cpu_texture = texture;
+}
+
+bool ForceField::get_benchmark_mode() const {
+    return m_benchmark_mode;
+}
+
+void ForceField::set_benchmark_mode(bool enabled) {
+    m_benchmark_mode = enabled;
+}
+
+bool ForceField::get_pass_profiling() const {
+    return m_pass_profiling;
+}
+
+void ForceField::set_pass_profiling(bool enabled) {
+    if (enabled && !m_pass_profiling) {
+        m_pass_profiler.clear();
+    }
+
+    m_pass_profiling = enabled;
+}
+
+Dictionary ForceField::get_pass_timings() const {
+    return m_pass_profiler.get_timings();
+}
+
+Dictionary ForceField::get_step_traffic(bool fused) const {
+    // An estimate of the bytes the passes around the pressure solve move in a step that writes the texture, with
+    // every value read or written once. The solve itself is the same either way and left out.
+    const int64_t value = m_storage_precision == PRECISION_FP16 ? 2 : 4;
+    const int64_t texel = 4 * value;
+    const int64_t mask = 1;
+    const Vector3i size = m_requested_field_size;
+    const int64_t cells = static_cast<int64_t>(size.x) * size.y * size.z;
+    const int64_t active_cells = m_sparse_bricks
+        ? static_cast<int64_t>(m_active_brick_count) * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE
+        : cells;
+    const int64_t boundary_faces = 2 * (static_cast<int64_t>(size.x) * size.y +
+        static_cast<int64_t>(size.y) * size.z + static_cast<int64_t>(size.x) * size.z);
+
+    Dictionary traffic;
+    int64_t total = 0;
+
+    const auto add_pass = [&](const char* pass, int64_t bytes) {
+        traffic[pass] = bytes;
+        total += bytes;
+    };
+
+    // Three faces in and out and the pressure reset.
+    add_pass("integrate", active_cells * (7 * value + mask));
+
+    // Sparse steps run the separate passes either way.
+    if (fused && !m_sparse_bricks) {
+        add_pass("advection", active_cells * (7 * value + mask + texel));
+    } else {
+        add_pass("extrapolation", boundary_faces * value);
+        add_pass("advection", active_cells * (6 * value + mask));
+        add_pass("copy_to_texture", cells * (4 * value + mask + texel));
+    }
+
+    traffic["total"] = total;
+
+    return traffic;
+}
+
+Dictionary ForceField::get_field_stats() {
+    if (m_backend == BACKEND_CPU) {
+        if (!m_cpu_solver.is_initialized()) {
+            return Dictionary();
+        }
+
+        return m_cpu_solver.compute_stats().to_dictionary(m_last_time_step, m_requested_cell_size);
+    }
+
+    m_field_stats_requested = true;
+
+    std::lock_guard lock(m_field_stats_mutex);
+    return m_field_stats;
+}
+
+PackedVector3Array ForceField::sample_velocities(const PackedVector3Array& points) {
+    PackedVector3Array sampled_points;
+    return query_velocities(points, sampled_points);
+}
+
+PackedVector3Array ForceField::query_velocities(const PackedVector3Array& points, PackedVector3Array& sampled_points) {
+    const Transform3D transform = get_global_transform();
+
+    if (m_backend == BACKEND_CPU) {
+        if (!m_cpu_solver.is_initialized()) {
+            sampled_points = PackedVector3Array();
+            return PackedVector3Array();
+        }
+
+        const Transform3D to_local = transform.affine_inverse();
+        PackedVector3Array velocities;
+        velocities.resize(points.size());
+
+        for (int64_t i = 0; i < points.size(); ++i) {
+            velocities.set(i, transform.basis.xform(m_cpu_solver.sample_velocity(to_local.xform(points[i]))));
+        }
+
+        call_deferred("emit_signal", "velocities_sampled", points, velocities);
+
+        sampled_points = points;
+        return velocities;
+    }
+
+    PackedVector3Array velocities;
+
+    {
+        std::lock_guard lock(m_velocity_query_mutex);
+
+        m_pending_query_points = points;
+        m_pending_query_transform = transform;
+        m_has_pending_query = true;
+
+        velocities = m_sampled_velocities;
+        sampled_points = m_sampled_points;
+    }
+
+    // Points inside a nested field take its answer to the same query, which is finer. It only counts if it was
+    // sampled at the same points, the children of a child answer for it.
+    for (auto it = m_nested_field_ids.begin(); it != m_nested_field_ids.end();) {
+        auto *const child = Object::cast_to<ForceField>(ObjectDB::get_instance(*it));
+
+        if (child == nullptr) {
+            it = m_nested_field_ids.erase(it);
+            continue;
+        }
+
+        ++it;
+
+        PackedVector3Array child_points;
+        const PackedVector3Array child_velocities = child->query_velocities(points, child_points);
+
+        if (child_points != sampled_points || child_velocities.size() != velocities.size()) {
+            continue;
+        }
+
+        const Transform3D to_child = child->get_global_transform().affine_inverse();
+
+        for (int64_t i = 0; i < velocities.size(); ++i) {
+            if (child->contains_interior_point(to_child.xform(sampled_points[i]))) {
+                velocities.set(i, child_velocities[i]);
+            }
+        }
+    }
+
+    return velocities;
+}
+
+int ForceField::get_max_iterations() const {
+    return m_max_iterations;
+}
+
+void ForceField::set_max_iterations(int iterations) {
+    m_max_iterations = std::max(2, iterations);
+}
+
+float ForceField::get_tolerance() const {
+    return m_tolerance;
+}
+
+void ForceField::set_tolerance(float tolerance) {
+    m_tolerance = std::max(0.0f, tolerance);
+}
+
+int ForceField::get_residual_check_interval() const {
+    return m_residual_check_interval;
+}
+
+void ForceField::set_residual_check_interval(int interval) {
+    // Checks after a full red-black pair so both colors have been relaxed.
+    m_residual_check_interval = std::max(2, interval + interval % 2);
+}
+
+float ForceField::get_time_step() const {
+    return m_time_step;
+}
+
+void ForceField::set_time_step(float time_step) {
+    m_time_step = std::max(time_step, MIN_TIME_STEP);
+}
+
+int ForceField::get_max_substeps() const {
+    return m_max_substeps;
+}
+
+void ForceField::set_max_substeps(int substeps) {
+    m_max_substeps = std::max(1, substeps);
+}
+
+bool ForceField::get_adaptive_time_step() const {
+    return m_adaptive_time_step;
+}
+
+void ForceField::set_adaptive_time_step(bool enabled) {
+    m_adaptive_time_step = enabled;
+}
+
+float ForceField::get_cfl_target() const {
+    return m_cfl_target;
+}
+
+void ForceField::set_cfl_target(float target) {
+    m_cfl_target = std::max(target, 0.01f);
+}
+
+float ForceField::get_last_time_step() const {
+    return m_last_time_step;
+}
+
+int ForceField::get_last_substep_count() const {
+    return m_last_substep_count;
+}
+
+float ForceField::get_last_residual() const {
+    std::lock_guard lock(m_residual_mutex);
+    return m_last_residual;
+}
+
+float ForceField::get_last_residual_l2() const {
+    std::lock_guard lock(m_residual_mutex);
+    return m_last_residual_l2;
+}
+
+int ForceField::get_last_iteration_count() const {
+    std::lock_guard lock(m_residual_mutex);
+    return m_last_iteration_count;
+}
+
+ForceField::Precision ForceField::get_precision() const {
+    return m_precision;
+}
+
+void ForceField::set_precision(Precision precision) {
+    m_precision = precision;
+}
+
+Dictionary ForceField::get_precision_error_report(int steps) const {
+    const float delta_time = m_time_step;
+
+    // Runs the current setup twice on the CPU, once with every stored value rounded to fp16 like the GPU
+    // storage does, and compares the cell centred output after each step. The maxima and the RMS error cover
+    // every step, the RMS velocity error of each step is listed as well.
+    const PackedFloat32Array solid = create_solid_data(m_requested_field_size, true);
+
+    CpuSolver reference;
+    CpuSolver half;
+
+    reference.init(m_requested_field_size, m_requested_cell_size, solid, m_cpu_thread_count);
+    half.init(m_requested_field_size, m_requested_cell_size, solid, m_cpu_thread_count);
+    reference.set_constants(m_over_relaxation, m_density);
+    half.set_constants(m_over_relaxation, m_density);
+    half.set_half_precision(true);
+
+    const EmitterList emitters = build_emitter_list();
+    reference.set_emitters(emitters);
+    half.set_emitters(emitters);
+
+    double max_velocity_error = 0.0;
+    double max_pressure_error = 0.0;
+    double velocity_error_sum = 0.0;
+    double max_velocity = 0.0;
+    double max_pressure = 0.0;
+    int64_t samples = 0;
+    PackedFloat32Array step_velocity_errors;
+    step_velocity_errors.resize(std::max(steps, 0));
+
+    for (int step = 0; step < steps; ++step) {
+        reference.step(delta_time, m_max_iterations);
+        half.step(delta_time, m_max_iterations);
+
+        const auto& expected = reference.get_output();
+        const auto& actual = half.get_output();
+        double step_error_sum = 0.0;
+
+        for (size_t cell = 0; cell < expected.size(); cell += 4) {
+            for (size_t c = 0; c < 3; ++c) {
+                const double error = std::abs(double(actual[cell + c]) - double(expected[cell + c]));
+
+                max_velocity_error = std::max(max_velocity_error, error);
+                step_error_sum += error * error;
+                max_velocity = std::max(max_velocity, std::abs(double(expected[cell + c])));
+            }
+
+            max_pressure_error = std::max(max_pressure_error, std::abs(double(actual[cell + 3]) - double(expected[cell + 3])));
+            max_pressure = std::max(max_pressure, std::abs(double(expected[cell + 3])));
+        }
+
+        const int64_t step_samples = static_cast<int64_t>(expected.size() / 4);
+        step_velocity_errors.set(step, step_samples > 0 ? std::sqrt(step_error_sum / double(3 * step_samples)) : 0.0);
+        velocity_error_sum += step_error_sum;
+        samples += step_samples;
+    }
+
+    Dictionary report;
+    report["steps"] = steps;
+    report["max_velocity_error"] = max_velocity_error;
+    report["rms_velocity_error"] = samples > 0 ? std::sqrt(velocity_error_sum / double(3 * samples)) : 0.0;
+    report["relative_velocity_error"] = max_velocity > 0.0 ? max_velocity_error / max_velocity : 0.0;
+    report["max_pressure_error"] = max_pressure_error;
+    report["relative_pressure_error"] = max_pressure > 0.0 ? max_pressure_error / max_pressure : 0.0;
+    report["rms_velocity_error_per_step"] = step_velocity_errors;
+
+    return report;
+}
+
+ForceField::FieldLayout ForceField::get_field_layout() const {
+    return m_field_layout;
+}
+
+void ForceField::set_field_layout(FieldLayout layout) {
+    m_field_layout = layout;
+}
+
+float ForceField::get_over_relaxation() const {
+    return m_over_relaxation;
+}
+
+void ForceField::set_over_relaxation(float factor) {
+    // Successive over-relaxation diverges at 2.
+    m_over_relaxation = std::clamp(factor, 1.0f, 1.99f);
+}
+
+float ForceField::get_density() const {
+    return m_density;
+}
+
+void ForceField::set_density(float density) {
+    m_density = std::max(0.001f, density);
+}
+
+Vector3i ForceField::get_workgroup_size() const {
+    return m_workgroup_size;
+}
+
+void ForceField::set_workgroup_size(Vector3i size) {
+    m_workgroup_size = Vector3i(std::clamp(size.x, 1, 16), std::clamp(size.y, 1, 16), std::clamp(size.z, 1, 16));
+}
+
+bool ForceField::get_advection_shared_tiles() const {
+    return m_advection_shared_tiles;
+}
+
+void ForceField::set_advection_shared_tiles(bool enabled) {
+    m_advection_shared_tiles = enabled;
+}
+
+bool ForceField::get_pressure_shared_tiles() const {
+    return m_pressure_shared_tiles;
+}
+
+void ForceField::set_pressure_shared_tiles(bool enabled) {
+    m_pressure_shared_tiles = enabled;
+}
+
+bool ForceField::get_fused_kernels() const {
+    return m_fused_kernels;
+}
+
+void ForceField::set_fused_kernels(bool enabled) {
+    m_fused_kernels = enabled;
+}
+
+ForceField::PressureSolver ForceField::get_pressure_solver() const {
+    return m_pressure_solver;
+}
+
+void ForceField::set_pressure_solver(PressureSolver solver) {
+    m_pressure_solver = solver;
+}
+
+int ForceField::get_multigrid_levels() const {
+    return m_multigrid_level_count;
+}
+
+void ForceField::set_multigrid_levels(int levels) {
+    m_multigrid_level_count = std::max(1, levels);
+}
+
+int ForceField::get_multigrid_cycles() const {
+    return m_multigrid_cycles;
+}
+
+void ForceField::set_multigrid_cycles(int cycles) {
+    m_multigrid_cycles = std::max(1, cycles);
+}
+
+int ForceField::get_multigrid_smoothing_iterations() const {
+    return m_multigrid_smoothing_iterations;
+}
+
+void ForceField::set_multigrid_smoothing_iterations(int iterations) {
+    // Smooths both colors equally often.
+    m_multigrid_smoothing_iterations = std::max(2, iterations + iterations % 2);
+}
+
+bool ForceField::get_sparse_bricks() const {
+    return m_sparse_bricks;
+}
+
+void ForceField::set_sparse_bricks(bool enabled) {
+    m_sparse_bricks = enabled;
+}
+
+float ForceField::get_activity_threshold() const {
+    return m_activity_threshold;
+}
+
+void ForceField::set_activity_threshold(float threshold) {
+    m_activity_threshold = std::max(0.0f, threshold);
+}
+
+int ForceField::get_active_brick_count() const {
+    return m_active_brick_count;
+}
+
+PackedFloat32Array ForceField::get_field_data() const {
+    ERR_FAIL_COND_V_MSG(!m_cpu_solver.is_initialized(), PackedFloat32Array(), "Field data is only available on the CPU backend.");
+
+    const auto& output = m_cpu_solver.get_output();
+
+    PackedFloat32Array data;
+    data.resize(static_cast<int64_t>(output.size()));
+    std::memcpy(data.ptrw(), output.data(), output.size() * sizeof(float));
+
+    return data;
+}
+
+void ForceField::init_cpu() {
+    UtilityFunctions::print("Initializing CPU solver ...");
+
+    m_cpu_solver.init(m_field_size, m_cell_size, create_solid_data(m_field_size, true), m_cpu_thread_count);
+    // The CPU solver rounds in software, so fp16 is always available there.
+    m_storage_precision = m_precision;
+    m_cpu_solver.set_half_precision(m_storage_precision == PRECISION_FP16);
+    m_cpu_solver.set_constants(m_over_relaxation, m_density);
+    m_cpu_solver.set_emitters(build_emitter_list());
+    m_emitters_dirty = false;
+
+    UtilityFunctions::print("Done.");
+
+    m_compute_ready = true;
+}
+
+void ForceField::run_cpu(float delta_time) {
+    m_cpu_solver.set_sparse(m_sparse_bricks, m_activity_threshold);
+    m_cpu_solver.step(delta_time, m_max_iterations);
+
+    {
+        std::lock_guard lock(m_residual_mutex);
+        m_last_iteration_count = m_max_iterations;
+    }
+    m_active_brick_count = m_cpu_solver.get_active_tile_count();
+
+    if (m_print_debug_info) {
+        m_print_debug_info = false;
+        UtilityFunctions::print("ForceField stats: ", m_cpu_solver.compute_stats().to_dictionary(delta_time, m_cell_size));
+    }
+
+    if (m_cpu_texture.is_valid()) {
+        update_cpu_texture();
+    }
+}
+
+void ForceField::update_cpu_texture() {
+    const auto& output = m_cpu_solver.get_output();
+    const int64_t slice_size = 4 * m_field_size.x * m_field_size.y;
+
+    TypedArray<Image> slices;
+
+    for (int k = 0; k < m_field_size.z; ++k) {
+        PackedByteArray bytes;
+        bytes.resize(slice_size * static_cast<int64_t>(sizeof(float)));
+        std::memcpy(bytes.ptrw(), output.data() + k * slice_size, slice_size * sizeof(float));
+
+        slices.push_back(Image::create_from_data(m_field_size.x, m_field_size.y, false, Image::FORMAT_RGBAF, bytes));
+    }
+
+    if (m_cpu_texture->get_width() != m_field_size.x || m_cpu_texture->get_height() != m_field_size.y ||
+        m_cpu_texture->get_depth() != m_field_size.z) {
+        m_cpu_texture->create(Image::FORMAT_RGBAF, m_field_size.x, m_field_size.y, m_field_size.z, false, slices);
+    } else {
+        m_cpu_texture->update(slices);
+    }
+}
+
+void ForceField::init_compute() {
+    UtilityFunctions::print("Initializing compute shaders ...");
+
+    if (m_simulation_device == SIMULATION_DEVICE_LOCAL && m_local_device == nullptr) {
+        m_local_device = RenderingServer::get_singleton()->create_local_rendering_device();
+    }
+
+    m_device = m_local_device != nullptr ? m_local_device : RenderingServer::get_singleton()->get_rendering_device();
+    m_buffer_pool.set_device(m_device);
+    m_pass_profiler.set_owner_id(get_instance_id());
+
+    // Taken once here like the precision and layout, changes apply when the field is started or resized.
+    m_specialization = ShaderCache::Specialization();
+    m_specialization.faces = m_field_size;
+    m_specialization.cell_size = m_cell_size;
+    m_specialization.over_relaxation = m_over_relaxation;
+    m_specialization.density = m_density;
+    m_specialization.tile = get_supported_workgroup_size();
+    m_storage_precision = get_supported_precision();
+
+    m_velocity_buffers1.u = create_velocity_storage_buffer();
+    m_velocity_buffers1.v = create_velocity_storage_buffer();
+    m_velocity_buffers1.w = create_velocity_storage_buffer();
+
+    m_velocity_buffers2.u = create_velocity_storage_buffer();
+    m_velocity_buffers2.v = create_velocity_storage_buffer();
+    m_velocity_buffers2.w = create_velocity_storage_buffer();
+
+    // The walls along the edges of a fixed field would stay behind in the world when the window scrolls.
+    m_solid_buffer = create_solid_storage_buffer(!uses_scrolling(), uses_nesting());
+    m_static_solid_buffer = create_solid_storage_buffer(!uses_scrolling(), uses_nesting());
+    m_solid_mask_buffer = create_solid_mask_buffer();
+    m_pressure_buffer = create_pressure_buffer();
+    m_brick_flags_buffer = create_brick_flags_buffer();
+    m_active_bricks_buffer = create_active_bricks_buffer();
+    m_wrap_offset = Vector3i();
+    m_grid_params_buffer = create_grid_params_buffer(m_field_size, m_cell_size);
+    m_rd_texture = create_texture(m_device, m_field_size);
+    m_emitter_buffer = create_zeroed_storage_buffer(EMITTER_MIN_CAPACITY);
+    m_emitter_buffer_capacity = EMITTER_MIN_CAPACITY;
+    m_uploaded_emitter_bytes.clear();
+    m_obstacles_reset = true;
+    m_residual_partials_buffer = create_reduction_buffer((m_field_size.x / 8) * (m_field_size.y / 8) * (m_field_size.z / 8));
+    m_residual_buffer = create_reduction_buffer(MAX_RESIDUAL_CHECKS);
+
+    {
+        std::lock_guard lock(m_residual_mutex);
+        m_pressure_iterations = m_max_iterations;
+        m_multigrid_planned_cycles = m_multigrid_cycles;
+    }
+
+    m_active_bricks_sparse = false;
+    m_active_brick_count = get_brick_count();
+
+    if (uses_local_device()) {
+        RenderingServer::get_singleton()->call_on_render_thread(
+            callable_mp(this, &ForceField::init_display_textures).bind(m_field_size));
+    } else if (m_texture.is_valid()) {
+        m_texture->set_texture_rd_rid(m_rd_texture);
+    }
+
+    // The solver passes read the packed mask, the float solid buffer is only the source it is built from.
+    init_solid_mask_pass(m_solid_buffer, m_solid_mask_buffer, m_grid_params_buffer);
+    init_clear_pass(m_velocity_buffers1, m_velocity_buffers2, m_pressure_buffer, m_solid_buffer, m_static_solid_buffer, m_grid_params_buffer);
+    init_active_brick_pass(m_velocity_buffers2, m_grid_params_buffer, m_emitter_buffer, m_brick_flags_buffer, m_active_bricks_buffer);
+    init_integrate_pass(m_velocity_buffers2, m_velocity_buffers1, m_solid_mask_buffer, m_pressure_buffer, m_grid_params_buffer, m_emitter_buffer, m_active_bricks_buffer);
+    init_incompressibility_pass(m_velocity_buffers1, m_solid_mask_buffer, m_pressure_buffer, m_grid_params_buffer, m_active_bricks_buffer);
+    init_extrapolation_pass(m_velocity_buffers1, m_grid_params_buffer);
+    init_advect_pass(m_velocity_buffers1, m_velocity_buffers2, m_solid_mask_buffer, m_grid_params_buffer, m_active_bricks_buffer,
+        m_pressure_buffer, m_rd_texture);
+    init_copy_to_texture_pass(m_velocity_buffers2, m_rd_texture, m_pressure_buffer, m_solid_mask_buffer, m_grid_params_buffer);
+    init_reduce_pass();
+    init_residual_pass(m_velocity_buffers1, m_solid_mask_buffer, m_grid_params_buffer, m_residual_partials_buffer, m_residual_buffer);
+    init_resample_pass();
+
+    // Passes of optional features are created by the first step that uses them, see the init functions.
+    m_obstacle_pass = ObstaclePass();
+    m_obstacle_buffer_capacity = 0;
+    m_obstacle_triangle_capacity = 0;
+    m_multigrid_pass = MultigridPass();
+    m_multigrid_created = false;
+    m_velocity_query_pass = VelocityQueryPass();
+    m_field_stats_pass = FieldStatsPass();
+    m_nest_pass = NestPass();
+    m_solid_mask_dirty = true;
+
+    UtilityFunctions::print("Done.");
+
+    m_compute_ready = true;
+}
+
+ShaderCache::Program ForceField::create_program(const String& file, const String& version,
+                                                const ShaderCache::Specialization& specialization) {
+    const ShaderCache::Program program = ShaderCache::get_singleton().acquire(m_device, file, version, specialization);
+    m_programs.push_back(program);
+
+    return program;
+}
+
+RID ForceField::create_uniform_set(const TypedArray<RDUniform>& uniforms, const RID& shader, int set) const {
+    const RID uniform_set = m_device->uniform_set_create(uniforms, shader, set);
+    m_uniform_sets.push_back(uniform_set);
+
+    return uniform_set;
+}
+
+RID ForceField::detach_uniform_set(const RID& uniform_set) {
+    const auto it = std::find(m_uniform_sets.begin(), m_uniform_sets.end(), uniform_set);
+
+    if (it != m_uniform_sets.end()) {
+        m_uniform_sets.erase(it);
+    }
+
+    return uniform_set;
+}
+
+void ForceField::free_uniform_set(const RID& uniform_set) {
+    const auto it = std::find(m_uniform_sets.begin(), m_uniform_sets.end(), uniform_set);
+
+    if (it != m_uniform_sets.end()) {
+        m_uniform_sets.erase(it);
+        m_device->free_rid(uniform_set);
+    }
+}
+
+void ForceField::release_buffer(RID& buffer) {
+    if (buffer.is_valid()) {
+        m_buffer_pool.release(buffer);
+        buffer = RID();
+    }
+}
+
+std::vector<ShaderCache::Program> ForceField::release_compute() {
+    // The display textures of a local device stay bound until init_display_textures() replaces them.
+    if (m_texture.is_valid() && !uses_local_device()) {
+        m_texture->set_texture_rd_rid(RID());
+    }
+
+    free_nest_parent_sets(take_nest_parent_sets());
+
+    for (const RID& uniform_set : m_uniform_sets) {
+        m_device->free_rid(uniform_set);
+    }
+
+    m_uniform_sets.clear();
+
+    if (m_rd_texture.is_valid()) {
+        m_device->free_rid(m_rd_texture);
+        m_rd_texture = RID();
+    }
+
+    for (RID* buffer : {
+        &m_velocity_buffers1.u, &m_velocity_buffers1.v, &m_velocity_buffers1.w,
+        &m_velocity_buffers2.u, &m_velocity_buffers2.v, &m_velocity_buffers2.w,
+        &m_solid_buffer, &m_static_solid_buffer, &m_solid_mask_buffer, &m_pressure_buffer, &m_brick_flags_buffer,
+        &m_active_bricks_buffer, &m_grid_params_buffer, &m_emitter_buffer, &m_obstacle_buffer,
+        &m_obstacle_triangle_buffer, &m_residual_partials_buffer, &m_residual_buffer, &m_stats_partials_buffer,
+        &m_stats_buffer,
+    }) {
+        release_buffer(*buffer);
+    }
+
+    for (VelocityQuerySlot& slot : m_velocity_query_pass.slots) {
+        release_buffer(slot.points_buffer);
+        release_buffer(slot.results_buffer);
+        slot.capacity = 0;
+    }
+
+    for (MultigridLevel& level : m_multigrid_levels) {
+        release_buffer(level.phi);
+        release_buffer(level.rhs);
+        release_buffer(level.solid);
+        release_buffer(level.grid_parameters);
+    }
+
+    m_multigrid_levels.clear();
+
+    std::vector<ShaderCache::Program> programs;
+    programs.swap(m_programs);
+
+    return programs;
+}
+
+void ForceField::release_programs(const std::vector<ShaderCache::Program>& programs) {
+    for (const ShaderCache::Program& program : programs) {
+        ShaderCache::get_singleton().release(m_device, program);
+    }
+}
+
+void ForceField::resize_compute(Vector3i field_size, float cell_size) {
+    if (field_size == m_field_size && cell_size == m_cell_size) {
+        return;
+    }
+
+    UtilityFunctions::print("Resizing field to ", field_size, " cells of ", cell_size, " ...");
+
+    // The current velocity and the grid it lives on are kept aside, everything else goes back to the pool and
+    // the new grid is built from it.
+    const VelocityBuffers source_velocity = m_velocity_buffers2;
+    const RID source_grid_parameters = m_grid_params_buffer;
+    m_velocity_buffers2 = VelocityBuffers();
+    m_grid_params_buffer = RID();
+
+    // The programs of the old grid are released only once the new one holds them, so shaders used by both stay
+    // compiled. The pipelines specialized for the old size go away.
+    const std::vector<ShaderCache::Program> programs = release_compute();
+
+    m_field_size = field_size;
+    m_cell_size = cell_size;
+    init_compute();
+    release_programs(programs);
+
+    const RID velocity_set = create_velocity_set(source_velocity, m_resample_pass.shader, 0);
+    const RID grid_parameters_set = create_grid_parameters_set(source_grid_parameters, m_resample_pass.shader, 1);
+
+    {
+        ComputeListRecorder recorder(m_device, false);
+        ResampleRegion region;
+        region.size = m_field_size;
+        record_resample(recorder, velocity_set, grid_parameters_set, m_resample_pass.velocity_set,
+            m_resample_pass.grid_parameters_set, region);
+    }
+
+    // Both are freed once the frame that uses them is done.
+    free_uniform_set(velocity_set);
+    free_uniform_set(grid_parameters_set);
+    m_buffer_pool.release(source_velocity.u);
+    m_buffer_pool.release(source_velocity.v);
+    m_buffer_pool.release(source_velocity.w);
+    m_buffer_pool.release(source_grid_parameters);
+
+    // Emitters and obstacles are binned in cells of the old grid.
+    {
+        std::lock_guard lock(m_emitter_mutex);
+        m_pending_emitter_bytes.clear();
+    }
+
+    {
+        std::lock_guard lock(m_obstacle_mutex);
+        m_pending_obstacle_regions.clear();
+    }
+
+    m_emitters_dirty = true;
+}
+
+bool ForceField::uses_local_device() const {
+    return m_simulation_thread.is_running();
+}
+
+void ForceField::call_on_simulation_thread(const Callable& callable) {
+    if (uses_local_device()) {
+        m_simulation_thread.push(callable);
+    } else {
+        RenderingServer::get_singleton()->call_on_render_thread(callable);
+    }
+}
+
+void ForceField::finish_local_frame() {
+    m_device->submit();
+    m_device->sync();
+
+    // The copy to the texture ran in the last step, so this is the state the frame ends with.
+    const PackedByteArray bytes = m_device->texture_get_data(m_rd_texture, 0);
+
+    std::lock_guard lock(m_local_output_mutex);
+    m_local_output = bytes;
+    m_local_output_size = m_field_size;
+    m_has_local_output = true;
+}
+
+void ForceField::present_local_output() {
+    PackedByteArray bytes;
+    Vector3i size;
+
+    {
+        std::lock_guard lock(m_local_output_mutex);
+
+        if (!m_has_local_output) {
+            return;
+        }
+
+        bytes = m_local_output;
+        size = m_local_output_size;
+        m_local_output = PackedByteArray();
+        m_has_local_output = false;
+    }
+
+    RenderingServer::get_singleton()->call_on_render_thread(
+        callable_mp(this, &ForceField::update_display_texture).bind(bytes, size));
+}
+
+void ForceField::init_display_textures(Vector3i size) {
+    RenderingDevice* device = RenderingServer::get_singleton()->get_rendering_device();
+    const RID previous[2] = { m_display_textures[0], m_display_textures[1] };
+
+    m_display_textures[0] = create_texture(device, size);
+    m_display_textures[1] = create_texture(device, size);
+    m_display_front = 0;
+    m_display_size = size;
+
+    if (m_texture.is_valid()) {
+        m_texture->set_texture_rd_rid(m_display_textures[0]);
+    }
+
+    for (const RID& texture : previous) {
+        if (texture.is_valid()) {
+            device->free_rid(texture);
+        }
+    }
+}
+
+void ForceField::update_display_texture(const PackedByteArray& bytes, Vector3i size) {
+    // Read back before a resize whose textures are already in place.
+    if (size != m_display_size) {
+        return;
+    }
+
+    const int back = 1 - m_display_front;
+
+    RenderingServer::get_singleton()->get_rendering_device()->texture_update(m_display_textures[back], 0, bytes);
+    m_display_front = back;
+
+    if (m_texture.is_valid()) {
+        m_texture->set_texture_rd_rid(m_display_textures[back]);
+    }
+}
+
+void ForceField::init_resample_pass() {
+    const ShaderCache::Program program = create_program("resample_velocity.glsl", get_field_shader_version());
+    const RID& shader = program.shader;
+
+    m_resample_pass.velocity_set = create_velocity_set(m_velocity_buffers2, shader, 2);
+    m_resample_pass.grid_parameters_set = create_grid_parameters_set(m_grid_params_buffer, shader, 3);
+    m_resample_pass.pipeline = program.pipeline;
+    m_resample_pass.shader = shader;
+}
+
+void ForceField::init_nest_pass() {
+    if (m_nest_pass.border_set.is_valid()) {
+        return;
+    }
+
+    // The border is written after integration, which leaves the step's velocity in the first buffers. The parent
+    // gets the velocity the step ends with.
+    m_nest_pass.border_set = create_velocity_set(m_velocity_buffers1, m_resample_pass.shader, 2);
+    m_nest_pass.source_set = create_velocity_set(m_velocity_buffers2, m_resample_pass.shader, 0);
+    m_nest_pass.source_grid_parameters_set = create_grid_parameters_set(m_grid_params_buffer, m_resample_pass.shader, 1);
+}
+
+void ForceField::init_integrate_pass(const VelocityBuffers &velocity_in, const VelocityBuffers &velocity_out,
+                                     const RID &solids, const RID& pressure, const RID &grid_parameters, const RID& emitter_buffer,
+                                     const RID& active_bricks) {
+    const ShaderCache::Program program = create_program("integrate.glsl", get_field_shader_version(), m_specialization);
+    const RID& shader = program.shader;
+
+    m_integrate_pass.velocity_in_set = create_velocity_set(velocity_in, shader, 0);
+    m_integrate_pass.velocity_out_set = create_velocity_set(velocity_out, shader, 1);
+    m_integrate_pass.pressure_set = create_pressure_set(pressure, shader, 2);
+    m_integrate_pass.solid_set = create_solid_set(solids, shader, 3);
+    m_integrate_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 4);
+    m_integrate_pass.emitter_set = create_emitter_set(emitter_buffer, shader, 5);
+    m_integrate_pass.active_bricks_set = create_storage_set(active_bricks, shader, 6);
+    m_integrate_pass.pipeline = program.pipeline;
+    m_integrate_pass.shader = shader;
+}
+
+void ForceField::init_incompressibility_pass(const VelocityBuffers &velocity, const RID &solid,
+                                             const RID& pressure, const RID &grid_parameters, const RID& active_bricks) {
+    // The tiled variants stage the faces of each brick in shared memory before relaxing its cells. Taken once, the
+    // dispatch has to match the variant.
+    m_incompressibility_pass.tiled = m_pressure_shared_tiles;
+    const String version = m_incompressibility_pass.tiled ? get_field_shader_version() + "_tiled" : get_field_shader_version();
+    const ShaderCache::Program program = create_program("solve_incompressibility.glsl", version, m_specialization);
+    const RID& shader = program.shader;
+
+    m_incompressibility_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_incompressibility_pass.solid_set = create_solid_set(solid, shader, 1);
+    m_incompressibility_pass.pressure_set = create_pressure_set(pressure, shader, 2);
+    m_incompressibility_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
+    m_incompressibility_pass.active_bricks_set = create_storage_set(active_bricks, shader, 4);
+    m_incompressibility_pass.pipeline = program.pipeline;
+    m_incompressibility_pass.shader = shader;
+}
+
+void ForceField::init_extrapolation_pass(const VelocityBuffers &velocity, const RID &grid_parameters) {
+    const ShaderCache::Program program = create_program("extrapolation.glsl", get_field_shader_version(), m_specialization);
+    const RID& shader = program.shader;
+
+    m_extrapolation_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_extrapolation_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 1);
+    m_extrapolation_pass.pipeline = program.pipeline;
+    m_extrapolation_pass.shader = shader;
+}
+
+void ForceField::init_advect_pass(const VelocityBuffers &velocity_in, const VelocityBuffers &velocity_out,
+                                  const RID &solid, const RID &grid_parameters, const RID& active_bricks,
+                                  const RID& pressure, const RID& texture) {
+    const auto init_pass = [&](AdvectionPass& pass, const String& version) {
+        const ShaderCache::Program program = create_program("advection.glsl", version, m_specialization);
+        const RID& shader = program.shader;
+
+        pass = AdvectionPass();
+        pass.velocity_in_set = create_velocity_set(velocity_in, shader, 0);
+        pass.velocity_out_set = create_velocity_set(velocity_out, shader, 1);
+        pass.solid_set = create_solid_set(solid, shader, 2);
+        pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
+        pass.active_bricks_set = create_storage_set(active_bricks, shader, 4);
+        pass.pipeline = program.pipeline;
+        pass.shader = shader;
+    };
+
+    init_pass(m_advection_pass, get_advection_shader_version());
+    m_fused_advection_pass = AdvectionPass();
+
+    // Sparse steps still take the separate passes, so the fused variant comes on top of the plain one.
+    if (m_fused_kernels) {
+        init_pass(m_fused_advection_pass, get_advection_shader_version() + "_fused");
+        m_fused_advection_pass.pressure_set = create_pressure_set(pressure, m_fused_advection_pass.shader, 5);
+        m_fused_advection_pass.texture_set = create_image_set(texture, m_fused_advection_pass.shader, 6);
+    }
+}
+
+void ForceField::init_copy_to_texture_pass(const VelocityBuffers &velocity, const RID &texture, const RID& pressure, const RID &solid,
+                                           const RID &grid_parameters) {
+    const ShaderCache::Program program = create_program("copy_to_texture.glsl", get_field_shader_version(), m_specialization);
+    const RID& shader = program.shader;
+
+    m_transfer_to_texture_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_transfer_to_texture_pass.pressure_set = create_pressure_set(pressure, shader, 1);
+    m_transfer_to_texture_pass.texture_set = create_image_set(texture, shader, 2);
+    m_transfer_to_texture_pass.solid_set = create_solid_set(solid, shader, 3);
+    m_transfer_to_texture_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 4);
+    m_transfer_to_texture_pass.pipeline = program.pipeline;
+    m_transfer_to_texture_pass.shader = shader;
+}
+
+void ForceField::init_velocity_query_pass(const VelocityBuffers &velocity, const RID &grid_parameters) {
+    if (m_velocity_query_pass.pipeline.is_valid()) {
+        return;
+    }
+
+    const ShaderCache::Program program = create_program("sample_velocities.glsl", get_field_shader_version());
+    const RID& shader = program.shader;
+
+    m_velocity_query_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_velocity_query_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 1);
+    m_velocity_query_pass.pipeline = program.pipeline;
+    m_velocity_query_pass.shader = shader;
+
+    for (int slot = 0; slot < 2; ++slot) {
+        reserve_velocity_query_slot(slot, VELOCITY_QUERY_MIN_CAPACITY);
+    }
+}
+
+void ForceField::reserve_velocity_query_slot(int slot, int points) {
+    VelocityQuerySlot& query_slot = m_velocity_query_pass.slots[slot];
+
+    if (points <= query_slot.capacity) {
+        return;
+    }
+
+    // Grows in powers of two, so a slowly rising point count doesn't recreate the buffers every step.
+    int capacity = std::max(query_slot.capacity, VELOCITY_QUERY_MIN_CAPACITY);
+
+    while (capacity < points) {
+        capacity *= 2;
+    }
+
+    if (query_slot.capacity > 0) {
+        // The buffers go back to the pool, their sets would otherwise live as long as the buffers.
+        free_uniform_set(query_slot.points_set);
+        free_uniform_set(query_slot.results_set);
+        release_buffer(query_slot.points_buffer);
+        release_buffer(query_slot.results_buffer);
+    }
+
+    query_slot.points_buffer = create_query_buffer(capacity);
+    query_slot.results_buffer = create_query_buffer(capacity);
+    query_slot.points_set = create_storage_set(query_slot.points_buffer, m_velocity_query_pass.shader, 2);
+    query_slot.results_set = create_storage_set(query_slot.results_buffer, m_velocity_query_pass.shader, 3);
+    query_slot.capacity = capacity;
+}
+
+void ForceField::init_field_stats_pass(const VelocityBuffers &velocity, const RID &pressure, const RID &solid,
+                                      const RID &grid_parameters) {
+    if (m_field_stats_pass.pipeline.is_valid()) {
+        return;
+    }
+
+    const ShaderCache::Program program = create_program("field_stats.glsl", get_field_shader_version(), m_specialization);
+    const RID& shader = program.shader;
+
+    m_stats_partials_buffer = create_reduction_buffer(get_brick_count() * FieldStats::COLUMNS);
+    m_stats_buffer = create_reduction_buffer(FieldStats::COLUMNS);
+
+    const RID& partials = m_stats_partials_buffer;
+    const RID& results = m_stats_buffer;
+
+    m_field_stats_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_field_stats_pass.pressure_set = create_pressure_set(pressure, shader, 1);
+    m_field_stats_pass.solid_set = create_solid_set(solid, shader, 2);
+    m_field_stats_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
+    m_field_stats_pass.partials_set = create_storage_set(partials, shader, 4);
+    m_field_stats_pass.reduce_partials_set = create_storage_set(partials, m_reduce_pass.shader, 0);
+    m_field_stats_pass.reduce_results_set = create_storage_set(results, m_reduce_pass.shader, 1);
+    m_field_stats_pass.pipeline = program.pipeline;
+    m_field_stats_pass.shader = shader;
+}
+
+void ForceField::init_solid_mask_pass(const RID &solid, const RID &solid_mask, const RID &grid_parameters) {
+    const ShaderCache::Program program = create_program("build_solid_mask.glsl", get_layout_shader_version());
+    const RID& shader = program.shader;
+
+    m_solid_mask_pass.solid_set = create_solid_set(solid, shader, 0);
+    m_solid_mask_pass.solid_mask_set = create_storage_set(solid_mask, shader, 1);
+    m_solid_mask_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 2);
+    m_solid_mask_pass.pipeline = program.pipeline;
+    m_solid_mask_pass.shader = shader;
+}
+
+void ForceField::init_obstacle_pass(const RID &static_solid, const RID &solid, const VelocityBuffers &velocity,
+                                    const RID &grid_parameters) {
+    if (m_obstacle_pass.pipeline.is_valid()) {
+        return;
+    }
+
+    const ShaderCache::Program program = create_program("voxelize_obstacles.glsl", get_field_shader_version());
+    const RID& shader = program.shader;
+
+    m_obstacle_buffer = create_zeroed_storage_buffer(OBSTACLE_MIN_CAPACITY);
+    m_obstacle_triangle_buffer = create_zeroed_storage_buffer(OBSTACLE_MIN_CAPACITY);
+    m_obstacle_buffer_capacity = OBSTACLE_MIN_CAPACITY;
+    m_obstacle_triangle_capacity = OBSTACLE_MIN_CAPACITY;
+
+    m_obstacle_pass.static_solid_set = create_solid_set(static_solid, shader, 0);
+    m_obstacle_pass.solid_set = create_solid_set(solid, shader, 1);
+    m_obstacle_pass.velocity_set = create_velocity_set(velocity, shader, 2);
+    m_obstacle_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
+    m_obstacle_pass.obstacles_set = create_storage_set(m_obstacle_buffer, shader, 4);
+    m_obstacle_pass.triangles_set = create_storage_set(m_obstacle_triangle_buffer, shader, 5);
+    m_obstacle_pass.pipeline = program.pipeline;
+    m_obstacle_pass.shader = shader;
+}
+
+void ForceField::init_clear_pass(const VelocityBuffers &velocity, const VelocityBuffers &velocity2, const RID &pressure,
+                                 const RID &solid, const RID &static_solid, const RID &grid_parameters) {
+    const ShaderCache::Program program = create_program("clear_cells.glsl", get_field_shader_version());
+    const RID& shader = program.shader;
+
+    m_clear_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_clear_pass.velocity2_set = create_velocity_set(velocity2, shader, 1);
+    m_clear_pass.pressure_set = create_pressure_set(pressure, shader, 2);
+    m_clear_pass.solid_set = create_solid_set(solid, shader, 3);
+    m_clear_pass.static_solid_set = create_solid_set(static_solid, shader, 4);
+    m_clear_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 5);
+    m_clear_pass.pipeline = program.pipeline;
+    m_clear_pass.shader = shader;
+}
+
+void ForceField::init_active_brick_pass(const VelocityBuffers &velocity, const RID &grid_parameters, const RID &emitter_buffer,
+                                        const RID &flags, const RID &active_bricks) {
+    const ShaderCache::Program mark_program = create_program("mark_active_bricks.glsl", get_field_shader_version());
+    const ShaderCache::Program compact_program = create_program("compact_active_bricks.glsl");
+
+    m_active_brick_pass.mark_shader = mark_program.shader;
+    m_active_brick_pass.compact_shader = compact_program.shader;
+
+    const RID& mark_shader = m_active_brick_pass.mark_shader;
+    const RID& compact_shader = m_active_brick_pass.compact_shader;
+
+    m_active_brick_pass.mark_velocity_set = create_velocity_set(velocity, mark_shader, 0);
+    m_active_brick_pass.mark_grid_parameters_set = create_grid_parameters_set(grid_parameters, mark_shader, 1);
+    m_active_brick_pass.mark_emitter_set = create_emitter_set(emitter_buffer, mark_shader, 2);
+    m_active_brick_pass.mark_flags_set = create_storage_set(flags, mark_shader, 3);
+    m_active_brick_pass.mark_list_set = create_storage_set(active_bricks, mark_shader, 4);
+    m_active_brick_pass.compact_flags_set = create_storage_set(flags, compact_shader, 0);
+    m_active_brick_pass.compact_list_set = create_storage_set(active_bricks, compact_shader, 1);
+    m_active_brick_pass.compact_grid_parameters_set = create_grid_parameters_set(grid_parameters, compact_shader, 2);
+    m_active_brick_pass.mark_pipeline = mark_program.pipeline;
+    m_active_brick_pass.compact_pipeline = compact_program.pipeline;
+}
+
+void ForceField::init_reduce_pass() {
+    const ShaderCache::Program program = create_program("reduce.glsl");
+    const RID& shader = program.shader;
+
+    m_reduce_pass.pipeline = program.pipeline;
+    m_reduce_pass.shader = shader;
+}
+
+void ForceField::init_residual_pass(const VelocityBuffers &velocity, const RID &solid, const RID &grid_parameters,
+                                    const RID &partials, const RID &results) {
+    const ShaderCache::Program program = create_program("residual.glsl", get_field_shader_version());
+    const RID& shader = program.shader;
+
+    m_residual_pass.velocity_set = create_velocity_set(velocity, shader, 0);
+    m_residual_pass.solid_set = create_solid_set(solid, shader, 1);
+    m_residual_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 2);
+    m_residual_pass.partials_set = create_storage_set(partials, shader, 3);
+    m_residual_pass.reduce_partials_set = create_storage_set(partials, m_reduce_pass.shader, 0);
+    m_residual_pass.reduce_results_set = create_storage_set(results, m_reduce_pass.shader, 1);
+    m_residual_pass.pipeline = program.pipeline;
+    m_residual_pass.shader = shader;
+}
+
+void ForceField::init_multigrid_levels() {
+    m_multigrid_levels.clear();
+
+    Vector3i size = m_field_size;
+    float cell_size = m_cell_size;
+    PackedFloat32Array solid = create_solid_data(m_field_size, !uses_scrolling(), uses_nesting());
+
+    while (static_cast<int>(m_multigrid_levels.size()) < m_multigrid_level_count) {
+        const Vector3i coarse_size((size.x + 1) / 2, (size.y + 1) / 2, (size.z + 1) / 2);
+
+        if (coarse_size.x < MULTIGRID_MIN_LEVEL_SIZE || coarse_size.y < MULTIGRID_MIN_LEVEL_SIZE ||
+            coarse_size.z < MULTIGRID_MIN_LEVEL_SIZE) {
+            break;
+        }
+
+        const PackedFloat32Array coarse_solid = restrict_solid_data(solid, size, coarse_size);
+        const PackedByteArray solid_bytes = coarse_solid.to_byte_array();
+
+        MultigridLevel level;
+        level.size = coarse_size;
+        level.phi = create_level_buffer(coarse_size);
+        level.rhs = create_level_buffer(coarse_size);
+        level.solid = m_buffer_pool.acquire_storage(solid_bytes);
+        level.grid_parameters = create_grid_params_buffer(coarse_size, 2.0f * cell_size);
+
+        m_multigrid_levels.push_back(level);
+
+        size = coarse_size;
+        cell_size *= 2.0f;
+        solid = coarse_solid;
+    }
+}
+
+void ForceField::init_multigrid_pass(const VelocityBuffers &velocity, const RID &solid, const RID &pressure,
+                                     const RID &grid_parameters) {
+    if (m_multigrid_levels.empty()) {
+        UtilityFunctions::print("Field is too small for a multigrid hierarchy, using red-black iterations only.");
+        return;
+    }
+
+    const ShaderCache::Program restrict_velocity_program = create_program("mg_restrict_velocity.glsl", get_field_shader_version());
+    const ShaderCache::Program restrict_program = create_program("mg_restrict.glsl");
+    // The levels share one pipeline, so the smoother only gets the workgroup shape.
+    ShaderCache::Specialization smooth_specialization;
+    smooth_specialization.tile = m_specialization.tile;
+
+    const ShaderCache::Program smooth_program = create_program("mg_smooth.glsl", String(), smooth_specialization);
+    const ShaderCache::Program prolong_program = create_program("mg_prolong.glsl");
+    const ShaderCache::Program correct_program = create_program("mg_correct.glsl", get_field_shader_version(), m_specialization);
+
+    m_multigrid_pass.restrict_velocity_shader = restrict_velocity_program.shader;
+    m_multigrid_pass.restrict_shader = restrict_program.shader;
+    m_multigrid_pass.smooth_shader = smooth_program.shader;
+    m_multigrid_pass.prolong_shader = prolong_program.shader;
+    m_multigrid_pass.correct_shader = correct_program.shader;
+
+    m_multigrid_pass.restrict_velocity_pipeline = restrict_velocity_program.pipeline;
+    m_multigrid_pass.restrict_pipeline = restrict_program.pipeline;
+    m_multigrid_pass.smooth_pipeline = smooth_program.pipeline;
+    m_multigrid_pass.prolong_pipeline = prolong_program.pipeline;
+    m_multigrid_pass.correct_pipeline = correct_program.pipeline;
+
+    const RID& restrict_velocity_shader = m_multigrid_pass.restrict_velocity_shader;
+    const RID& correct_shader = m_multigrid_pass.correct_shader;
+
+    m_multigrid_pass.restrict_velocity_set = create_velocity_set(velocity, restrict_velocity_shader, 0);
+    m_multigrid_pass.restrict_solid_set = create_solid_set(solid, restrict_velocity_shader, 1);
+    m_multigrid_pass.restrict_grid_parameters_set = create_grid_parameters_set(grid_parameters, restrict_velocity_shader, 2);
+
+    m_multigrid_pass.correct_velocity_set = create_velocity_set(velocity, correct_shader, 0);
+    m_multigrid_pass.correct_solid_set = create_solid_set(solid, correct_shader, 1);
+    m_multigrid_pass.correct_pressure_set = create_pressure_set(pressure, correct_shader, 2);
+    m_multigrid_pass.correct_grid_parameters_set = create_grid_parameters_set(grid_parameters, correct_shader, 3);
+
+    for (size_t l = 0; l < m_multigrid_levels.size(); ++l) {
+        MultigridLevel& level = m_multigrid_levels[l];
+        const bool first = l == 0;
+        const bool last = l + 1 == m_multigrid_levels.size();
+
+        level.smooth_set = create_level_set(level, m_multigrid_pass.smooth_shader, 0);
+        level.restrict_coarse_set = first
+            ? create_level_set(level, restrict_velocity_shader, 3)
+            : create_level_set(level, m_multigrid_pass.restrict_shader, 1);
+
+        if (first) {
+            level.correct_set = create_level_set(level, correct_shader, 4);
+        } else {
+            level.prolong_fine_set = create_level_set(level, m_multigrid_pass.prolong_shader, 0);
+        }
+
+        if (!last) {
+            level.restrict_fine_set = create_level_set(level, m_multigrid_pass.restrict_shader, 0);
+            level.prolong_coarse_set = create_level_set(level, m_multigrid_pass.prolong_shader, 1);
+        }
+    }
+}
+
+void ForceField::init_optional_passes() {
+    if (m_pressure_solver == PRESSURE_SOLVER_MULTIGRID && !m_multigrid_created) {
+        init_multigrid_levels();
+        init_multigrid_pass(m_velocity_buffers1, m_solid_mask_buffer, m_pressure_buffer, m_grid_params_buffer);
+        m_multigrid_created = true;
+    }
+
+    if (m_field_stats_requested || m_print_debug_info) {
+        init_field_stats_pass(m_velocity_buffers2, m_pressure_buffer, m_solid_mask_buffer, m_grid_params_buffer);
+    }
+
+    {
+        std::lock_guard lock(m_velocity_query_mutex);
+
+        if (m_has_pending_query) {
+            init_velocity_query_pass(m_velocity_buffers2, m_grid_params_buffer);
+        }
+    }
+
+    bool obstacles;
+
+    {
+        std::lock_guard lock(m_obstacle_mutex);
+        obstacles = !m_pending_obstacle_regions.empty();
+    }
+
+    if (obstacles) {
+        init_obstacle_pass(m_static_solid_buffer, m_solid_buffer, m_velocity_buffers2, m_grid_params_buffer);
+    }
+
+    if (m_nest_parent_id != 0) {
+        init_nest_pass();
+    }
+}
+
+void ForceField::run_compute(float delta_time, bool output) {
+    // Before anything is recorded, buffers can't be updated while a compute list is open.
+    apply_pending_state();
+
+    if (m_benchmark_mode) {
+        read_benchmark_timestamps();
+    }
+
+    const bool profiling = m_pass_profiling;
+
+    if (profiling) {
+        m_pass_profiler.read_timestamps(m_device);
+    }
+
+    // Not part of the recording time the benchmark and the profiler report.
+    init_optional_passes();
+
+    // In benchmark mode every other step is recorded the way it used to be, one compute list per dispatch.
+    const int path = m_benchmark_mode && m_benchmark_frame % 2 == 0 ? BENCHMARK_PATH_SPLIT_LISTS : BENCHMARK_PATH_SINGLE_LIST;
+    ++m_benchmark_frame;
+
+    if (m_benchmark_mode) {
+        m_device->capture_timestamp(get_benchmark_timestamp_name(path, false));
+    }
+
+    const uint64_t record_start = Time::get_singleton()->get_ticks_usec();
+
+    // Read once, read_residuals() may change the plan while the step is recorded.
+    PressurePlan plan;
+    plan.multigrid = uses_multigrid();
+    plan.iterations = plan.multigrid ? get_planned_cycles() : get_planned_iterations();
+    plan.check_interval = plan.multigrid ? 1 : m_residual_check_interval;
+    // A nested grid gets its border from the parent every step, and the parent gets its interior back, so it
+    // always runs dense and with the separate extrapolation.
+    ForceField* const parent = get_nest_parent();
+    const bool sparse = m_sparse_bricks && parent == nullptr;
+    // The fused advection writes the texture from the bricks it runs on, which are all of them only while dense.
+    const bool fused = !sparse && parent == nullptr && m_fused_advection_pass.pipeline.is_valid();
+    int residual_checks;
+
+    // While the field is dense the list holds every brick, it only needs rewriting when sparse mode ends.
+    if (!sparse && m_active_bricks_sparse) {
+        const PackedByteArray bytes = create_full_brick_list();
+        m_device->buffer_update(m_active_bricks_buffer, 0, bytes.size(), bytes);
+        m_active_brick_count = get_brick_count();
+    }
+
+    m_active_bricks_sparse = sparse;
+
+    PackedVector3Array query_points;
+    Transform3D query_transform;
+
+    {
+        std::lock_guard lock(m_velocity_query_mutex);
+
+        if (m_has_pending_query) {
+            query_points = m_pending_query_points;
+            query_transform = m_pending_query_transform;
+            m_has_pending_query = false;
+        }
+    }
+
+    // The debug key prints the same record get_field_stats() returns.
+    const bool print_stats = m_print_debug_info;
+    const bool field_stats = m_field_stats_requested || print_stats;
+    m_field_stats_requested = false;
+    m_print_debug_info = false;
+
+    if (field_stats) {
+        init_field_stats_pass(m_velocity_buffers2, m_pressure_buffer, m_solid_mask_buffer, m_grid_params_buffer);
+    }
+
+    const int query_count = static_cast<int>(query_points.size());
+    const int query_slot = m_velocity_query_slot;
+
+    upload_emitters();
+
+    std::vector<ObstacleList::Region> obstacle_regions;
+    float obstacle_inv_delta_time = 0.0;
+    Vector3i scroll;
+    upload_obstacles(obstacle_regions, obstacle_inv_delta_time, scroll);
+
+    // The window moves over the buffers, only the cells it moved over are touched.
+    std::vector<ObstacleList::Region> exposed_regions;
+
+    if (scroll != Vector3i()) {
+        exposed_regions = get_exposed_regions(scroll, m_field_size);
+        update_wrap_offset(m_wrap_offset + scroll);
+    }
+
+    // Buffers can't be updated while a compute list is open, so the points go up before the step is recorded.
+    if (query_count > 0) {
+        init_velocity_query_pass(m_velocity_buffers2, m_grid_params_buffer);
+        reserve_velocity_query_slot(query_slot, query_count);
+
+        const Transform3D to_local = query_transform.affine_inverse();
+        PackedFloat32Array local_points;
+        local_points.resize(4 * query_count);
+
+        for (int i = 0; i < query_count; ++i) {
+            const Vector3 local = to_local.xform(query_points[i]);
+            local_points.set(4 * i, local.x);
+            local_points.set(4 * i + 1, local.y);
+            local_points.set(4 * i + 2, local.z);
+            local_points.set(4 * i + 3, 0.0);
+        }
+
+        const PackedByteArray bytes = local_points.to_byte_array();
+        m_device->buffer_update(m_velocity_query_pass.slots[query_slot].points_buffer, 0, bytes.size(), bytes);
+        m_velocity_query_slot = 1 - query_slot;
+    }
+
+    {
+        ComputeListRecorder recorder(m_device, path == BENCHMARK_PATH_SPLIT_LISTS);
+
+        if (profiling) {
+            m_pass_profiler.begin(m_device, recorder);
+        }
+
+        if (!exposed_regions.empty()) {
+            record_clear(recorder, exposed_regions);
+            recorder.barrier();
+        }
+
+        if (!obstacle_regions.empty()) {
+            record_obstacles(recorder, obstacle_regions, obstacle_inv_delta_time);
+            recorder.barrier();
+        }
+
+        if (m_solid_mask_dirty) {
+            record_solid_mask(recorder, Vector3i(), m_field_size);
+        } else {
+            // The mask of a cell also depends on its neighbours.
+            for (const std::vector<ObstacleList::Region>* regions : { &exposed_regions, &obstacle_regions }) {
+                for (const ObstacleList::Region& region : *regions) {
+                    const Vector3i origin = (region.origin - Vector3i(1, 1, 1)).max(Vector3i());
+                    const Vector3i end = (region.origin + region.size + Vector3i(1, 1, 1)).min(m_field_size);
+                    record_solid_mask(recorder, origin, end - origin);
+                }
+            }
+        }
+
+        if (m_solid_mask_dirty || !obstacle_regions.empty() || !exposed_regions.empty()) {
+            mark_pass(recorder, PassProfiler::PASS_SOLID_MASK);
+            recorder.barrier();
+            m_solid_mask_dirty = false;
+        }
+
+        if (sparse) {
+            record_active_bricks(recorder);
+            mark_pass(recorder, PassProfiler::PASS_ACTIVE_BRICKS);
+            recorder.barrier();
+        }
+
+        residual_checks = record_step(recorder, delta_time, plan, output, fused, parent != nullptr);
+
+        if (parent != nullptr) {
+            recorder.barrier();
+            record_nest_restriction(recorder, *parent);
+        }
+
+        if (query_count > 0) {
+            recorder.barrier();
+            record_velocity_query(recorder, query_slot, query_count);
+        }
+
+        if (field_stats) {
+            recorder.barrier();
+            record_field_stats(recorder);
+        }
+    }
+
+    const uint64_t record_end = Time::get_singleton()->get_ticks_usec();
+
+    if (m_benchmark_mode) {
+        m_device->capture_timestamp(get_benchmark_timestamp_name(path, true));
+
+        m_benchmark_stats[path].cpu_usec += record_end - record_start;
+        ++m_benchmark_stats[path].cpu_samples;
+    }
+
+    // Read back asynchronously, the result steers the iteration count of a later step.
+    m_device->buffer_get_data_async(m_residual_buffer,
+        callable_mp(this, &ForceField::read_residuals).bind(plan.iterations, plan.check_interval, plan.multigrid),
+        0, residual_checks * RESIDUAL_CHECK_SIZE);
+
+    if (sparse) {
+        m_device->buffer_get_data_async(m_active_bricks_buffer, callable_mp(this, &ForceField::read_active_brick_count),
+            ACTIVE_BRICK_COUNT_OFFSET, 4);
+    }
+
+    // Only the results come back, a vec4 per point.
+    if (query_count > 0) {
+        m_device->buffer_get_data_async(m_velocity_query_pass.slots[query_slot].results_buffer,
+            callable_mp(this, &ForceField::read_velocity_samples).bind(query_points, query_transform.basis),
+            0, query_count * 16);
+    }
+
+    if (field_stats) {
+        m_device->buffer_get_data_async(m_stats_buffer,
+            callable_mp(this, &ForceField::read_field_stats).bind(delta_time, print_stats), 0, FieldStats::SIZE);
+    }
+}
+
+void ForceField::record_solid_mask(ComputeListRecorder& recorder, Vector3i origin, Vector3i size) const {
+    const PackedInt32Array push_values{ origin.x, origin.y, origin.z, 0, size.x, size.y, size.z, 0 };
+
+    recorder.bind_pipeline(m_solid_mask_pass.pipeline);
+    recorder.bind_uniform_set(m_solid_mask_pass.solid_set, 0);
+    recorder.bind_uniform_set(m_solid_mask_pass.solid_mask_set, 1);
+    recorder.bind_uniform_set(m_solid_mask_pass.grid_parameters_set, 2);
+    recorder.set_push_constant(push_values.to_byte_array());
+    recorder.dispatch((size.x + 3) / 4, (size.y + 3) / 4, (size.z + 3) / 4);
+}
+
+void ForceField::record_obstacles(ComputeListRecorder& recorder, const std::vector<ObstacleList::Region>& regions,
+                                  float inv_delta_time) const {
+    recorder.bind_pipeline(m_obstacle_pass.pipeline);
+    recorder.bind_uniform_set(m_obstacle_pass.static_solid_set, 0);
+    recorder.bind_uniform_set(m_obstacle_pass.solid_set, 1);
+    recorder.bind_uniform_set(m_obstacle_pass.velocity_set, 2);
+    recorder.bind_uniform_set(m_obstacle_pass.grid_parameters_set, 3);
+    recorder.bind_uniform_set(m_obstacle_pass.obstacles_set, 4);
+    recorder.bind_uniform_set(m_obstacle_pass.triangles_set, 5);
+
+    // Overlapping regions write the same values to the cells they share, so they need no barriers between them.
+    for (const ObstacleList::Region& region : regions) {
+        const PackedInt32Array origin{ region.origin.x, region.origin.y, region.origin.z };
+        const PackedFloat32Array inv_delta{ inv_delta_time };
+        const PackedInt32Array size{ region.size.x, region.size.y, region.size.z, 0 };
+
+        PackedByteArray push_constants{ origin.to_byte_array() };
+        push_constants.append_array(inv_delta.to_byte_array());
+        push_constants.append_array(size.to_byte_array());
+
+        recorder.set_push_constant(push_constants);
+        recorder.dispatch((region.size.x + 3) / 4, (region.size.y + 3) / 4, (region.size.z + 3) / 4);
+    }
+}
+
+void ForceField::record_clear(ComputeListRecorder& recorder, const std::vector<ObstacleList::Region>& regions) const {
+    recorder.bind_pipeline(m_clear_pass.pipeline);
+    recorder.bind_uniform_set(m_clear_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_clear_pass.velocity2_set, 1);
+    recorder.bind_uniform_set(m_clear_pass.pressure_set, 2);
+    recorder.bind_uniform_set(m_clear_pass.solid_set, 3);
+    recorder.bind_uniform_set(m_clear_pass.static_solid_set, 4);
+    recorder.bind_uniform_set(m_clear_pass.grid_parameters_set, 5);
+
+    // The slabs of the axes the window moved along overlap in their corners, both write zeros there.
+    for (const ObstacleList::Region& region : regions) {
+        const PackedInt32Array push_values{ region.origin.x, region.origin.y, region.origin.z, 0,
+                                            region.size.x, region.size.y, region.size.z, 0 };
+
+        recorder.set_push_constant(push_values.to_byte_array());
+        recorder.dispatch((region.size.x + 3) / 4, (region.size.y + 3) / 4, (region.size.z + 3) / 4);
+    }
+}
+
+void ForceField::record_velocity_query(ComputeListRecorder& recorder, int slot, int points) const {
+    const VelocityQuerySlot& query_slot = m_velocity_query_pass.slots[slot];
+    const PackedInt32Array push_values{ points, 0, 0, 0 };
+
+    recorder.bind_pipeline(m_velocity_query_pass.pipeline);
+    recorder.bind_uniform_set(m_velocity_query_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_velocity_query_pass.grid_parameters_set, 1);
+    recorder.bind_uniform_set(query_slot.points_set, 2);
+    recorder.bind_uniform_set(query_slot.results_set, 3);
+    recorder.set_push_constant(push_values.to_byte_array());
+    recorder.dispatch((points + 63) / 64, 1, 1);
+}
+
+void ForceField::record_resample(ComputeListRecorder& recorder, const RID& source_velocity_set, const RID& source_grid_parameters_set,
+                                 const RID& velocity_set, const RID& grid_parameters_set, const ResampleRegion& region) const {
+    const PackedFloat32Array source_origin{ region.source_origin.x, region.source_origin.y, region.source_origin.z, region.footprint };
+    const PackedInt32Array box{ region.origin.x, region.origin.y, region.origin.z, region.border_only ? 1 : 0,
+                                region.size.x, region.size.y, region.size.z, 0 };
+
+    PackedByteArray push_constants{ source_origin.to_byte_array() };
+    push_constants.append_array(box.to_byte_array());
+
+    recorder.bind_pipeline(m_resample_pass.pipeline);
+    recorder.bind_uniform_set(source_velocity_set, 0);
+    recorder.bind_uniform_set(source_grid_parameters_set, 1);
+    recorder.bind_uniform_set(velocity_set, 2);
+    recorder.bind_uniform_set(grid_parameters_set, 3);
+    recorder.set_push_constant(push_constants);
+    recorder.dispatch((region.size.x + 7) / 8, (region.size.y + 7) / 8, (region.size.z + 7) / 8);
+}
+
+void ForceField::record_nest_border(ComputeListRecorder& recorder) const {
+    const Vector3i last = m_field_size - Vector3i(1, 1, 1);
+
+    // Both sides of every axis: the border cells, and on the lower side the first interior cells whose lower face
+    // is the one between them and the border.
+    for (int axis = 0; axis < 3; ++axis) {
+        ResampleRegion lower;
+        lower.source_origin = m_nest_origin;
+        lower.size = m_field_size;
+        lower.size[axis] = 2;
+        lower.border_only = true;
+
+        ResampleRegion upper = lower;
+        upper.origin[axis] = last[axis];
+        upper.size[axis] = 1;
+
+        for (const ResampleRegion& region : { lower, upper }) {
+            record_resample(recorder, m_nest_pass.parent_source_set, m_nest_pass.parent_source_grid_parameters_set,
+                m_nest_pass.border_set, m_resample_pass.grid_parameters_set, region);
+        }
+    }
+}
+
+void ForceField::record_nest_restriction(ComputeListRecorder& recorder, const ForceField& parent) const {
+    const float parent_cell_size = parent.m_cell_size;
+    const Vector3 interior_begin = m_nest_origin + Vector3(m_cell_size, m_cell_size, m_cell_size);
+    const Vector3 interior_end = m_nest_origin + Vector3(m_field_size - Vector3i(1, 1, 1)) * m_cell_size;
+
+    // The parent cells whose faces all lie in this grid's interior, less one cell on every side so the parent's
+    // faces next to the border aren't fed back the values this grid's border got from them.
+    Vector3i begin;
+    Vector3i end;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        begin[axis] = static_cast<int>(std::ceil(interior_begin[axis] / parent_cell_size)) + 1;
+        end[axis] = static_cast<int>(std::floor(interior_end[axis] / parent_cell_size)) - 1;
+    }
+
+    begin = begin.max(Vector3i(1, 1, 1));
+    end = end.min(parent.m_field_size - Vector3i(1, 1, 1));
+
+    if (end.x <= begin.x || end.y <= begin.y || end.z <= begin.z) {
+        return;
+    }
+
+    ResampleRegion region;
+    region.source_origin = -m_nest_origin;
+    region.origin = begin;
+    region.size = end - begin;
+
+    // A finer grid is averaged over the parent's face, a coarser one is only sampled.
+    if (m_cell_size < parent_cell_size) {
+        region.footprint = 0.25f * parent_cell_size;
+    }
+
+    record_resample(recorder, m_nest_pass.source_set, m_nest_pass.source_grid_parameters_set,
+        m_nest_pass.parent_target_set, m_nest_pass.parent_target_grid_parameters_set, region);
+}
+
+void ForceField::record_field_stats(ComputeListRecorder& recorder) const {
+    const int groups_x = m_field_size.x / 8;
+    const int groups_y = m_field_size.y / 8;
+    const int groups_z = m_field_size.z / 8;
+
+    recorder.bind_pipeline(m_field_stats_pass.pipeline);
+    recorder.bind_uniform_set(m_field_stats_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_field_stats_pass.pressure_set, 1);
+    recorder.bind_uniform_set(m_field_stats_pass.solid_set, 2);
+    recorder.bind_uniform_set(m_field_stats_pass.grid_parameters_set, 3);
+    recorder.bind_uniform_set(m_field_stats_pass.partials_set, 4);
+    recorder.dispatch(groups_x, groups_y, groups_z);
+
+    // Columns of a record, see field_stats.glsl: min, max, sum, then energy and count summed, the rest maxed.
+    constexpr uint32_t ops_min = REDUCE_MIN | REDUCE_MIN << 2 | REDUCE_MIN << 4 | REDUCE_MIN << 6;
+    constexpr uint32_t ops_max = REDUCE_MAX | REDUCE_MAX << 2 | REDUCE_MAX << 4 | REDUCE_MAX << 6;
+    constexpr uint32_t ops_sum = REDUCE_SUM | REDUCE_SUM << 2 | REDUCE_SUM << 4 | REDUCE_SUM << 6;
+    constexpr uint32_t ops_extra = REDUCE_SUM | REDUCE_MAX << 2 | REDUCE_MAX << 4 | REDUCE_SUM << 6;
+    constexpr uint32_t ops = ops_min | ops_max << 8 | ops_sum << 16 | ops_extra << 24;
+
+    recorder.barrier();
+    recorder.bind_pipeline(m_reduce_pass.pipeline);
+    recorder.bind_uniform_set(m_field_stats_pass.reduce_partials_set, 0);
+    recorder.bind_uniform_set(m_field_stats_pass.reduce_results_set, 1);
+    recorder.set_push_constant(get_reduce_push_constants(ops, FieldStats::COLUMNS, groups_x * groups_y * groups_z, 0));
+    recorder.dispatch(1, 1, 1);
+}
+
+void ForceField::record_active_bricks(ComputeListRecorder& recorder) const {
+    const PackedFloat32Array push_values{
+        m_activity_threshold, 0.0, 0.0, 0.0
+    };
+
+    recorder.bind_pipeline(m_active_brick_pass.mark_pipeline);
+    recorder.bind_uniform_set(m_active_brick_pass.mark_velocity_set, 0);
+    recorder.bind_uniform_set(m_active_brick_pass.mark_grid_parameters_set, 1);
+    recorder.bind_uniform_set(m_active_brick_pass.mark_emitter_set, 2);
+    recorder.bind_uniform_set(m_active_brick_pass.mark_flags_set, 3);
+    recorder.bind_uniform_set(m_active_brick_pass.mark_list_set, 4);
+    recorder.set_push_constant(push_values.to_byte_array());
+    recorder.dispatch(m_field_size.x / ACTIVE_BRICK_SIZE, m_field_size.y / ACTIVE_BRICK_SIZE, m_field_size.z / ACTIVE_BRICK_SIZE);
+
+    recorder.barrier();
+    recorder.bind_pipeline(m_active_brick_pass.compact_pipeline);
+    recorder.bind_uniform_set(m_active_brick_pass.compact_flags_set, 0);
+    recorder.bind_uniform_set(m_active_brick_pass.compact_list_set, 1);
+    recorder.bind_uniform_set(m_active_brick_pass.compact_grid_parameters_set, 2);
+    recorder.dispatch((get_brick_count() + 63) / 64, 1, 1);
+}
+
+int ForceField::record_step(ComputeListRecorder& recorder, float delta_time, const PressurePlan& plan, bool output, bool fused,
+                            bool nested) const {
+    const int groups_x = m_field_size.x / 8;
+    const int groups_y = m_field_size.y / 8;
+    const int groups_z = m_field_size.z / 8;
+
+    const PackedFloat32Array push_values{
+        delta_time, 0.0, 0.0, 0.0
+    };
+    const PackedByteArray push_constants{push_values.to_byte_array()};
+
+    recorder.bind_pipeline(m_integrate_pass.pipeline);
+    recorder.bind_uniform_set(m_integrate_pass.velocity_in_set, 0);
+    recorder.bind_uniform_set(m_integrate_pass.velocity_out_set, 1);
+    recorder.bind_uniform_set(m_integrate_pass.pressure_set, 2);
+    recorder.bind_uniform_set(m_integrate_pass.solid_set, 3);
+    recorder.bind_uniform_set(m_integrate_pass.grid_parameters_set, 4);
+    recorder.bind_uniform_set(m_integrate_pass.emitter_set, 5);
+    recorder.bind_uniform_set(m_integrate_pass.active_bricks_set, 6);
+    recorder.set_push_constant(push_constants);
+    recorder.dispatch_indirect(m_active_bricks_buffer, ACTIVE_BRICK_GROUPS_OFFSET);
+    mark_pass(recorder, PassProfiler::PASS_INTEGRATE);
+
+    // The border of a nested grid is solid, so the solve leaves the faces it gets from the parent as they are.
+    if (nested) {
+        recorder.barrier();
+        record_nest_border(recorder);
+    }
+
+    recorder.barrier();
+    const int residual_checks = record_pressure_solve(recorder, delta_time, plan);
+    mark_pass(recorder, PassProfiler::PASS_PRESSURE);
+
+    // The fused advection reads the boundary faces as zero instead. The boundary of a nested grid is the parent's.
+    if (!fused && !nested) {
+        recorder.barrier();
+        recorder.bind_pipeline(m_extrapolation_pass.pipeline);
+        recorder.bind_uniform_set(m_extrapolation_pass.velocity_set, 0);
+        recorder.bind_uniform_set(m_extrapolation_pass.grid_parameters_set, 1);
+        recorder.set_push_constant(push_constants);
+        recorder.dispatch(groups_x, groups_y, groups_z);
+        mark_pass(recorder, PassProfiler::PASS_EXTRAPOLATION);
+    }
+
+    const AdvectionPass& advection = fused ? m_fused_advection_pass : m_advection_pass;
+
+    recorder.barrier();
+    recorder.bind_pipeline(advection.pipeline);
+    recorder.bind_uniform_set(advection.velocity_in_set, 0);
+    recorder.bind_uniform_set(advection.velocity_out_set, 1);
+    recorder.bind_uniform_set(advection.solid_set, 2);
+    recorder.bind_uniform_set(advection.grid_parameters_set, 3);
+    recorder.bind_uniform_set(advection.active_bricks_set, 4);
+
+    if (fused) {
+        const PackedFloat32Array fused_delta_time{ delta_time };
+        const PackedInt32Array write_output{ output ? 1 : 0, 0, 0 };
+
+        PackedByteArray fused_push_constants{ fused_delta_time.to_byte_array() };
+        fused_push_constants.append_array(write_output.to_byte_array());
+
+        recorder.bind_uniform_set(advection.pressure_set, 5);
+        recorder.bind_uniform_set(advection.texture_set, 6);
+        recorder.set_push_constant(fused_push_constants);
+    } else {
+        recorder.set_push_constant(push_constants);
+    }
+
+    recorder.dispatch_indirect(m_active_bricks_buffer, ACTIVE_BRICK_GROUPS_OFFSET);
+    mark_pass(recorder, PassProfiler::PASS_ADVECTION);
+
+    if (!output || fused) {
+        return residual_checks;
+    }
+
+    recorder.barrier();
+    recorder.bind_pipeline(m_transfer_to_texture_pass.pipeline);
+    recorder.bind_uniform_set(m_transfer_to_texture_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_transfer_to_texture_pass.pressure_set, 1);
+    recorder.bind_uniform_set(m_transfer_to_texture_pass.texture_set, 2);
+    recorder.bind_uniform_set(m_transfer_to_texture_pass.solid_set, 3);
+    recorder.bind_uniform_set(m_transfer_to_texture_pass.grid_parameters_set, 4);
+    recorder.set_push_constant(push_constants);
+    const Vector3i tile_groups = get_tile_groups(m_field_size);
+    recorder.dispatch(tile_groups.x, tile_groups.y, tile_groups.z);
+    mark_pass(recorder, PassProfiler::PASS_COPY_TO_TEXTURE);
+
+    return residual_checks;
+}
+
+int ForceField::record_pressure_solve(ComputeListRecorder& recorder, float delta_time, const PressurePlan& plan) const {
+    if (plan.multigrid) {
+        const int cycles = plan.iterations;
+        int residual_checks = 0;
+
+        for (int c = 0; c < cycles; ++c) {
+            if (c > 0) {
+                recorder.barrier();
+            }
+
+            record_multigrid_cycle(recorder, delta_time);
+
+            // The last slot is kept for the check after the final cycle.
+            if (residual_checks < MAX_RESIDUAL_CHECKS - 1 || c + 1 == cycles) {
+                recorder.barrier();
+                record_residual(recorder, residual_checks);
+                ++residual_checks;
+            }
+        }
+
+        return residual_checks;
+    }
+
+    const int iterations = plan.iterations;
+    int residual_checks = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        if (i > 0) {
+            recorder.barrier();
+        }
+
+        record_red_black_iteration(recorder, delta_time, i);
+
+        const bool last = i + 1 == iterations;
+
+        // The last slot is kept for the check after the final iteration, so the result is never a stale one.
+        if (last || ((i + 1) % plan.check_interval == 0 && residual_checks < MAX_RESIDUAL_CHECKS - 1)) {
+            recorder.barrier();
+            record_residual(recorder, residual_checks);
+            ++residual_checks;
+        }
+    }
+
+    return residual_checks;
+}
+
+void ForceField::record_residual(ComputeListRecorder& recorder, int slot) const {
+    const int groups_x = m_field_size.x / 8;
+    const int groups_y = m_field_size.y / 8;
+    const int groups_z = m_field_size.z / 8;
+
+    recorder.bind_pipeline(m_residual_pass.pipeline);
+    recorder.bind_uniform_set(m_residual_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_residual_pass.solid_set, 1);
+    recorder.bind_uniform_set(m_residual_pass.grid_parameters_set, 2);
+    recorder.bind_uniform_set(m_residual_pass.partials_set, 3);
+    recorder.dispatch(groups_x, groups_y, groups_z);
+
+    // Max of the per-group maxima in x, sum of the squared divergences in y.
+    constexpr uint32_t ops = REDUCE_MAX | REDUCE_SUM << 2 | REDUCE_SUM << 4 | REDUCE_SUM << 6;
+
+    recorder.barrier();
+    recorder.bind_pipeline(m_reduce_pass.pipeline);
+    recorder.bind_uniform_set(m_residual_pass.reduce_partials_set, 0);
+    recorder.bind_uniform_set(m_residual_pass.reduce_results_set, 1);
+    recorder.set_push_constant(get_reduce_push_constants(ops, 1, groups_x * groups_y * groups_z, slot));
+    recorder.dispatch(1, 1, 1);
+}
+
+void ForceField::record_red_black_iteration(ComputeListRecorder& recorder, float delta_time, int iteration) const {
+    recorder.bind_pipeline(m_incompressibility_pass.pipeline);
+    recorder.bind_uniform_set(m_incompressibility_pass.velocity_set, 0);
+    recorder.bind_uniform_set(m_incompressibility_pass.solid_set, 1);
+    recorder.bind_uniform_set(m_incompressibility_pass.pressure_set, 2);
+    recorder.bind_uniform_set(m_incompressibility_pass.grid_parameters_set, 3);
+    recorder.bind_uniform_set(m_incompressibility_pass.active_bricks_set, 4);
+    recorder.set_push_constant(get_incompressibility_push_constants(delta_time, iteration));
+    recorder.dispatch_indirect(m_active_bricks_buffer,
+        m_incompressibility_pass.tiled ? ACTIVE_BRICK_GROUPS_OFFSET : ACTIVE_BLOCK_GROUPS_OFFSET);
+}
+
+void ForceField::record_multigrid_cycle(ComputeListRecorder& recorder, float delta_time) const {
+    const int smoothing = m_multigrid_smoothing_iterations;
+    const int levels = static_cast<int>(m_multigrid_levels.size());
+
+    // Pre-smoothing on the simulation grid with the regular red-black kernel.
+    for (int i = 0; i < smoothing; ++i) {
+        record_red_black_iteration(recorder, delta_time, i);
+        recorder.barrier();
+    }
+
+    // Down: the remaining divergence becomes the right hand side of the first coarse level.
+    {
+        const MultigridLevel& level = m_multigrid_levels[0];
+
+        recorder.bind_pipeline(m_multigrid_pass.restrict_velocity_pipeline);
+        recorder.bind_uniform_set(m_multigrid_pass.restrict_velocity_set, 0);
+        recorder.bind_uniform_set(m_multigrid_pass.restrict_solid_set, 1);
+        recorder.bind_uniform_set(m_multigrid_pass.restrict_grid_parameters_set, 2);
+        recorder.bind_uniform_set(level.restrict_coarse_set, 3);
+        recorder.dispatch((level.size.x + 7) / 8, (level.size.y + 7) / 8, (level.size.z + 7) / 8);
+    }
+
+    for (int l = 0; l + 1 < levels; ++l) {
+        const MultigridLevel& fine = m_multigrid_levels[l];
+        const MultigridLevel& coarse = m_multigrid_levels[l + 1];
+
+        recorder.barrier();
+        record_multigrid_smoothing(recorder, fine, smoothing);
+
+        recorder.bind_pipeline(m_multigrid_pass.restrict_pipeline);
+        recorder.bind_uniform_set(fine.restrict_fine_set, 0);
+        recorder.bind_uniform_set(coarse.restrict_coarse_set, 1);
+        recorder.dispatch((coarse.size.x + 7) / 8, (coarse.size.y + 7) / 8, (coarse.size.z + 7) / 8);
+    }
+
+    recorder.barrier();
+    record_multigrid_smoothing(recorder, m_multigrid_levels[levels - 1], MULTIGRID_COARSEST_ITERATIONS);
+
+    // Up: interpolate each correction into the next finer level and smooth again.
+    for (int l = levels - 2; l >= 0; --l) {
+        const MultigridLevel& fine = m_multigrid_levels[l];
+        const MultigridLevel& coarse = m_multigrid_levels[l + 1];
+
+        recorder.bind_pipeline(m_multigrid_pass.prolong_pipeline);
+        recorder.bind_uniform_set(fine.prolong_fine_set, 0);
+        recorder.bind_uniform_set(coarse.prolong_coarse_set, 1);
+        recorder.dispatch((fine.size.x + 7) / 8, (fine.size.y + 7) / 8, (fine.size.z + 7) / 8);
+
+        recorder.barrier();
+        record_multigrid_smoothing(recorder, fine, smoothing);
+    }
+
+    {
+        const PackedFloat32Array push_values{
+            delta_time, 0.0, 0.0, 0.0
+        };
+
+        recorder.bind_pipeline(m_multigrid_pass.correct_pipeline);
+        recorder.bind_uniform_set(m_multigrid_pass.correct_velocity_set, 0);
+        recorder.bind_uniform_set(m_multigrid_pass.correct_solid_set, 1);
+        recorder.bind_uniform_set(m_multigrid_pass.correct_pressure_set, 2);
+        recorder.bind_uniform_set(m_multigrid_pass.correct_grid_parameters_set, 3);
+        recorder.bind_uniform_set(m_multigrid_levels[0].correct_set, 4);
+        recorder.set_push_constant(push_values.to_byte_array());
+        recorder.dispatch((m_field_size.x + 7) / 8, (m_field_size.y + 7) / 8, (m_field_size.z + 7) / 8);
+    }
+
+    for (int i = 0; i < smoothing; ++i) {
+        recorder.barrier();
+        record_red_black_iteration(recorder, delta_time, i);
+    }
+}
+
+void ForceField::record_multigrid_smoothing(ComputeListRecorder& recorder, const MultigridLevel& level, int iterations) const {
+    const Vector3i tile_groups = get_tile_groups(level.size);
+
+    for (int i = 0; i < iterations; ++i) {
+        recorder.bind_pipeline(m_multigrid_pass.smooth_pipeline);
+        recorder.bind_uniform_set(level.smooth_set, 0);
+        recorder.set_push_constant(get_smooth_push_constants(i));
+        recorder.dispatch(tile_groups.x, tile_groups.y, tile_groups.z);
+        recorder.barrier();
+    }
+}
+
+Vector3i ForceField::get_supported_workgroup_size() const {
+    const Vector3i default_size = ShaderCache::Specialization().tile;
+
+    if (m_workgroup_size == default_size) {
+        return default_size;
+    }
+
+    // The other drivers take the local size from the shader's reflection, which only holds the defaults.
+    if (RenderingServer::get_singleton()->get_current_rendering_driver_name() != "vulkan") {
+        WARN_PRINT("workgroup_size needs the Vulkan driver, using " + String(default_size) + ".");
+        return default_size;
+    }
+
+    const int64_t invocations = static_cast<int64_t>(m_workgroup_size.x) * m_workgroup_size.y * m_workgroup_size.z;
+
+    if (invocations > static_cast<int64_t>(m_device->limit_get(RenderingDevice::LIMIT_MAX_COMPUTE_WORKGROUP_INVOCATIONS))) {
+        WARN_PRINT("workgroup_size " + String(m_workgroup_size) + " exceeds the device limit, using " + String(default_size) + ".");
+        return default_size;
+    }
+
+    return m_workgroup_size;
+}
+
+bool ForceField::fits_device(const Vector3i field_size) const {
+    const RenderingDevice* device = m_device != nullptr ? m_device : RenderingServer::get_singleton()->get_rendering_device();
+
+    if (device == nullptr) {
+        return true;
+    }
+
+    // The output is a 3D texture of the field, and the shaders index the buffers with 32 bit signed integers.
+    const int64_t max_axis = static_cast<int64_t>(device->limit_get(RenderingDevice::LIMIT_MAX_TEXTURE_SIZE_3D));
+    const int64_t cells = static_cast<int64_t>(field_size.x) * field_size.y * field_size.z;
+
+    return field_size.x <= max_axis && field_size.y <= max_axis && field_size.z <= max_axis && cells <= INT32_MAX;
+}
+
+ForceField::Precision ForceField::get_supported_precision() const {
+    if (m_precision != PRECISION_FP16) {
+        return m_precision;
+    }
+
+    // The fp16 fields are float16_t buffers, which need 16 bit storage buffer access on the device.
+    if (!m_device->has_feature(RenderingDevice::SUPPORTS_HALF_FLOAT)) {
+        WARN_PRINT("precision fp16 needs 16 bit storage buffers, which this device lacks, using fp32.");
+        return PRECISION_FP32;
+    }
+
+    return m_precision;
+}
+
+Vector3i ForceField::get_tile_groups(Vector3i size) const {
+    const Vector3i tile = m_specialization.tile;
+
+    return Vector3i((size.x + tile.x - 1) / tile.x, (size.y + tile.y - 1) / tile.y, (size.z + tile.z - 1) / tile.z);
+}
+
+bool ForceField::uses_multigrid() const {
+    return m_pressure_solver == PRESSURE_SOLVER_MULTIGRID && !m_multigrid_levels.empty();
+}
+
+int ForceField::get_planned_cycles() const {
+    std::lock_guard lock(m_residual_mutex);
+    return std::max(1, std::min(m_multigrid_planned_cycles, m_multigrid_cycles));
+}
+
+int ForceField::get_planned_iterations() const {
+    std::lock_guard lock(m_residual_mutex);
+    return std::max(1, std::min(m_pressure_iterations, m_max_iterations));
+}
+
+void ForceField::read_residuals(const PackedByteArray &buffer, int iterations, int check_interval, bool multigrid) {
+    const PackedFloat32Array values = buffer.to_float32_array();
+    const int checks = static_cast<int>(values.size() / 4);
+
+    if (checks == 0) {
+        return;
+    }
+
+    // Plan the next step from the first check that met the tolerance, or solve longer if none did. The last
+    // check is always the one after the final iteration.
+    int converged_iterations = -1;
+
+    for (int check = 0; check < checks; ++check) {
+        if (values[4 * check] <= m_tolerance) {
+            converged_iterations = check + 1 == checks ? iterations : std::min((check + 1) * check_interval, iterations);
+            break;
+        }
+    }
+
+    std::lock_guard lock(m_residual_mutex);
+
+    m_last_residual = values[4 * (checks - 1)];
+    m_last_residual_l2 = std::sqrt(values[4 * (checks - 1) + 1]);
+    m_last_iteration_count = iterations;
+
+    // With multigrid the counts are V-cycles, checked after every cycle.
+    int& planned = multigrid ? m_multigrid_planned_cycles : m_pressure_iterations;
+    const int limit = multigrid ? m_multigrid_cycles : m_max_iterations;
+
+    if (converged_iterations > 0) {
+        planned = converged_iterations;
+    } else {
+        planned = std::min(limit, iterations * 2);
+    }
+}
+
+void ForceField::read_active_brick_count(const PackedByteArray &buffer) {
+    if (buffer.size() < 4 || !m_active_bricks_sparse) {
+        return;
+    }
+
+    m_active_brick_count = static_cast<int>(buffer.decode_u32(0));
+}
+
+PackedByteArray ForceField::get_reduce_push_constants(uint32_t ops, int stride, int count, int result_offset) {
+    const PackedInt32Array values{ static_cast<int32_t>(ops), stride, count, result_offset };
+    return values.to_byte_array();
+}
+
+String ForceField::get_benchmark_timestamp_name(int path, bool end) const {
+    return String("ForceField ") + String::num_uint64(get_instance_id()) +
+           (path == BENCHMARK_PATH_SPLIT_LISTS ? " split lists" : " single list") +
+           (end ? " end" : " begin");
+}
+
+void ForceField::read_benchmark_timestamps() {
+    // Captured timestamps belong to a frame that has already finished on the GPU, so they lag a few steps behind.
+    const uint32_t count = m_device->get_captured_timestamps_count();
+
+    for (int path = 0; path < BENCHMARK_PATH_MAX; ++path) {
+        const String begin_name = get_benchmark_timestamp_name(path, false);
+        const String end_name = get_benchmark_timestamp_name(path, true);
+
+        uint64_t begin_time = 0;
+        uint64_t end_time = 0;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const String name = m_device->get_captured_timestamp_name(i);
+
+            if (name == begin_name) {
+                begin_time = m_device->get_captured_timestamp_gpu_time(i);
+            } else if (name == end_name) {
+                end_time = m_device->get_captured_timestamp_gpu_time(i);
+            }
+        }
+
+        if (begin_time > 0 && end_time > begin_time) {
+            m_benchmark_stats[path].gpu_usec += end_time - begin_time;
+            ++m_benchmark_stats[path].gpu_samples;
+        }
+    }
+
+    if (m_benchmark_stats[BENCHMARK_PATH_SINGLE_LIST].gpu_samples >= BENCHMARK_REPORT_INTERVAL) {
+        const Dictionary results = get_benchmark_results();
+        UtilityFunctions::print("ForceField benchmark: ", results);
+
+        for (auto& stats : m_benchmark_stats) {
+            stats = BenchmarkStats();
+        }
+    }
+}
+
+void ForceField::mark_pass(ComputeListRecorder& recorder, PassProfiler::Pass pass) const {
+    if (m_pass_profiling) {
+        m_pass_profiler.mark(m_device, recorder, pass);
+    }
+}
+
+void ForceField::add_pass_monitors() {
+    Performance* performance = Performance::get_singleton();
+
+    // The first field in the tree gets the plain category, further ones are told apart by their instance id.
+    String category = "ForceField";
+
+    if (performance->has_custom_monitor(category + "/" + PassProfiler::get_pass_name(PassProfiler::PASS_INTEGRATE) + " (ms)")) {
+        category += " " + String::num_uint64(get_instance_id());
+    }
+
+    for (int pass = 0; pass < PassProfiler::PASS_MAX; ++pass) {
+        const String id = category + "/" + PassProfiler::get_pass_name(static_cast<PassProfiler::Pass>(pass)) + " (ms)";
+        Array arguments;
+        arguments.push_back(pass);
+        performance->add_custom_monitor(id, callable_mp(this, &ForceField::get_pass_monitor_value), arguments);
+    }
+
+    m_monitor_category = category;
+}
+
+void ForceField::remove_pass_monitors() {
+    if (m_monitor_category.is_empty()) {
+        return;
+    }
+
+    Performance* performance = Performance::get_singleton();
+
+    for (int pass = 0; pass < PassProfiler::PASS_MAX; ++pass) {
+        performance->remove_custom_monitor(m_monitor_category + "/" + PassProfiler::get_pass_name(static_cast<PassProfiler::Pass>(pass)) + " (ms)");
+    }
+
+    m_monitor_category = String();
+}
+
+double ForceField::get_pass_monitor_value(int pass) const {
+    return m_pass_profiler.get_average_usec(static_cast<PassProfiler::Pass>(pass)) / 1000.0;
+}
+
+Dictionary ForceField::get_benchmark_results() const {
+    Dictionary results;
+
+    const char* names[BENCHMARK_PATH_MAX] = { "split_lists", "single_list" };
+
+    for (int path = 0; path < BENCHMARK_PATH_MAX; ++path) {
+        const BenchmarkStats& stats = m_benchmark_stats[path];
+        const String prefix = names[path];
+
+        results[prefix + "_cpu_usec"] = stats.cpu_samples > 0 ? double(stats.cpu_usec) / stats.cpu_samples : 0.0;
+        results[prefix + "_gpu_usec"] = stats.gpu_samples > 0 ? double(stats.gpu_usec) / stats.gpu_samples : 0.0;
+        results[prefix + "_samples"] = stats.gpu_samples;
+    }
+
+    return results;
+}
+
+String ForceField::get_field_shader_version() const {
+    const String precision = m_storage_precision == PRECISION_FP16 ? "fp16" : "fp32";
+
+    switch (m_field_layout) {
+        case FIELD_LAYOUT_BRICK4:
+            return precision + "_brick4";
+        case FIELD_LAYOUT_BRICK8:
+            return precision + "_brick8";
+        default:
+            return precision;
+    }
+}
+
+String ForceField::get_advection_shader_version() const {
+    // The tiled variants stage each brick and its halo in shared memory before back-tracing.
+    return m_advection_shared_tiles ? get_field_shader_version() + "_tiled" : get_field_shader_version();
+}
+
+String ForceField::get_layout_shader_version() const {
+    switch (m_field_layout) {
+        case FIELD_LAYOUT_BRICK4:
+            return "brick4";
+        case FIELD_LAYOUT_BRICK8:
+            return "brick8";
+        default:
+            return "linear";
+    }
+}
+
+FieldIndex ForceField::get_field_index() const {
+    switch (m_field_layout) {
+        case FIELD_LAYOUT_BRICK4:
+            return FieldIndex(m_field_size, 4);
+        case FIELD_LAYOUT_BRICK8:
+            return FieldIndex(m_field_size, 8);
+        default:
+            return FieldIndex(m_field_size, 1);
+    }
+}
+
+int64_t ForceField::get_field_buffer_size() const {
+    const int64_t cells = get_field_index().get_capacity();
+
+    // Half floats, see field_storage.glslinc, rounded up to whole words.
+    return m_storage_precision == PRECISION_FP16 ? ((cells + 1) / 2) * 4 : cells * 4;
+}
+
+RID ForceField::create_velocity_storage_buffer() const {
+    // All zero bits are 0.0 in either precision.
+    PackedByteArray bytes;
+    bytes.resize(get_field_buffer_size());
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+RID ForceField::create_grid_params_buffer(const Vector3i& size, float cell_size, const Vector3i& wrap) const {
+    const PackedInt32Array buffer_part1{
+        size.x,
+        size.y,
+        size.z,
+    };
+    const PackedFloat32Array buffer_part2{cell_size};
+    const PackedInt32Array buffer_part3{
+        wrap.x,
+        wrap.y,
+        wrap.z,
+        0,
+    };
+
+    PackedByteArray bytes{buffer_part1.to_byte_array()};
+    bytes.append_array(buffer_part2.to_byte_array());
+    bytes.append_array(buffer_part3.to_byte_array());
+
+    return m_buffer_pool.acquire_uniform(bytes);
+}
+
+void ForceField::update_wrap_offset(const Vector3i& wrap) {
+    // Kept inside the grid, the shaders wrap with a single compare per axis.
+    for (int axis = 0; axis < 3; ++axis) {
+        m_wrap_offset[axis] = ((wrap[axis] % m_field_size[axis]) + m_field_size[axis]) % m_field_size[axis];
+    }
+
+    const PackedInt32Array values{ m_wrap_offset.x, m_wrap_offset.y, m_wrap_offset.z, 0 };
+    const PackedByteArray bytes = values.to_byte_array();
+    m_device->buffer_update(m_grid_params_buffer, 16, bytes.size(), bytes);
+}
+
+PackedFloat32Array ForceField::create_solid_data(const Vector3i field_size, bool walls, bool shell) const {
+    PackedFloat32Array buffer;
+    buffer.resize(
+        field_size.x * field_size.y * field_size.z
+    );
+    buffer.fill(1.0);
+
+    if (walls) {
+        for (int i = 0; i < field_size.x; ++i) {
+            buffer[FieldIndex::linear(field_size, i, 0, 0)] = 0.0;
+            buffer[FieldIndex::linear(field_size, i, field_size.y - 1, field_size.z - 1)] = 0.0;
+        }
+        for (int j = 0; j < field_size.y; ++j) {
+            buffer[FieldIndex::linear(field_size, 0, j, 0)] = 0.0;
+            buffer[FieldIndex::linear(field_size, field_size.x - 1, j, field_size.z - 1)] = 0.0;
+        }
+        for (int k = 0; k < field_size.y; ++k) {
+            buffer[FieldIndex::linear(field_size, 0, 0, k)] = 0.0;
+            buffer[FieldIndex::linear(field_size, field_size.x - 1, field_size.y - 1, k)] = 0.0;
+        }
+    }
+
+    if (shell) {
+        const Vector3i last = field_size - Vector3i(1, 1, 1);
+
+        for (int k = 0; k < field_size.z; ++k) {
+            for (int j = 0; j < field_size.y; ++j) {
+                for (int i = 0; i < field_size.x; ++i) {
+                    if (i == 0 || j == 0 || k == 0 || i == last.x || j == last.y || k == last.z) {
+                        buffer[FieldIndex::linear(field_size, i, j, k)] = 0.0;
+                    }
+                }
+            }
+        }
+    }
+
+    return buffer;
+}
+
+RID ForceField::create_solid_storage_buffer(bool walls, bool shell) const {
+    const PackedFloat32Array solid = create_solid_data(m_field_size, walls, shell);
+    const FieldIndex index = get_field_index();
+
+    // create_solid_data is in linear order like the CPU solver and the multigrid levels expect it, the GPU copy
+    // follows the field layout. Padding cells stay solid.
+    PackedFloat32Array data;
+    data.resize(index.get_capacity());
+    data.fill(0.0);
+
+    for (int k = 0; k < m_field_size.z; ++k) {
+        for (int j = 0; j < m_field_size.y; ++j) {
+            for (int i = 0; i < m_field_size.x; ++i) {
+                data[index.to_index(i, j, k)] = solid[FieldIndex::linear(m_field_size, i, j, k)];
+            }
+        }
+    }
+
+    const PackedByteArray bytes = data.to_byte_array();
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+RID ForceField::create_solid_mask_buffer() const {
+    // One byte per cell packed into 32 bit words, filled by build_solid_mask.glsl.
+    PackedByteArray bytes;
+    bytes.resize(((get_field_index().get_capacity() + 3) / 4) * 4);
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+int ForceField::get_brick_count() const {
+    return (m_field_size.x / ACTIVE_BRICK_SIZE) * (m_field_size.y / ACTIVE_BRICK_SIZE) * (m_field_size.z / ACTIVE_BRICK_SIZE);
+}
+
+PackedByteArray ForceField::create_full_brick_list() const {
+    const int bricks = get_brick_count();
+
+    PackedInt32Array values;
+    values.resize(ACTIVE_BRICK_HEADER_SIZE / 4 + bricks);
+
+    // Dispatch arguments for the per-brick kernels and the red-black kernel, see active_bricks.glslinc.
+    values.set(0, bricks);
+    values.set(1, 1);
+    values.set(2, 1);
+    values.set(3, (bricks + 7) / 8);
+    values.set(4, 1);
+    values.set(5, 1);
+    values.set(6, bricks);
+    values.set(7, 0);
+
+    for (int b = 0; b < bricks; ++b) {
+        values.set(ACTIVE_BRICK_HEADER_SIZE / 4 + b, b);
+    }
+
+    return values.to_byte_array();
+}
+
+RID ForceField::create_active_bricks_buffer() const {
+    const PackedByteArray bytes = create_full_brick_list();
+
+    return m_buffer_pool.acquire_storage(bytes, RenderingDevice::STORAGE_BUFFER_USAGE_DISPATCH_INDIRECT);
+}
+
+RID ForceField::create_brick_flags_buffer() const {
+    PackedByteArray bytes;
+    bytes.resize(get_brick_count() * 4);
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+RID ForceField::create_texture(RenderingDevice* device, Vector3i size) const {
+    Ref<RDTextureFormat> texture_format;
+    texture_format.instantiate();
+
+    texture_format->set_format(m_storage_precision == PRECISION_FP16
+        ? RenderingDevice::DATA_FORMAT_R16G16B16A16_SFLOAT
+        : RenderingDevice::DATA_FORMAT_R32G32B32A32_SFLOAT);
+    texture_format->set_texture_type(RenderingDevice::TEXTURE_TYPE_3D);
+    texture_format->set_width(size.x);
+    texture_format->set_height(size.y);
+    texture_format->set_depth(size.z);
+    texture_format->set_array_layers(1);
+    texture_format->set_mipmaps(1);
+    texture_format->set_usage_bits(
+        RenderingDevice::TEXTURE_USAGE_SAMPLING_BIT |
+        RenderingDevice::TEXTURE_USAGE_STORAGE_BIT |
+        RenderingDevice::TEXTURE_USAGE_CAN_UPDATE_BIT |
+        RenderingDevice::TEXTURE_USAGE_CAN_COPY_TO_BIT |
+        RenderingDevice::TEXTURE_USAGE_CAN_COPY_FROM_BIT
+    );
+
+    Ref<RDTextureView> texture_view;
+    texture_view.instantiate();
+
+    auto texture_rid = device->texture_create(texture_format, texture_view);
+
+    device->texture_clear(texture_rid, Color(1.0, 0.0, 0.0, 1.0), 0, 1, 0, 1);
+
+    return texture_rid;
+}
+
+RID ForceField::create_zeroed_storage_buffer(int64_t capacity) const {
+    // An empty list until the first upload.
+    PackedByteArray bytes;
+    bytes.resize(capacity);
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+EmitterList ForceField::build_emitter_list() const {
+    EmitterList list;
+
+    // The emitter_pos_* box is given in fractions of the field, its cells lie strictly between the floored corners.
+    const Vector3 faces(m_requested_field_size.x, m_requested_field_size.y, m_requested_field_size.z);
+    const Vector3 corner0 = (faces * m_emitter_min).floor();
+    const Vector3 corner1 = (faces * m_emitter_max).floor();
+
+    EmitterList::Emitter box;
+    box.center = (corner0 + corner1) * 0.5;
+    box.extents = (corner1 - corner0) * 0.5 - Vector3(1.0, 1.0, 1.0);
+    box.velocity = m_emitter_velocity;
+    list.add(box);
+
+    for (int i = 0; i < m_emitters.size(); ++i) {
+        const Ref<ForceFieldEmitter> emitter = m_emitters[i];
+
+        if (emitter.is_null() || !emitter->is_enabled()) {
+            continue;
+        }
+
+        // Cell ijk is centred at (ijk + 0.5) * cell_size in the node's local space.
+        EmitterList::Emitter entry;
+        entry.center = emitter->get_position() / m_requested_cell_size - Vector3(0.5, 0.5, 0.5);
+        entry.velocity = emitter->get_velocity();
+        entry.falloff = emitter->get_falloff() / m_requested_cell_size;
+
+        if (emitter->get_shape() == ForceFieldEmitter::SHAPE_SPHERE) {
+            entry.shape = EmitterList::SHAPE_SPHERE;
+            entry.extents = Vector3(emitter->get_radius() / m_requested_cell_size, 0.0, 0.0);
+        } else {
+            entry.extents = emitter->get_size() * 0.5 / m_requested_cell_size;
+        }
+
+        list.add(entry);
+    }
+
+    list.build(m_requested_field_size, ACTIVE_BRICK_SIZE);
+
+    return list;
+}
+
+void ForceField::mark_emitters_dirty() {
+    m_emitters_dirty = true;
+}
+
+void ForceField::update_emitters() {
+    m_emitters_dirty = false;
+
+    const EmitterList list = build_emitter_list();
+
+    if (m_backend == BACKEND_CPU) {
+        m_cpu_solver.set_emitters(list);
+        return;
+    }
+
+    // Replaces an image the render thread hasn't picked up yet, so any number of changes make one upload.
+    std::lock_guard lock(m_emitter_mutex);
+    m_pending_emitter_bytes = list.to_bytes();
+    m_pending_emitter_field_size = m_requested_field_size;
+    m_pending_emitter_cell_size = m_requested_cell_size;
+}
+
+void ForceField::upload_emitters() {
+    PackedByteArray bytes;
+
+    {
+        std::lock_guard lock(m_emitter_mutex);
+
+        if (m_pending_emitter_bytes.is_empty() || m_pending_emitter_field_size != m_field_size ||
+            m_pending_emitter_cell_size != m_cell_size) {
+            return;
+        }
+
+        bytes = m_pending_emitter_bytes;
+        m_pending_emitter_bytes.clear();
+    }
+
+    reserve_emitter_buffer(bytes.size());
+
+    // Moving an emitter usually touches its record and a few brick bins, so only the range between the first and
+    // the last changed word goes up.
+    const uint8_t* next = bytes.ptr();
+    const uint8_t* last = m_uploaded_emitter_bytes.ptr();
+    const int64_t size = bytes.size();
+    const int64_t common = std::min(size, m_uploaded_emitter_bytes.size());
+
+    int64_t begin = 0;
+    int64_t end = size;
+
+    while (begin < common && next[begin] == last[begin]) {
+        ++begin;
+    }
+
+    if (size == m_uploaded_emitter_bytes.size()) {
+        while (end > begin && next[end - 1] == last[end - 1]) {
+            --end;
+        }
+    }
+
+    begin &= ~int64_t(3);
+    end = (end + 3) & ~int64_t(3);
+
+    if (begin < end) {
+        m_device->buffer_update(m_emitter_buffer, begin, end - begin, bytes.slice(begin, end));
+    }
+
+    m_uploaded_emitter_bytes = bytes;
+}
+
+bool ForceField::describe_obstacle(Node *node, ObstacleList::Obstacle &obstacle, AABB &bounds, Ref<Mesh> &mesh) {
+    if (const auto *mesh_instance = Object::cast_to<MeshInstance3D>(node)) {
+        mesh = mesh_instance->get_mesh();
+
+        if (mesh.is_null()) {
+            return false;
+        }
+
+        obstacle.shape = ObstacleList::SHAPE_MESH;
+        bounds = mesh->get_aabb();
+        return true;
+    }
+
+    const auto *collision_shape = Object::cast_to<CollisionShape3D>(node);
+
+    if (collision_shape == nullptr || collision_shape->is_disabled() || collision_shape->get_shape().is_null()) {
+        return false;
+    }
+
+    Shape3D *const shape = collision_shape->get_shape().ptr();
+
+    if (const auto *box = Object::cast_to<BoxShape3D>(shape)) {
+        obstacle.shape = ObstacleList::SHAPE_BOX;
+        obstacle.size = box->get_size() * 0.5;
+        bounds = AABB(-obstacle.size, box->get_size());
+    } else if (const auto *sphere = Object::cast_to<SphereShape3D>(shape)) {
+        const float radius = sphere->get_radius();
+        obstacle.shape = ObstacleList::SHAPE_SPHERE;
+        obstacle.size = Vector3(radius, 0.0, 0.0);
+        bounds = AABB(Vector3(-radius, -radius, -radius), Vector3(2.0f * radius, 2.0f * radius, 2.0f * radius));
+    } else if (const auto *capsule = Object::cast_to<CapsuleShape3D>(shape)) {
+        const float radius = capsule->get_radius();
+        const float height = std::max(capsule->get_height(), 2.0f * radius);
+        obstacle.shape = ObstacleList::SHAPE_CAPSULE;
+        obstacle.size = Vector3(radius, height, 0.0);
+        bounds = AABB(Vector3(-radius, -0.5f * height, -radius), Vector3(2.0f * radius, height, 2.0f * radius));
+    } else if (const auto *cylinder = Object::cast_to<CylinderShape3D>(shape)) {
+        const float radius = cylinder->get_radius();
+        const float height = cylinder->get_height();
+        obstacle.shape = ObstacleList::SHAPE_CYLINDER;
+        obstacle.size = Vector3(radius, height, 0.0);
+        bounds = AABB(Vector3(-radius, -0.5f * height, -radius), Vector3(2.0f * radius, height, 2.0f * radius));
+    } else {
+        WARN_PRINT_ONCE("ForceField obstacles support box, sphere, capsule and cylinder shapes and meshes.");
+        return false;
+    }
+
+    return true;
+}
+
+bool ForceField::uses_scrolling() const {
+    return !m_scroll_target.is_empty();
+}
+
+bool ForceField::uses_nesting() const {
+    return !m_parent_field.is_empty();
+}
+
+void ForceField::update_nest_link() {
+    if (!uses_nesting() && m_linked_parent_id == 0) {
+        return;
+    }
+
+    auto *parent = Object::cast_to<ForceField>(get_node_or_null(m_parent_field));
+
+    if (parent == this) {
+        parent = nullptr;
+    }
+
+    if (parent != nullptr && (parent->m_backend != BACKEND_GPU || parent->m_simulation_device != SIMULATION_DEVICE_MAIN
+                              || m_simulation_device != SIMULATION_DEVICE_MAIN)) {
+        WARN_PRINT_ONCE("ForceField nesting needs both fields on the GPU backend and the main simulation device.");
+        parent = nullptr;
+    }
+
+    const uint64_t parent_id = parent != nullptr ? parent->get_instance_id() : 0;
+
+    if (parent_id != m_linked_parent_id) {
+        unlink_parent();
+    }
+
+    if (parent == nullptr) {
+        return;
+    }
+
+    if (m_linked_parent_id == 0) {
+        parent->m_nested_field_ids.push_back(get_instance_id());
+        m_linked_parent_id = parent_id;
+    }
 
-    RenderingServer::get_singleton()->call_on_render_thread(callable_mp(this, &ForceField::init_compute));
+    // Both grids are taken as axis aligned in the parent's space, rotations between them are ignored.
+    const Vector3 origin = parent->to_local(get_global_position());
+    call_on_simulation_thread(callable_mp(this, &ForceField::set_nest_link).bind(parent_id, origin));
 }
 
-void ForceField::_process(double delta) {
-    if (!m_compute_ready) {
+void ForceField::unlink_parent() {
+    if (m_linked_parent_id == 0) {
         return;
     }
 
-    RenderingServer::get_singleton()->call_on_render_thread(callable_mp(this, &ForceField::run_compute));
-}
+    auto *const parent = Object::cast_to<ForceField>(ObjectDB::get_instance(m_linked_parent_id));
 
-void ForceField::_input(const Ref<InputEvent>& event) {
-    if (event->is_class("InputEventKey")) {
-        Ref<InputEventKey> event_key = event;
+    if (parent != nullptr) {
+        std::vector<uint64_t>& ids = parent->m_nested_field_ids;
+        ids.erase(std::remove(ids.begin(), ids.end(), get_instance_id()), ids.end());
+    }
 
-        if (event_key->is_pressed() && event_key->get_keycode() == KEY_D) {
-            UtilityFunctions::print("Debug Key pressed.");
-            m_print_debug_info = true;
-        }
+    m_linked_parent_id = 0;
+
+    if (m_backend == BACKEND_GPU) {
+        call_on_simulation_thread(callable_mp(this, &ForceField::set_nest_link).bind(0, Vector3()));
     }
 }
 
-Vector3i ForceField::get_field_size() const {
-    return m_field_size;
+void ForceField::set_nest_link(uint64_t parent_id, Vector3 origin) {
+    m_nest_parent_id = parent_id;
+    m_nest_origin = origin;
 }
 
-void ForceField::set_field_size(Vector3i size) {
-    m_field_size = size;
-}
+ForceField* ForceField::get_nest_parent() {
+    ForceField* parent = nullptr;
 
-float ForceField::get_cell_size() const {
-    return m_cell_size;
-}
+    if (m_nest_parent_id != 0) {
+        parent = Object::cast_to<ForceField>(ObjectDB::get_instance(m_nest_parent_id));
+    }
 
-void ForceField::set_cell_size(float size) {
-    m_cell_size = size;
-}
+    if (parent != nullptr && (!parent->m_compute_ready || parent->m_device != m_device)) {
+        parent = nullptr;
+    }
 
-Ref<Texture3DRD> ForceField::get_texture() const {
-    return m_texture;
-}
+    // The resample kernel reads both grids with the same storage.
+    if (parent != nullptr && parent->get_field_shader_version() != get_field_shader_version()) {
+        WARN_PRINT_ONCE("A nested ForceField needs the same precision and field layout as its parent.");
+        parent = nullptr;
+    }
 
-void ForceField::set_texture(const Ref<Texture3DRD> &texture) {
-    m_texture = texture;
+    if (parent == nullptr) {
+        free_nest_parent_sets(take_nest_parent_sets());
+        return nullptr;
+    }
 
-    texture->set_texture_rd_rid(m_rd_texture);
-    UtilityFunctions::print("Setting texture rendering device resource on given texture.");
-}
+    init_nest_pass();
+    update_nest_sets(*parent);
 
-Vector3 ForceField::get_emitter_position_min() const {
-    return m_emitter_min;
+    return parent;
 }
 
-void ForceField::set_emitter_position_min(const Vector3 pos) {
-    m_emitter_min = pos;
-    update_emitter_buffer();
-}
+void ForceField::update_nest_sets(const ForceField& parent) {
+    const VelocityBuffers& velocity = parent.m_velocity_buffers2;
+    const VelocityBuffers& current = m_nest_pass.parent_velocity;
+    bool valid = velocity.u == current.u && velocity.v == current.v && velocity.w == current.w
+        && parent.m_grid_params_buffer == m_nest_pass.parent_grid_parameters;
+
+    // Buffers the parent's pool evicts take the sets on them along.
+    for (const RID& uniform_set : {
+        m_nest_pass.parent_source_set, m_nest_pass.parent_source_grid_parameters_set,
+        m_nest_pass.parent_target_set, m_nest_pass.parent_target_grid_parameters_set,
+    }) {
+        valid = valid && m_device->uniform_set_is_valid(uniform_set);
+    }
 
-Vector3 ForceField::get_emitter_position_max() const {
-    return m_emitter_max;
+    if (valid) {
+        return;
+    }
+
+    free_nest_parent_sets(take_nest_parent_sets());
+
+    // The border is read from where the parent's last step ended, the restriction writes into the same buffers
+    // before the parent's next step reads them.
+    const RID& shader = m_resample_pass.shader;
+    m_nest_pass.parent_source_set = detach_uniform_set(create_velocity_set(velocity, shader, 0));
+    m_nest_pass.parent_source_grid_parameters_set = detach_uniform_set(create_grid_parameters_set(parent.m_grid_params_buffer, shader, 1));
+    m_nest_pass.parent_target_set = detach_uniform_set(create_velocity_set(velocity, shader, 2));
+    m_nest_pass.parent_target_grid_parameters_set = detach_uniform_set(create_grid_parameters_set(parent.m_grid_params_buffer, shader, 3));
+    m_nest_pass.parent_velocity = velocity;
+    m_nest_pass.parent_grid_parameters = parent.m_grid_params_buffer;
 }
 
-void ForceField::set_emitter_position_max(Vector3 pos) {
-    m_emitter_max = pos;
-    update_emitter_buffer();
+Array ForceField::take_nest_parent_sets() {
+    Array uniform_sets;
+
+    for (RID* uniform_set : {
+        &m_nest_pass.parent_source_set, &m_nest_pass.parent_source_grid_parameters_set,
+        &m_nest_pass.parent_target_set, &m_nest_pass.parent_target_grid_parameters_set,
+    }) {
+        if (uniform_set->is_valid()) {
+            uniform_sets.push_back(*uniform_set);
+            *uniform_set = RID();
+        }
+    }
+
+    m_nest_pass.parent_velocity = VelocityBuffers();
+    m_nest_pass.parent_grid_parameters = RID();
+
+    return uniform_sets;
 }
 
-Vector3 ForceField::get_emitter_velocity() const {
-    return m_emitter_velocity;
+void ForceField::free_nest_parent_sets(const Array& uniform_sets) {
+    RenderingDevice* device = RenderingServer::get_singleton()->get_rendering_device();
+
+    for (int64_t i = 0; i < uniform_sets.size(); ++i) {
+        if (device->uniform_set_is_valid(uniform_sets[i])) {
+            device->free_rid(uniform_sets[i]);
+        }
+    }
 }
 
-void ForceField::set_emitter_velocity(Vector3 velocity) {
-    m_emitter_velocity = velocity;
-    update_emitter_buffer();
+bool ForceField::contains_interior_point(const Vector3& point) const {
+    const Vector3 cell = point / m_requested_cell_size;
+    const Vector3 end = Vector3(m_requested_field_size - Vector3i(1, 1, 1));
+
+    return cell.x >= 1.0 && cell.y >= 1.0 && cell.z >= 1.0 && cell.x <= end.x && cell.y <= end.y && cell.z <= end.z;
 }
 
-void ForceField::init_compute() {
-    UtilityFunctions::print("Initializing compute shaders ...");
+std::vector<ObstacleList::Region> ForceField::update_scroll() {
+    const auto *const target = Object::cast_to<Node3D>(get_node_or_null(m_scroll_target));
 
-    m_device = RenderingServer::get_singleton()->get_rendering_device();
+    if (target == nullptr) {
+        return {};
+    }
 
-    m_velocity_buffers1.u = create_velocity_storage_buffer();
-    m_velocity_buffers1.v = create_velocity_storage_buffer();
-    m_velocity_buffers1.w = create_velocity_storage_buffer();
+    // Whole cells once the target is a full cell off the centre of the window, so a target going back and forth
+    // across a cell boundary doesn't clear the same slab every frame.
+    const Vector3 centre = Vector3(m_requested_field_size) * (0.5f * m_requested_cell_size);
+    const Vector3 offset = (to_local(target->get_global_position()) - centre) / m_requested_cell_size;
+    const Vector3i cells(static_cast<int>(offset.x), static_cast<int>(offset.y), static_cast<int>(offset.z));
 
-    m_velocity_buffers2.u = create_velocity_storage_buffer();
-    m_velocity_buffers2.v = create_velocity_storage_buffer();
-    m_velocity_buffers2.w = create_velocity_storage_buffer();
+    if (cells == Vector3i()) {
+        return {};
+    }
 
-    m_solid_buffer = create_solid_storage_buffer(true);
-    m_pressure_buffer = create_pressure_buffer();
-    m_grid_params_buffer = create_grid_params_buffer();
-    m_rd_texture = create_texture();
-    m_emitter_buffer = create_emitter_buffer();
+    const Vector3 shift = Vector3(cells) * m_requested_cell_size;
+    set_global_position(to_global(shift));
 
-    if (m_texture.is_valid()) {
-        m_texture->set_texture_rd_rid(m_rd_texture);
+    // Obstacles that stay where they are in the world keep their cells, only their place in the window changes.
+    for (ObstacleState& state : m_obstacle_states) {
+        state.transform.origin -= shift;
+        state.cell_min -= cells;
+        state.cell_max -= cells;
     }
 
-    init_integrate_pass(m_velocity_buffers2, m_velocity_buffers1, m_solid_buffer, m_pressure_buffer, m_grid_params_buffer, m_emitter_buffer);
-    init_incompressibility_pass(m_velocity_buffers1, m_solid_buffer, m_pressure_buffer, m_grid_params_buffer);
-    init_extrapolation_pass(m_velocity_buffers1, m_grid_params_buffer);
-    init_advect_pass(m_velocity_buffers1, m_velocity_buffers2, m_solid_buffer, m_grid_params_buffer);
-    init_copy_to_texture_pass(m_velocity_buffers2, m_rd_texture, m_pressure_buffer, m_solid_buffer, m_grid_params_buffer);
+    std::lock_guard lock(m_obstacle_mutex);
 
-    UtilityFunctions::print("Done.");
+    m_pending_scroll += cells;
 
-    m_compute_ready = true;
-}
+    // Regions the render thread hasn't taken yet go with the scroll, into the window after it.
+    std::vector<ObstacleList::Region> regions;
 
-void ForceField::init_integrate_pass(const VelocityBuffers &velocity_in, const VelocityBuffers &velocity_out,
-                                     const RID &solids, const RID& pressure, const RID &grid_parameters, const RID& emitter_buffer) {
-    ResourceLoader *const loader = ResourceLoader::get_singleton();
-    const Ref<RDShaderFile> shader_file = loader->load("res://extensions/force-field/shaders/integrate.glsl");
-    const auto shader = m_device->shader_create_from_spirv(shader_file->get_spirv());
+    for (const ObstacleList::Region& region : m_pending_obstacle_regions) {
+        const Vector3i begin = (region.origin - cells).max(Vector3i());
+        const Vector3i end = (region.origin + region.size - cells).min(m_requested_field_size);
 
-    m_integrate_pass.velocity_in_set = create_velocity_set(velocity_in, shader, 0);
-    m_integrate_pass.velocity_out_set = create_velocity_set(velocity_out, shader, 1);
-    m_integrate_pass.pressure_set = create_pressure_set(pressure, shader, 2);
-    m_integrate_pass.solid_set = create_solid_set(solids, shader, 3);
-    m_integrate_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 4);
-    m_integrate_pass.emitter_set = create_emitter_set(emitter_buffer, shader, 5);
-    m_integrate_pass.pipeline = m_device->compute_pipeline_create(shader);
-    m_integrate_pass.shader = shader;
-}
+        if (end.x > begin.x && end.y > begin.y && end.z > begin.z) {
+            regions.push_back({ begin, end - begin });
+        }
+    }
 
-void ForceField::init_incompressibility_pass(const VelocityBuffers &velocity, const RID &solid,
-                                             const RID& pressure, const RID &grid_parameters) {
-    ResourceLoader *const loader = ResourceLoader::get_singleton();
-    const Ref<RDShaderFile> shader_file = loader->load(
-        "res://extensions/force-field/shaders/solve_incompressibility.glsl");
-    const auto shader = m_device->shader_create_from_spirv(shader_file->get_spirv());
+    m_pending_obstacle_regions = std::move(regions);
 
-    m_incompressibility_pass.velocity_set = create_velocity_set(velocity, shader, 0);
-    m_incompressibility_pass.solid_set = create_solid_set(solid, shader, 1);
-    m_incompressibility_pass.pressure_set = create_pressure_set(pressure, shader, 2);
-    m_incompressibility_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
-    m_incompressibility_pass.pipeline = m_device->compute_pipeline_create(shader);
-    m_incompressibility_pass.shader = shader;
+    return get_exposed_regions(cells, m_requested_field_size);
 }
 
-void ForceField::init_extrapolation_pass(const VelocityBuffers &velocity, const RID &grid_parameters) {
-    ResourceLoader *const loader = ResourceLoader::get_singleton();
-    const Ref<RDShaderFile> shader_file = loader->load(
-        "res://extensions/force-field/shaders/extrapolation.glsl");
-    const auto shader = m_device->shader_create_from_spirv(shader_file->get_spirv());
+std::vector<ObstacleList::Region> ForceField::get_exposed_regions(Vector3i scroll, Vector3i size) {
+    std::vector<ObstacleList::Region> regions;
 
-    m_extrapolation_pass.velocity_set = create_velocity_set(velocity, shader, 0);
-    m_extrapolation_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 1);
-    m_extrapolation_pass.pipeline = m_device->compute_pipeline_create(shader);
-    m_extrapolation_pass.shader = shader;
-}
+    // A slab across the whole window per axis, on the side it moved towards.
+    for (int axis = 0; axis < 3; ++axis) {
+        const int cells = std::min(std::abs(scroll[axis]), size[axis]);
 
-void ForceField::init_advect_pass(const VelocityBuffers &velocity_in, const VelocityBuffers &velocity_out,
-                                  const RID &solid, const RID &grid_parameters) {
-    ResourceLoader *const loader = ResourceLoader::get_singleton();
-    const Ref<RDShaderFile> shader_file = loader->load(
-        "res://extensions/force-field/shaders/advection.glsl");
-    const auto shader = m_device->shader_create_from_spirv(shader_file->get_spirv());
+        if (cells == 0) {
+            continue;
+        }
+
+        ObstacleList::Region region { Vector3i(), size };
+        region.origin[axis] = scroll[axis] > 0 ? size[axis] - cells : 0;
+        region.size[axis] = cells;
+        regions.push_back(region);
+    }
 
-    m_advection_pass.velocity_in_set = create_velocity_set(velocity_in, shader, 0);
-    m_advection_pass.velocity_out_set = create_velocity_set(velocity_out, shader, 1);
-    m_advection_pass.solid_set = create_solid_set(solid, shader, 2);
-    m_advection_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 3);
-    m_advection_pass.pipeline = m_device->compute_pipeline_create(shader);
-    m_advection_pass.shader = shader;
+    return regions;
 }
 
-void ForceField::init_copy_to_texture_pass(const VelocityBuffers &velocity, const RID &texture, const RID& pressure, const RID &solid,
-                                           const RID &grid_parameters) {
-    ResourceLoader *const loader = ResourceLoader::get_singleton();
-    const Ref<RDShaderFile> shader_file = loader->load("res://extensions/force-field/shaders/copy_to_texture.glsl");
-    const auto shader = m_device->shader_create_from_spirv(shader_file->get_spirv());
+void ForceField::update_obstacles(double delta, const std::vector<ObstacleList::Region>& exposed) {
+    // The grid was rebuilt, every obstacle is written into it again.
+    if (m_obstacles_reset.exchange(false)) {
+        m_obstacle_states.clear();
+    }
 
-    TypedArray<RDUniform> texture_uniforms;
-    Ref<RDUniform> texture_uniform;
-    texture_uniform.instantiate();
+    if (m_obstacles.is_empty() && m_obstacle_states.empty()) {
+        return;
+    }
 
-    texture_uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_IMAGE);
-    texture_uniform->set_binding(0);
-    texture_uniform->add_id(texture);
-    texture_uniforms.push_back(texture_uniform);
+    const Transform3D to_field = get_global_transform().affine_inverse();
 
-    m_transfer_to_texture_pass.velocity_set = create_velocity_set(velocity, shader, 0);
-    m_transfer_to_texture_pass.pressure_set = create_pressure_set(pressure, shader, 1);
-    m_transfer_to_texture_pass.texture_set = m_device->uniform_set_create(texture_uniforms, shader, 2);
-    m_transfer_to_texture_pass.solid_set = create_solid_set(solid, shader, 3);
-    m_transfer_to_texture_pass.grid_parameters_set = create_grid_parameters_set(grid_parameters, shader, 4);
-    m_transfer_to_texture_pass.pipeline = m_device->compute_pipeline_create(shader);
-    m_transfer_to_texture_pass.shader = shader;
-}
+    ObstacleList list;
+    std::vector<ObstacleState> states;
+    std::vector<ObstacleList::Region> regions;
+    bool triangles_changed = false;
 
-void ForceField::run_compute() {
-    constexpr float delta_time = 0.016;
-    const int groups_x = m_field_size.x / 8;
-    const int groups_y = m_field_size.y / 8;
-    const int groups_z = m_field_size.z / 8;
+    const auto add_region = [&](Vector3i cell_min, Vector3i cell_max) {
+        // One more cell on each side for the faces between the obstacle and the fluid around it.
+        cell_min = (cell_min - Vector3i(1, 1, 1)).max(Vector3i());
+        cell_max = (cell_max + Vector3i(1, 1, 1)).min(m_requested_field_size - Vector3i(1, 1, 1));
 
-    const PackedFloat32Array push_values{
-        delta_time, 0.0, 0.0, 0.0
+        if (cell_max.x >= cell_min.x && cell_max.y >= cell_min.y && cell_max.z >= cell_min.z) {
+            regions.push_back({ cell_min, cell_max - cell_min + Vector3i(1, 1, 1) });
+        }
     };
-    const PackedByteArray push_constants{push_values.to_byte_array()};
 
-    {
-        const auto cl = m_device->compute_list_begin();
+    for (int i = 0; i < m_obstacles.size(); ++i) {
+        auto *const node = Object::cast_to<Node3D>(get_node_or_null(m_obstacles[i]));
 
-        m_device->compute_list_bind_compute_pipeline(cl, m_integrate_pass.pipeline);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.velocity_in_set, 0);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.velocity_out_set, 1);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.pressure_set, 2);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.solid_set, 3);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.grid_parameters_set, 4);
-        m_device->compute_list_bind_uniform_set(cl, m_integrate_pass.emitter_set, 5);
-        m_device->compute_list_set_push_constant(cl, push_constants, push_constants.size());
-        m_device->compute_list_dispatch(cl, groups_x, groups_y, groups_z);
-        m_device->compute_list_end();
-    }
+        ObstacleList::Obstacle obstacle;
+        ObstacleState state;
+        AABB bounds;
+
+        if (node == nullptr || !node->is_visible_in_tree() || !describe_obstacle(node, obstacle, bounds, state.mesh)) {
+            continue;
+        }
+
+        state.node_id = node->get_instance_id();
+        state.transform = to_field * node->get_global_transform();
+        ObstacleList::get_cell_range(state.transform.xform(bounds), m_requested_cell_size, m_requested_field_size, state.cell_min, state.cell_max);
+
+        const auto previous = std::find_if(m_obstacle_states.begin(), m_obstacle_states.end(),
+            [&](const ObstacleState& candidate) { return candidate.node_id == state.node_id; });
+        const bool known = previous != m_obstacle_states.end();
 
-    for (int i = 0; i < 100; ++i) {
-        const auto cl = m_device->compute_list_begin();
+        state.moving = known && previous->transform != state.transform;
 
-        m_device->compute_list_bind_compute_pipeline(cl, m_incompressibility_pass.pipeline);
-        m_device->compute_list_bind_uniform_set(cl, m_incompressibility_pass.velocity_set, 0);
-        m_device->compute_list_bind_uniform_set(cl, m_incompressibility_pass.solid_set, 1);
-        m_device->compute_list_bind_uniform_set(cl, m_incompressibility_pass.pressure_set, 2);
-        m_device->compute_list_bind_uniform_set(cl, m_incompressibility_pass.grid_parameters_set, 3);
+        if (state.mesh.is_valid()) {
+            state.faces = known && previous->mesh == state.mesh ? previous->faces : state.mesh->get_faces();
+            obstacle.first_triangle = list.add_triangles(state.faces);
+            obstacle.triangle_count = static_cast<uint32_t>(state.faces.size() / 3);
+        }
+
+        if (!known || previous->mesh != state.mesh) {
+            triangles_changed = true;
+        }
+
+        // The frame after an obstacle stops its cells are written once more, with zero velocity. Cells the window
+        // of a scrolling field has just moved over were cleared, obstacles reaching into them are written again.
+        const bool exposed_cells = std::any_of(exposed.begin(), exposed.end(), [&](const ObstacleList::Region& region) {
+            const Vector3i end = region.origin + region.size - Vector3i(1, 1, 1);
+            return state.cell_min.x <= end.x && state.cell_min.y <= end.y && state.cell_min.z <= end.z &&
+                   state.cell_max.x >= region.origin.x && state.cell_max.y >= region.origin.y && state.cell_max.z >= region.origin.z;
+        });
 
-        const auto incomp_push_constants = get_incompressibility_push_constants(delta_time, i);
-        m_device->compute_list_set_push_constant(cl, incomp_push_constants, incomp_push_constants.size());
+        if (!known || state.moving || previous->moving || exposed_cells) {
+            add_region(state.cell_min, state.cell_max);
 
-        m_device->compute_list_dispatch(cl, groups_x / 2, groups_y / 2, groups_z / 2);
-        m_device->compute_list_end();
+            if (known) {
+                add_region(previous->cell_min, previous->cell_max);
+            }
+        }
+
+        obstacle.to_shape = state.transform.affine_inverse();
+        obstacle.previous = known ? previous->transform : state.transform;
+        obstacle.cell_min = state.cell_min;
+        obstacle.cell_max = state.cell_max;
+
+        list.add(obstacle);
+        states.push_back(state);
     }
 
-    {
-        const auto cl = m_device->compute_list_begin();
+    // Cells of removed obstacles fall back to the static solids.
+    for (const ObstacleState& old_state : m_obstacle_states) {
+        const bool kept = std::any_of(states.begin(), states.end(),
+            [&](const ObstacleState& state) { return state.node_id == old_state.node_id; });
 
-        m_device->compute_list_bind_compute_pipeline(cl, m_extrapolation_pass.pipeline);
-        m_device->compute_list_bind_uniform_set(cl, m_extrapolation_pass.velocity_set, 0);
-        m_device->compute_list_bind_uniform_set(cl, m_extrapolation_pass.grid_parameters_set, 1);
-        m_device->compute_list_set_push_constant(cl, push_constants, push_constants.size());
-        m_device->compute_list_dispatch(cl, groups_x, groups_y, groups_z);
-        m_device->compute_list_end();
+        if (!kept) {
+            add_region(old_state.cell_min, old_state.cell_max);
+            triangles_changed = true;
+        }
     }
 
-    {
-        const auto cl = m_device->compute_list_begin();
+    m_obstacle_states = std::move(states);
 
-        m_device->compute_list_bind_compute_pipeline(cl, m_advection_pass.pipeline);
-        m_device->compute_list_bind_uniform_set(cl, m_advection_pass.velocity_in_set, 0);
-        m_device->compute_list_bind_uniform_set(cl, m_advection_pass.velocity_out_set, 1);
-        m_device->compute_list_bind_uniform_set(cl, m_advection_pass.solid_set, 2);
-        m_device->compute_list_bind_uniform_set(cl, m_advection_pass.grid_parameters_set, 3);
-        m_device->compute_list_set_push_constant(cl, push_constants, push_constants.size());
-        m_device->compute_list_dispatch(cl, groups_x, groups_y, groups_z);
-        m_device->compute_list_end();
+    if (regions.empty()) {
+        return;
     }
 
-    {
-        const auto cl = m_device->compute_list_begin();
+    std::lock_guard lock(m_obstacle_mutex);
 
-        m_device->compute_list_bind_compute_pipeline(cl, m_transfer_to_texture_pass.pipeline);
-        m_device->compute_list_bind_uniform_set(cl, m_transfer_to_texture_pass.velocity_set, 0);
-        m_device->compute_list_bind_uniform_set(cl, m_transfer_to_texture_pass.pressure_set, 1);
-        m_device->compute_list_bind_uniform_set(cl, m_transfer_to_texture_pass.texture_set, 2);
-        m_device->compute_list_bind_uniform_set(cl, m_transfer_to_texture_pass.solid_set, 3);
-        m_device->compute_list_bind_uniform_set(cl, m_transfer_to_texture_pass.grid_parameters_set, 4);
-        m_device->compute_list_set_push_constant(cl, push_constants, push_constants.size());
-        m_device->compute_list_dispatch(cl, groups_x, groups_y, groups_z);
-        m_device->compute_list_end();
+    m_pending_obstacle_bytes = list.to_bytes();
+    m_pending_obstacle_inv_delta = delta > 0.0 ? static_cast<float>(1.0 / delta) : 0.0f;
+    m_pending_obstacle_regions.insert(m_pending_obstacle_regions.end(), regions.begin(), regions.end());
+    m_pending_obstacle_field_size = m_requested_field_size;
+    m_pending_obstacle_cell_size = m_requested_cell_size;
+
+    if (triangles_changed) {
+        m_pending_triangle_bytes = list.triangles_to_bytes();
+        m_pending_triangles = true;
     }
 
-    if (m_print_debug_info) {
-        m_print_debug_info = false;
-        m_device->buffer_get_data_async(m_velocity_buffers1.u, callable_mp(this, &ForceField::read_velocity_buffer));
-        m_device->buffer_get_data_async(m_velocity_buffers1.v, callable_mp(this, &ForceField::read_velocity_buffer));
-        m_device->buffer_get_data_async(m_velocity_buffers1.w, callable_mp(this, &ForceField::read_velocity_buffer));
-        m_device->buffer_get_data_async(m_pressure_buffer, callable_mp(this, &ForceField::read_velocity_buffer));
+    if (m_pending_obstacle_regions.size() > MAX_OBSTACLE_REGIONS) {
+        Vector3i begin = m_pending_obstacle_regions[0].origin;
+        Vector3i end = begin + m_pending_obstacle_regions[0].size;
+
+        for (const ObstacleList::Region& region : m_pending_obstacle_regions) {
+            begin = begin.min(region.origin);
+            end = end.max(region.origin + region.size);
+        }
+
+        m_pending_obstacle_regions = { { begin, end - begin } };
     }
 }
 
-RID ForceField::create_velocity_storage_buffer() const {
-    PackedFloat32Array data;
-    data.resize(
-        m_field_size.x * m_field_size.y * m_field_size.z
-    );
-    data.fill(0.0);
+void ForceField::upload_obstacles(std::vector<ObstacleList::Region> &regions, float &inv_delta_time, Vector3i &scroll) {
+    PackedByteArray bytes;
+    PackedByteArray triangles;
+    bool upload_triangles;
 
-    const PackedByteArray bytes = data.to_byte_array();
+    {
+        std::lock_guard lock(m_obstacle_mutex);
 
-    return m_device->storage_buffer_create(bytes.size(), bytes, 0, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
-}
+        // Taken with the regions, which are in the window the scroll leads to.
+        scroll = m_pending_scroll;
+        m_pending_scroll = Vector3i();
 
-RID ForceField::create_grid_params_buffer() const {
-    const PackedInt32Array buffer_part1{
-        m_field_size.x,
-        m_field_size.y,
-        m_field_size.z,
-    };
-    const PackedFloat32Array buffer_part2{m_cell_size};
+        if (m_pending_obstacle_regions.empty() || m_pending_obstacle_field_size != m_field_size ||
+            m_pending_obstacle_cell_size != m_cell_size) {
+            return;
+        }
 
-    PackedByteArray bytes{buffer_part1.to_byte_array()};
-    bytes.append_array(buffer_part2.to_byte_array());
+        regions.swap(m_pending_obstacle_regions);
+        inv_delta_time = m_pending_obstacle_inv_delta;
+        bytes = m_pending_obstacle_bytes;
+        triangles = m_pending_triangle_bytes;
+        upload_triangles = m_pending_triangles;
+        m_pending_triangles = false;
+    }
+
+    init_obstacle_pass(m_static_solid_buffer, m_solid_buffer, m_velocity_buffers2, m_grid_params_buffer);
+    reserve_obstacle_buffers(bytes.size(), upload_triangles ? triangles.size() : 0);
+    m_device->buffer_update(m_obstacle_buffer, 0, bytes.size(), bytes);
 
-    return m_device->uniform_buffer_create(bytes.size(), bytes, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
+    if (upload_triangles && !triangles.is_empty()) {
+        m_device->buffer_update(m_obstacle_triangle_buffer, 0, triangles.size(), triangles);
+    }
 }
 
-RID ForceField::create_solid_storage_buffer(bool walls) const {
-    PackedFloat32Array buffer;
-    buffer.resize(
-        m_field_size.x * m_field_size.y * m_field_size.z
-    );
-    buffer.fill(1.0);
+void ForceField::reserve_obstacle_buffers(int64_t size, int64_t triangles_size) {
+    if (size <= m_obstacle_buffer_capacity && triangles_size <= m_obstacle_triangle_capacity) {
+        return;
+    }
 
-    if (walls) {
-        for (int i = 0; i < m_field_size.x; ++i) {
-            buffer[to_index(i, 0, 0)] = 0.0;
-            buffer[to_index(i, m_field_size.y - 1, m_field_size.z - 1)] = 0.0;
-        }
-        for (int j = 0; j < m_field_size.y; ++j) {
-            buffer[to_index(0, j, 0)] = 0.0;
-            buffer[to_index(m_field_size.x - 1, j, m_field_size.z - 1)] = 0.0;
-        }
-        for (int k = 0; k < m_field_size.y; ++k) {
-            buffer[to_index(0, 0, k)] = 0.0;
-            buffer[to_index(m_field_size.x - 1, m_field_size.y - 1, k)] = 0.0;
+    // The buffers go back to the pool, their sets would otherwise live as long as the buffers.
+    if (size > m_obstacle_buffer_capacity) {
+        while (m_obstacle_buffer_capacity < size) {
+            m_obstacle_buffer_capacity *= 2;
         }
+
+        free_uniform_set(m_obstacle_pass.obstacles_set);
+        release_buffer(m_obstacle_buffer);
+        m_obstacle_buffer = create_zeroed_storage_buffer(m_obstacle_buffer_capacity);
+        m_obstacle_pass.obstacles_set = create_storage_set(m_obstacle_buffer, m_obstacle_pass.shader, 4);
     }
 
-    const PackedByteArray bytes = buffer.to_byte_array();
-    return m_device->storage_buffer_create(bytes.size(), bytes, 0, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
-}
+    if (triangles_size > m_obstacle_triangle_capacity) {
+        while (m_obstacle_triangle_capacity < triangles_size) {
+            m_obstacle_triangle_capacity *= 2;
+        }
 
-RID ForceField::create_texture() const {
-    Ref<RDTextureFormat> texture_format;
-    texture_format.instantiate();
+        free_uniform_set(m_obstacle_pass.triangles_set);
+        release_buffer(m_obstacle_triangle_buffer);
+        m_obstacle_triangle_buffer = create_zeroed_storage_buffer(m_obstacle_triangle_capacity);
+        m_obstacle_pass.triangles_set = create_storage_set(m_obstacle_triangle_buffer, m_obstacle_pass.shader, 5);
+    }
+}
 
-    texture_format->set_format(RenderingDevice::DATA_FORMAT_R32G32B32A32_SFLOAT);
-    texture_format->set_texture_type(RenderingDevice::TEXTURE_TYPE_3D);
-    texture_format->set_width(m_field_size.x);
-    texture_format->set_height(m_field_size.y);
-    texture_format->set_depth(m_field_size.z);
-    texture_format->set_array_layers(1);
-    texture_format->set_mipmaps(1);
-    texture_format->set_usage_bits(
-        RenderingDevice::TEXTURE_USAGE_SAMPLING_BIT |
-        RenderingDevice::TEXTURE_USAGE_STORAGE_BIT |
-        RenderingDevice::TEXTURE_USAGE_CAN_UPDATE_BIT |
-        RenderingDevice::TEXTURE_USAGE_CAN_COPY_TO_BIT |
-        RenderingDevice::TEXTURE_USAGE_CAN_COPY_FROM_BIT
-    );
+void ForceField::reserve_emitter_buffer(int64_t size) {
+    if (size <= m_emitter_buffer_capacity) {
+        return;
+    }
 
-    Ref<RDTextureView> texture_view;
-    texture_view.instantiate();
+    int64_t capacity = m_emitter_buffer_capacity;
 
-    auto texture_rid = m_device->texture_create(texture_format, texture_view);
+    while (capacity < size) {
+        capacity *= 2;
+    }
 
-    m_device->texture_clear(texture_rid, Color(1.0, 0.0, 0.0, 1.0), 0, 1, 0, 1);
+    // The buffer goes back to the pool, its sets would otherwise live as long as the buffer.
+    free_uniform_set(m_integrate_pass.emitter_set);
+    free_uniform_set(m_active_brick_pass.mark_emitter_set);
+    release_buffer(m_emitter_buffer);
 
-    return texture_rid;
+    m_emitter_buffer = create_zeroed_storage_buffer(capacity);
+    m_emitter_buffer_capacity = capacity;
+    m_uploaded_emitter_bytes.clear();
+    m_integrate_pass.emitter_set = create_emitter_set(m_emitter_buffer, m_integrate_pass.shader, 5);
+    m_active_brick_pass.mark_emitter_set = create_emitter_set(m_emitter_buffer, m_active_brick_pass.mark_shader, 2);
 }
 
-RID ForceField::create_emitter_buffer() const {
-    const auto bytes = create_emitter_bytes(m_emitter_min, m_emitter_max, m_emitter_velocity);
-    return m_device->uniform_buffer_create(bytes.size(), bytes, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
-}
+RID ForceField::create_pressure_buffer() const {
+    PackedByteArray bytes;
+    bytes.resize(get_field_buffer_size());
+    bytes.fill(0);
 
-void ForceField::update_emitter_buffer() const {
-    if (!m_emitter_buffer.is_valid()) {
-        return;
-    }
-    const auto bytes = create_emitter_bytes(m_emitter_min, m_emitter_max, m_emitter_velocity);
-    m_device->buffer_update(m_emitter_buffer, 0.0, bytes.size(), bytes);
+    return m_buffer_pool.acquire_storage(bytes);
 }
 
-RID ForceField::create_pressure_buffer() const {
+RID ForceField::create_level_buffer(const Vector3i& size) const {
     PackedFloat32Array data;
-    data.resize(m_field_size.x * m_field_size.y * m_field_size.z);
+    data.resize(size.x * size.y * size.z);
     data.fill(0.0);
 
     const PackedByteArray bytes = data.to_byte_array();
 
-    return m_device->storage_buffer_create(bytes.size(), bytes, 0, RenderingDevice::BUFFER_CREATION_AS_STORAGE_BIT);
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+PackedFloat32Array ForceField::restrict_solid_data(const PackedFloat32Array& solid, const Vector3i& size, const Vector3i& coarse_size) {
+    PackedFloat32Array coarse;
+    coarse.resize(coarse_size.x * coarse_size.y * coarse_size.z);
+
+    // Fluid fraction of the children that exist, odd sizes leave the last coarse cell with fewer of them.
+    for (int k = 0; k < coarse_size.z; ++k) {
+        for (int j = 0; j < coarse_size.y; ++j) {
+            for (int i = 0; i < coarse_size.x; ++i) {
+                float fluid = 0.0;
+                int children = 0;
+
+                for (int c = 0; c < 8; ++c) {
+                    const int fi = 2 * i + (c & 1);
+                    const int fj = 2 * j + ((c >> 1) & 1);
+                    const int fk = 2 * k + ((c >> 2) & 1);
+
+                    if (fi >= size.x || fj >= size.y || fk >= size.z) {
+                        continue;
+                    }
+
+                    fluid += solid[fk * size.x * size.y + fj * size.x + fi];
+                    ++children;
+                }
+
+                coarse[k * coarse_size.x * coarse_size.y + j * coarse_size.x + i] = fluid / float(children);
+            }
+        }
+    }
+
+    return coarse;
+}
+
+RID ForceField::create_reduction_buffer(int records) const {
+    PackedByteArray bytes;
+    bytes.resize(records * RESIDUAL_CHECK_SIZE);
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
+}
+
+RID ForceField::create_query_buffer(int points) const {
+    PackedByteArray bytes;
+    bytes.resize(points * 16);
+    bytes.fill(0);
+
+    return m_buffer_pool.acquire_storage(bytes);
 }
 
 RID ForceField::create_velocity_set(const VelocityBuffers &storage_buffers, const RID &shader, int set) const {
@@ -469,7 +3807,7 @@ RID ForceField::create_velocity_set(const VelocityBuffers &storage_buffers, cons
     uniforms.push_back(v_uniform);
     uniforms.push_back(w_uniform);
 
-    return m_device->uniform_set_create(uniforms, shader, set);
+    return create_uniform_set(uniforms, shader, set);
 }
 
 RID ForceField::create_grid_parameters_set(const RID &parameter_buffer, const RID &shader, int set) const {
@@ -483,7 +3821,7 @@ RID ForceField::create_grid_parameters_set(const RID &parameter_buffer, const RI
 
     uniforms.push_back(uniform);
 
-    return m_device->uniform_set_create(uniforms, shader, set);
+    return create_uniform_set(uniforms, shader, set);
 }
 
 RID ForceField::create_solid_set(const RID &solid_buffer, const RID &shader, int set) const {
@@ -497,7 +3835,7 @@ RID ForceField::create_solid_set(const RID &solid_buffer, const RID &shader, int
 
     uniforms.push_back(uniform);
 
-    return m_device->uniform_set_create(uniforms, shader, set);
+    return create_uniform_set(uniforms, shader, set);
 }
 
 RID ForceField::create_emitter_set(const RID &emitter_buffer, const RID &shader, int set) const {
@@ -505,13 +3843,13 @@ RID ForceField::create_emitter_set(const RID &emitter_buffer, const RID &shader,
     Ref<RDUniform> uniform;
     uniform.instantiate();
 
-    uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_UNIFORM_BUFFER);
+    uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
     uniform->set_binding(0);
     uniform->add_id(emitter_buffer);
 
     uniforms.push_back(uniform);
 
-    return m_device->uniform_set_create(uniforms, shader, set);
+    return create_uniform_set(uniforms, shader, set);
 }
 
 RID ForceField::create_pressure_set(const RID& pressure_buffer, const RID &shader, int set) const {
@@ -525,11 +3863,62 @@ RID ForceField::create_pressure_set(const RID& pressure_buffer, const RID &shade
 
     uniforms.push_back(uniform);
 
-    return m_device->uniform_set_create(uniforms, shader, set);
+    return create_uniform_set(uniforms, shader, set);
+}
+
+RID ForceField::create_storage_set(const RID &buffer, const RID &shader, int set) const {
+    TypedArray<RDUniform> uniforms;
+    Ref<RDUniform> uniform;
+    uniform.instantiate();
+
+    uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
+    uniform->set_binding(0);
+    uniform->add_id(buffer);
+
+    uniforms.push_back(uniform);
+
+    return create_uniform_set(uniforms, shader, set);
+}
+
+RID ForceField::create_image_set(const RID &texture, const RID &shader, int set) const {
+    TypedArray<RDUniform> uniforms;
+    Ref<RDUniform> uniform;
+    uniform.instantiate();
+
+    uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_IMAGE);
+    uniform->set_binding(0);
+    uniform->add_id(texture);
+
+    uniforms.push_back(uniform);
+
+    return create_uniform_set(uniforms, shader, set);
 }
 
-int ForceField::to_index(int i, int j, int k) const {
-    return k * m_field_size.x * m_field_size.y + j * m_field_size.x + i;
+RID ForceField::create_level_set(const MultigridLevel &level, const RID &shader, int set) const {
+    TypedArray<RDUniform> uniforms;
+    const RID buffers[3] = { level.phi, level.rhs, level.solid };
+
+    for (int binding = 0; binding < 3; ++binding) {
+        Ref<RDUniform> uniform;
+        uniform.instantiate();
+
+        uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_STORAGE_BUFFER);
+        uniform->set_binding(binding);
+        uniform->add_id(buffers[binding]);
+
+        uniforms.push_back(uniform);
+    }
+
+    Ref<RDUniform> parameters_uniform;
+    parameters_uniform.instantiate();
+
+    parameters_uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_UNIFORM_BUFFER);
+    parameters_uniform->set_binding(3);
+    parameters_uniform->add_id(level.grid_parameters);
+
+    uniforms.push_back(parameters_uniform);
+
+    return create_uniform_set(uniforms, shader, set);
 }
 
 PackedByteArray ForceField::get_incompressibility_push_constants(float delta_time, int iteration) {
@@ -542,32 +3931,41 @@ PackedByteArray ForceField::get_incompressibility_push_constants(float delta_tim
     return std::move(bytes);
 }
 
-void ForceField::read_velocity_buffer(const PackedByteArray &buffer) {
-    const auto& vel = buffer.to_float32_array();
-    double min_v = vel.get(0);
-    double max_v = vel.get(0);
+PackedByteArray ForceField::get_smooth_push_constants(int iteration) {
+    const PackedInt32Array values{ iteration % 2, 0, 0, 0 };
+    return values.to_byte_array();
+}
+
+void ForceField::read_velocity_samples(const PackedByteArray &buffer, const PackedVector3Array &points, const Basis &basis) {
+    const PackedFloat32Array values = buffer.to_float32_array();
+    const int64_t count = std::min(points.size(), values.size() / 4);
 
-    for (int i=0; i < vel.size(); ++i) {
-        double value = vel.get(i);
+    PackedVector3Array velocities;
+    velocities.resize(count);
 
-        if (value > max_v) {
-            max_v = value;
-        }
+    for (int64_t i = 0; i < count; ++i) {
+        velocities.set(i, basis.xform(Vector3(values[4 * i], values[4 * i + 1], values[4 * i + 2])));
+    }
 
-        if (value < min_v) {
-            min_v = value;
-        }
+    {
+        std::lock_guard lock(m_velocity_query_mutex);
+        m_sampled_velocities = velocities;
+        m_sampled_points = points.slice(0, count);
     }
 
-    UtilityFunctions::print("Min: ", min_v, " Max: ", max_v, " Count: ", vel.size());
+    // Readbacks complete on the render thread, listeners get the signal on the main thread.
+    call_deferred("emit_signal", "velocities_sampled", points, velocities);
 }
 
-PackedByteArray ForceField::create_emitter_bytes(Vector3 min, Vector3 max, Vector3 velocity) {
-    const PackedFloat32Array buffer{
-        min.x, min.y, min.z, 0.0,
-        max.x, max.y, max.z, 0.0,
-        velocity.x, velocity.y, velocity.z, 0.0,
-    };
+void ForceField::read_field_stats(const PackedByteArray &buffer, float delta_time, bool print) {
+    const FieldStats record = FieldStats::from_bytes(buffer);
+    const Dictionary stats = record.to_dictionary(delta_time, m_cell_size);
+
+    if (print) {
+        UtilityFunctions::print("ForceField stats: ", stats);
+    }
 
-    return PackedByteArray { buffer.to_byte_array() };
+    std::lock_guard lock(m_field_stats_mutex);
+    m_field_stats = stats;
+    m_max_face_speed = record.get_max_face_speed();
 }
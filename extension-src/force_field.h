@@ -4,13 +4,62 @@
 #include <godot_cpp/classes/rendering_device.hpp>
 
 #include "godot_cpp/classes/texture3drd.hpp"
+#include "godot_cpp/classes/image_texture3d.hpp"
 #include "godot_cpp/classes/input_event.hpp"
+#include "godot_cpp/classes/mesh.hpp"
+#include "godot_cpp/classes/rd_uniform.hpp"
+#include "godot_cpp/variant/typed_array.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "compute_list_recorder.h"
+#include "cpu_solver.h"
+#include "emitter_list.h"
+#include "field_index.h"
+#include "field_state.h"
+#include "field_stats.h"
+#include "force_field_emitter.h"
+#include "obstacle_list.h"
+#include "pass_profiler.h"
+#include "shader_cache.h"
+#include "simulation_thread.h"
 
 namespace godot {
 
 class ForceField : public Node3D {
     GDCLASS(ForceField, Node3D)
 
+public:
+    enum Backend {
+        BACKEND_GPU,
+        BACKEND_CPU,
+    };
+
+    enum SimulationDevice {
+        SIMULATION_DEVICE_MAIN,
+        SIMULATION_DEVICE_LOCAL,
+    };
+
+    enum Precision {
+        PRECISION_FP32,
+        PRECISION_FP16,
+    };
+
+    enum FieldLayout {
+        FIELD_LAYOUT_LINEAR,
+        FIELD_LAYOUT_BRICK4,
+        FIELD_LAYOUT_BRICK8,
+    };
+
+    enum PressureSolver {
+        PRESSURE_SOLVER_RED_BLACK,
+        PRESSURE_SOLVER_MULTIGRID,
+    };
+
+private:
     RenderingDevice* m_device;
 
     struct VelocityBuffers {
@@ -22,9 +71,12 @@ class ForceField : public Node3D {
     VelocityBuffers m_velocity_buffers1;
     VelocityBuffers m_velocity_buffers2;
     RID m_solid_buffer;
+    RID m_solid_mask_buffer;
     RID m_grid_params_buffer;
     RID m_emitter_buffer;
     RID m_pressure_buffer;
+    RID m_brick_flags_buffer;
+    RID m_active_bricks_buffer;
 
     struct IntegratePass {
         RID pipeline;
@@ -34,6 +86,7 @@ class ForceField : public Node3D {
         RID grid_parameters_set;
         RID emitter_set;
         RID pressure_set;
+        RID active_bricks_set;
         RID shader;
     };
 
@@ -44,6 +97,9 @@ class ForceField : public Node3D {
         RID solid_set;
         RID pressure_set;
         RID grid_parameters_set;
+        RID active_bricks_set;
+        // The tiled variant runs one workgroup per brick instead of one per eight.
+        bool tiled { false };
     };
 
     struct ExtrapolationPass {
@@ -59,7 +115,11 @@ class ForceField : public Node3D {
         RID velocity_out_set;
         RID solid_set;
         RID grid_parameters_set;
+        RID active_bricks_set;
         RID shader;
+        // Only the fused variant writes the output texture.
+        RID pressure_set;
+        RID texture_set;
     };
 
     struct TransferToTexturePass {
@@ -72,60 +132,609 @@ class ForceField : public Node3D {
         RID grid_parameters_set;
     };
 
+    struct ObstaclePass {
+        RID pipeline;
+        RID shader;
+        RID static_solid_set;
+        RID solid_set;
+        RID velocity_set;
+        RID grid_parameters_set;
+        RID obstacles_set;
+        RID triangles_set;
+    };
+
+    // What the main thread remembers of an obstacle from the previous frame.
+    struct ObstacleState {
+        uint64_t node_id { 0 };
+        Ref<Mesh> mesh;
+        PackedVector3Array faces;
+        Transform3D transform;
+        Vector3i cell_min;
+        Vector3i cell_max;
+        bool moving { false };
+    };
+
+    // Resets the cells a scrolling field has moved over in both velocity buffers, the pressure and the solids.
+    struct ClearPass {
+        RID pipeline;
+        RID shader;
+        RID velocity_set;
+        RID velocity2_set;
+        RID pressure_set;
+        RID solid_set;
+        RID static_solid_set;
+        RID grid_parameters_set;
+    };
+
+    struct SolidMaskPass {
+        RID pipeline;
+        RID shader;
+        RID solid_set;
+        RID solid_mask_set;
+        RID grid_parameters_set;
+    };
+
+    struct ActiveBrickPass {
+        RID mark_pipeline;
+        RID mark_shader;
+        RID compact_pipeline;
+        RID compact_shader;
+        RID mark_velocity_set;
+        RID mark_grid_parameters_set;
+        RID mark_emitter_set;
+        RID mark_flags_set;
+        RID mark_list_set;
+        RID compact_flags_set;
+        RID compact_list_set;
+        RID compact_grid_parameters_set;
+    };
+
+    struct ReducePass {
+        RID pipeline;
+        RID shader;
+    };
+
+    struct ResidualPass {
+        RID pipeline;
+        RID shader;
+        RID velocity_set;
+        RID solid_set;
+        RID grid_parameters_set;
+        RID partials_set;
+        RID reduce_partials_set;
+        RID reduce_results_set;
+    };
+
+    // One grid of the multigrid hierarchy below the simulation grid, each with half the cells per axis of the
+    // one above. Every pass that touches a level gets its own set of the four level buffers.
+    struct MultigridLevel {
+        Vector3i size;
+        RID phi;
+        RID rhs;
+        RID solid;
+        RID grid_parameters;
+        RID smooth_set;
+        RID restrict_fine_set;
+        RID restrict_coarse_set;
+        RID prolong_fine_set;
+        RID prolong_coarse_set;
+        RID correct_set;
+    };
+
+    struct MultigridPass {
+        RID restrict_velocity_pipeline;
+        RID restrict_velocity_shader;
+        RID restrict_pipeline;
+        RID restrict_shader;
+        RID smooth_pipeline;
+        RID smooth_shader;
+        RID prolong_pipeline;
+        RID prolong_shader;
+        RID correct_pipeline;
+        RID correct_shader;
+        RID restrict_velocity_set;
+        RID restrict_solid_set;
+        RID restrict_grid_parameters_set;
+        RID correct_velocity_set;
+        RID correct_solid_set;
+        RID correct_pressure_set;
+        RID correct_grid_parameters_set;
+    };
+
+    // Samples the velocity of the previous grid into the new one after a resize.
+    struct ResamplePass {
+        RID pipeline;
+        RID shader;
+        RID velocity_set;
+        RID grid_parameters_set;
+    };
+
+    // A box of cells the resample kernel writes, see shaders/resample_velocity.glsl.
+    struct ResampleRegion {
+        Vector3 source_origin;
+        float footprint { 0.0 };
+        Vector3i origin;
+        Vector3i size;
+        bool border_only { false };
+    };
+
+    // Couples the field to the one it is nested in, see parent_field, with the resample kernel in both directions:
+    // the parent's velocity is sampled into the border of this grid after integration, and this grid's velocity is
+    // averaged into the parent's faces it covers after advection. The sets of the parent's buffers are rebuilt
+    // whenever the parent's buffers change.
+    struct NestPass {
+        RID border_set;
+        RID source_set;
+        RID source_grid_parameters_set;
+        RID parent_source_set;
+        RID parent_source_grid_parameters_set;
+        RID parent_target_set;
+        RID parent_target_grid_parameters_set;
+        VelocityBuffers parent_velocity;
+        RID parent_grid_parameters;
+    };
+
+    struct FieldStatsPass {
+        RID pipeline;
+        RID shader;
+        RID velocity_set;
+        RID pressure_set;
+        RID solid_set;
+        RID grid_parameters_set;
+        RID partials_set;
+        RID reduce_partials_set;
+        RID reduce_results_set;
+    };
+
+    // Query points and results of sample_velocities(). Two slots alternate, so a step can upload new points while
+    // the results of the previous one are still being read back.
+    struct VelocityQuerySlot {
+        RID points_buffer;
+        RID results_buffer;
+        RID points_set;
+        RID results_set;
+        int capacity { 0 };
+    };
+
+    struct VelocityQueryPass {
+        RID pipeline;
+        RID shader;
+        RID velocity_set;
+        RID grid_parameters_set;
+        VelocityQuerySlot slots[2];
+    };
+
     IntegratePass m_integrate_pass;
     IncompressibilityPass m_incompressibility_pass;
     ExtrapolationPass m_extrapolation_pass;
     AdvectionPass m_advection_pass;
+    AdvectionPass m_fused_advection_pass;
     TransferToTexturePass m_transfer_to_texture_pass;
+    SolidMaskPass m_solid_mask_pass;
+    ObstaclePass m_obstacle_pass;
+    ClearPass m_clear_pass;
+    ActiveBrickPass m_active_brick_pass;
+    ReducePass m_reduce_pass;
+    ResidualPass m_residual_pass;
+    MultigridPass m_multigrid_pass;
+    VelocityQueryPass m_velocity_query_pass;
+    FieldStatsPass m_field_stats_pass;
+    ResamplePass m_resample_pass;
+    NestPass m_nest_pass;
+    std::vector<MultigridLevel> m_multigrid_levels;
+    // Set once the multigrid solver was first selected, the levels stay empty on fields too small for them.
+    bool m_multigrid_created { false };
+
+    // Every buffer comes from the pool and goes back to it when the field is resized. Shaders and pipelines are
+    // shared with other fields through the ShaderCache, the uniform sets are this field's own.
+    mutable BufferPool m_buffer_pool;
+    std::vector<ShaderCache::Program> m_programs;
+    mutable std::vector<RID> m_uniform_sets;
+
+    // Specialization constants of the field's own kernels, taken from the properties when the compute setup is
+    // created.
+    ShaderCache::Specialization m_specialization;
+
+    // Levels stop before any axis drops below this many cells, the border cells of a level stay fixed.
+    static constexpr int MULTIGRID_MIN_LEVEL_SIZE = 4;
+    static constexpr int MULTIGRID_COARSEST_ITERATIONS = 16;
+
+    enum ReduceOp : uint32_t {
+        REDUCE_MAX = 0,
+        REDUCE_SUM = 1,
+        REDUCE_MIN = 2,
+    };
+
+    // One vec4 per reduction record.
+    static constexpr int RESIDUAL_CHECK_SIZE = 16;
+    static constexpr int MAX_RESIDUAL_CHECKS = 64;
+
+    RID m_residual_partials_buffer;
+    RID m_residual_buffer;
+    RID m_stats_partials_buffer;
+    RID m_stats_buffer;
+
+    // Set by get_field_stats(), the next step then reduces the fields and reads the record back.
+    std::atomic<bool> m_field_stats_requested { false };
+    mutable std::mutex m_field_stats_mutex;
+    Dictionary m_field_stats;
+    // Largest face velocity of the last stats record, steers the adaptive time step.
+    float m_max_face_speed { 0.0 };
+
+    // Emitters are rebuilt on the main thread when one changes and handed to the render thread as one image of the
+    // buffer, which uploads the bytes that differ from the last upload in a single range. The image waits for the
+    // grid it was built on, a resize still queued on the render thread doesn't get it early.
+    std::atomic<bool> m_emitters_dirty { true };
+    std::mutex m_emitter_mutex;
+    PackedByteArray m_pending_emitter_bytes;
+    Vector3i m_pending_emitter_field_size;
+    float m_pending_emitter_cell_size { 0.0 };
+    PackedByteArray m_uploaded_emitter_bytes;
+    int64_t m_emitter_buffer_capacity { 0 };
+
+    static constexpr int64_t EMITTER_MIN_CAPACITY = 4096;
+
+    // Obstacles are gathered on the main thread each frame. Only the regions an obstacle entered, left or moved in
+    // are voxelized again, the regions of several frames pile up until the render thread takes them. Like the
+    // emitters they wait for the grid they were gathered on. A resize drops them and has the main thread write
+    // every obstacle again.
+    RID m_static_solid_buffer;
+    RID m_obstacle_buffer;
+    RID m_obstacle_triangle_buffer;
+    int64_t m_obstacle_buffer_capacity { 0 };
+    int64_t m_obstacle_triangle_capacity { 0 };
+    std::vector<ObstacleState> m_obstacle_states;
+    std::atomic<bool> m_obstacles_reset { false };
+    std::mutex m_obstacle_mutex;
+    PackedByteArray m_pending_obstacle_bytes;
+    PackedByteArray m_pending_triangle_bytes;
+    bool m_pending_triangles { false };
+    std::vector<ObstacleList::Region> m_pending_obstacle_regions;
+    Vector3i m_pending_obstacle_field_size;
+    float m_pending_obstacle_cell_size { 0.0 };
+    float m_pending_obstacle_inv_delta { 0.0 };
+
+    static constexpr int64_t OBSTACLE_MIN_CAPACITY = 4096;
+
+    // Scrolling, see scroll_target. The main thread moves the node by whole cells and leaves the cells it moved by
+    // next to the obstacle regions, which are in the window of the latest move, so both are taken together. The
+    // render thread keeps the wrap offset in the grid parameters.
+    Vector3i m_pending_scroll;
+    Vector3i m_wrap_offset;
+
+    // Nesting, see parent_field. The main thread resolves the parent each frame and hands its id and where this
+    // grid starts in its space to the render thread, in order with the steps. The parent keeps the ids of the
+    // fields nested in it to answer velocity queries from the finest one.
+    uint64_t m_linked_parent_id { 0 };
+    std::vector<uint64_t> m_nested_field_ids;
+    uint64_t m_nest_parent_id { 0 };
+    Vector3 m_nest_origin;
+    // Beyond this many regions per step they are merged into their bounding box.
+    static constexpr size_t MAX_OBSTACLE_REGIONS = 16;
+
+    // Layout of the active brick buffer, see active_bricks.glslinc: two sets of indirect dispatch arguments,
+    // the brick count and a padding word, then the brick indices.
+    static constexpr int ACTIVE_BRICK_SIZE = 8;
+    static constexpr uint32_t ACTIVE_BRICK_GROUPS_OFFSET = 0;
+    static constexpr uint32_t ACTIVE_BLOCK_GROUPS_OFFSET = 12;
+    static constexpr uint32_t ACTIVE_BRICK_COUNT_OFFSET = 24;
+    static constexpr int ACTIVE_BRICK_HEADER_SIZE = 32;
+
+    // State of the adaptive pressure solve. Readbacks update it on the render thread, the getters read the last
+    // results on the main thread, both under m_residual_mutex.
+    mutable std::mutex m_residual_mutex;
+    int m_pressure_iterations { 100 };
+    int m_multigrid_planned_cycles { 2 };
+    // Whether the active brick buffer holds a sparse list, otherwise it lists every brick.
+    bool m_active_bricks_sparse { false };
 
     RID m_rd_texture;
 
-    bool m_compute_ready { false };
+    // With SIMULATION_DEVICE_LOCAL the solver runs on its own device, driven by the simulation thread, and the
+    // output texture lives there. Each finished frame is read back and uploaded into whichever of the two display
+    // textures the scene isn't sampling, which is then swapped into the Texture3DRD.
+    RenderingDevice* m_local_device { nullptr };
+    SimulationThread m_simulation_thread;
+    RID m_display_textures[2];
+    int m_display_front { 0 };
+    Vector3i m_display_size;
+
+    // Written by the simulation thread, taken by the next frame on the main thread.
+    std::mutex m_local_output_mutex;
+    PackedByteArray m_local_output;
+    Vector3i m_local_output_size;
+    bool m_has_local_output { false };
+
+    // Handed between the main thread and the thread that drives the device by save_state() and load_state().
+    std::mutex m_state_mutex;
+    FieldState m_saved_state;
+    FieldState m_pending_state;
+    bool m_has_pending_state { false };
+
+    CpuSolver m_cpu_solver;
+
+    enum BenchmarkPath {
+        BENCHMARK_PATH_SPLIT_LISTS,
+        BENCHMARK_PATH_SINGLE_LIST,
+        BENCHMARK_PATH_MAX,
+    };
+
+    static constexpr int BENCHMARK_REPORT_INTERVAL = 120;
+
+    struct BenchmarkStats {
+        uint64_t cpu_usec { 0 };
+        uint64_t gpu_usec { 0 };
+        int cpu_samples { 0 };
+        int gpu_samples { 0 };
+    };
+
+    BenchmarkStats m_benchmark_stats[BENCHMARK_PATH_MAX];
+    uint64_t m_benchmark_frame { 0 };
+
+    static constexpr int VELOCITY_QUERY_MIN_CAPACITY = 256;
+
+    // Written by sample_velocities() on the main thread, taken by the next step on the render thread.
+    std::mutex m_velocity_query_mutex;
+    PackedVector3Array m_pending_query_points;
+    Transform3D m_pending_query_transform;
+    bool m_has_pending_query { false };
+    PackedVector3Array m_sampled_velocities;
+    PackedVector3Array m_sampled_points;
+    int m_velocity_query_slot { 0 };
+
+    PassProfiler m_pass_profiler;
+    // Category the performance monitors of this field were added under, empty while none are.
+    String m_monitor_category;
+
+    // Set whenever the solid buffer changes, the mask is rebuilt at the start of the next step.
+    bool m_solid_mask_dirty { true };
+
+    std::atomic<bool> m_compute_ready { false };
     bool m_print_debug_info { false };
+    bool m_benchmark_mode { false };
+    bool m_pass_profiling { false };
 
-    void init_integrate_pass(const VelocityBuffers& velocity_in, const VelocityBuffers& velocity_out, const RID& solids, const RID& pressure, const RID& grid_parameters, const RID& emitter_buffer);
-    void init_incompressibility_pass(const VelocityBuffers& velocity, const RID& solid, const RID& pressure, const RID& grid_parameters);
+    void init_integrate_pass(const VelocityBuffers& velocity_in, const VelocityBuffers& velocity_out, const RID& solids, const RID& pressure, const RID& grid_parameters, const RID& emitter_buffer, const RID& active_bricks);
+    void init_incompressibility_pass(const VelocityBuffers& velocity, const RID& solid, const RID& pressure, const RID& grid_parameters, const RID& active_bricks);
     void init_extrapolation_pass(const VelocityBuffers& velocity, const RID& grid_parameters);
-    void init_advect_pass(const VelocityBuffers& velocity_in, const VelocityBuffers& velocity_out, const RID& solid, const RID& grid_parameters);
+    void init_advect_pass(const VelocityBuffers& velocity_in, const VelocityBuffers& velocity_out, const RID& solid, const RID& grid_parameters, const RID& active_bricks, const RID& pressure, const RID& texture);
     void init_copy_to_texture_pass(const VelocityBuffers& velocity, const RID& texture, const RID& pressure, const RID& solid, const RID& grid_parameters);
+    void init_solid_mask_pass(const RID& solid, const RID& solid_mask, const RID& grid_parameters);
+    void init_clear_pass(const VelocityBuffers& velocity, const VelocityBuffers& velocity2, const RID& pressure, const RID& solid, const RID& static_solid, const RID& grid_parameters);
+    void init_active_brick_pass(const VelocityBuffers& velocity, const RID& grid_parameters, const RID& emitter_buffer, const RID& flags, const RID& active_bricks);
+    void init_reduce_pass();
+    void init_residual_pass(const VelocityBuffers& velocity, const RID& solid, const RID& grid_parameters, const RID& partials, const RID& results);
+    // The passes of optional features are left out of init_compute(). The first step that uses one creates it with
+    // its buffers, so a field without obstacles, queries, stats, nesting or multigrid doesn't hold them.
+    void init_obstacle_pass(const RID& static_solid, const RID& solid, const VelocityBuffers& velocity, const RID& grid_parameters);
+    void init_multigrid_levels();
+    void init_multigrid_pass(const VelocityBuffers& velocity, const RID& solid, const RID& pressure, const RID& grid_parameters);
+    void init_velocity_query_pass(const VelocityBuffers& velocity, const RID& grid_parameters);
+    void init_field_stats_pass(const VelocityBuffers& velocity, const RID& pressure, const RID& solid, const RID& grid_parameters);
+    void reserve_velocity_query_slot(int slot, int points);
+    void init_nest_pass();
+    // Creates the passes the coming step needs, the step itself only creates ones requested in between.
+    void init_optional_passes();
+
+    void init_resample_pass();
+    [[nodiscard]] ShaderCache::Program create_program(const String& file, const String& version = String(),
+                                                      const ShaderCache::Specialization& specialization = ShaderCache::Specialization());
+    [[nodiscard]] RID create_uniform_set(const TypedArray<RDUniform>& uniforms, const RID& shader, int set) const;
+    // Takes a set out of the ones freed with the field, its owner frees it.
+    RID detach_uniform_set(const RID& uniform_set);
+    void free_uniform_set(const RID& uniform_set);
 
     void init_compute();
+    void init_cpu();
+    void release_buffer(RID& buffer);
+    // Frees the uniform sets and the texture and returns the buffers to the pool. The programs are handed back for
+    // release_programs().
+    [[nodiscard]] std::vector<ShaderCache::Program> release_compute();
+    void release_programs(const std::vector<ShaderCache::Program>& programs);
+    void resize_compute(Vector3i field_size, float cell_size);
+    void record_resample(ComputeListRecorder& recorder, const RID& source_velocity_set, const RID& source_grid_parameters_set,
+                         const RID& velocity_set, const RID& grid_parameters_set, const ResampleRegion& region) const;
+    static void free_compute_resources(const Array& rids, const Array& shaders, const Array& pipelines);
+    static void free_device_resources(RenderingDevice* device, const Array& rids, const Array& shaders, const Array& pipelines);
+
+    [[nodiscard]] bool uses_local_device() const;
+    // The render thread, or the simulation thread when the field runs on a local device.
+    void call_on_simulation_thread(const Callable& callable);
+    void finish_local_frame();
+    void present_local_output();
+    void init_display_textures(Vector3i size);
+    // Blocks until the render thread, or the simulation thread of a local device, has run everything queued.
+    void wait_for_simulation_thread();
+
+    void read_state();
+    void apply_pending_state();
+    void update_display_texture(const PackedByteArray& bytes, Vector3i size);
+
+    void run_compute(float delta_time, bool output);
+    void run_cpu(float delta_time);
+    [[nodiscard]] float get_step_size();
+
+    void record_solid_mask(ComputeListRecorder& recorder, Vector3i origin, Vector3i size) const;
+    void record_obstacles(ComputeListRecorder& recorder, const std::vector<ObstacleList::Region>& regions, float inv_delta_time) const;
+    void record_clear(ComputeListRecorder& recorder, const std::vector<ObstacleList::Region>& regions) const;
+    void record_active_bricks(ComputeListRecorder& recorder) const;
+    void record_velocity_query(ComputeListRecorder& recorder, int slot, int points) const;
+    void record_field_stats(ComputeListRecorder& recorder) const;
+    // The pressure solve a step records, and its residual readback is tagged with.
+    struct PressurePlan {
+        bool multigrid { false };
+        // V-cycles with multigrid, red-black half sweeps otherwise.
+        int iterations { 0 };
+        int check_interval { 1 };
+    };
 
-    void run_compute();
+    int record_step(ComputeListRecorder& recorder, float delta_time, const PressurePlan& plan, bool output, bool fused,
+                    bool nested) const;
+    void record_nest_border(ComputeListRecorder& recorder) const;
+    void record_nest_restriction(ComputeListRecorder& recorder, const ForceField& parent) const;
+    int record_pressure_solve(ComputeListRecorder& recorder, float delta_time, const PressurePlan& plan) const;
+    void record_residual(ComputeListRecorder& recorder, int slot) const;
+    void record_red_black_iteration(ComputeListRecorder& recorder, float delta_time, int iteration) const;
+    void record_multigrid_cycle(ComputeListRecorder& recorder, float delta_time) const;
+    void record_multigrid_smoothing(ComputeListRecorder& recorder, const MultigridLevel& level, int iterations) const;
+
+    [[nodiscard]] bool uses_multigrid() const;
+    // Local size of the tiled kernels for workgroup_size on this device.
+    [[nodiscard]] Vector3i get_supported_workgroup_size() const;
+    // Whether the buffers and the texture of a field of the given size fit on this device.
+    [[nodiscard]] bool fits_device(Vector3i field_size) const;
+    // Storage precision of the field buffers for precision on this device.
+    [[nodiscard]] Precision get_supported_precision() const;
+    // Workgroups of the tiled kernels covering a grid of the given size.
+    [[nodiscard]] Vector3i get_tile_groups(Vector3i size) const;
+    [[nodiscard]] int get_planned_iterations() const;
+    [[nodiscard]] int get_planned_cycles() const;
+    void read_residuals(const PackedByteArray& buffer, int iterations, int check_interval, bool multigrid);
+    void read_active_brick_count(const PackedByteArray& buffer);
+    void read_velocity_samples(const PackedByteArray& buffer, const PackedVector3Array& points, const Basis& basis);
+
+    [[nodiscard]] String get_benchmark_timestamp_name(int path, bool end) const;
+    void read_benchmark_timestamps();
+
+    void mark_pass(ComputeListRecorder& recorder, PassProfiler::Pass pass) const;
+    void add_pass_monitors();
+    void remove_pass_monitors();
+    [[nodiscard]] double get_pass_monitor_value(int pass) const;
+
+    void update_cpu_texture();
+
+    [[nodiscard]] String get_field_shader_version() const;
+    [[nodiscard]] String get_advection_shader_version() const;
+    [[nodiscard]] String get_layout_shader_version() const;
+    [[nodiscard]] FieldIndex get_field_index() const;
+    [[nodiscard]] int64_t get_field_buffer_size() const;
 
     [[nodiscard]] RID create_velocity_storage_buffer() const;
-    [[nodiscard]] RID create_grid_params_buffer() const;
-    [[nodiscard]] RID create_solid_storage_buffer(bool walls) const;
-    [[nodiscard]] RID create_texture() const;
-    [[nodiscard]] RID create_emitter_buffer() const;
-    void update_emitter_buffer() const;
-    [[nodiscard]] static PackedByteArray create_emitter_bytes(Vector3 min, Vector3 max, Vector3 velocity);
+    [[nodiscard]] RID create_grid_params_buffer(const Vector3i& size, float cell_size, const Vector3i& wrap = Vector3i()) const;
+    void update_wrap_offset(const Vector3i& wrap);
+    // A shell makes the border cells solid, the faces between them and the interior then hold the velocities a
+    // nested field gets from its parent.
+    [[nodiscard]] PackedFloat32Array create_solid_data(Vector3i field_size, bool walls, bool shell = false) const;
+    [[nodiscard]] RID create_solid_storage_buffer(bool walls, bool shell = false) const;
+    [[nodiscard]] RID create_solid_mask_buffer() const;
+    [[nodiscard]] int get_brick_count() const;
+    [[nodiscard]] PackedByteArray create_full_brick_list() const;
+    [[nodiscard]] RID create_active_bricks_buffer() const;
+    [[nodiscard]] RID create_brick_flags_buffer() const;
+    [[nodiscard]] RID create_texture(RenderingDevice* device, Vector3i size) const;
+    [[nodiscard]] EmitterList build_emitter_list() const;
+    void mark_emitters_dirty();
+    void update_emitters();
+    void upload_emitters();
+    void reserve_emitter_buffer(int64_t size);
+    [[nodiscard]] static bool describe_obstacle(Node* node, ObstacleList::Obstacle& obstacle, AABB& bounds, Ref<Mesh>& mesh);
+    void update_obstacles(double delta, const std::vector<ObstacleList::Region>& exposed);
+    void upload_obstacles(std::vector<ObstacleList::Region>& regions, float& inv_delta_time, Vector3i& scroll);
+
+    [[nodiscard]] bool uses_scrolling() const;
+    [[nodiscard]] bool uses_nesting() const;
+    void update_nest_link();
+    void unlink_parent();
+    void set_nest_link(uint64_t parent_id, Vector3 origin);
+    // The parent of a nested field on the render thread, with its sets up to date, or null while there is none.
+    [[nodiscard]] ForceField* get_nest_parent();
+    void update_nest_sets(const ForceField& parent);
+    // The sets on the parent's buffers go away with those buffers, so they aren't kept with the field's other sets.
+    [[nodiscard]] Array take_nest_parent_sets();
+    static void free_nest_parent_sets(const Array& uniform_sets);
+    // Queues a velocity query and returns the last answer, with nested fields merged in, and the points it is for.
+    [[nodiscard]] PackedVector3Array query_velocities(const PackedVector3Array& points, PackedVector3Array& sampled_points);
+    // Whether a point in the field's local space lies inside the cells it solves, inside its border.
+    [[nodiscard]] bool contains_interior_point(const Vector3& point) const;
+    // Moves the field after the scroll target and returns the cells of the window that are new.
+    [[nodiscard]] std::vector<ObstacleList::Region> update_scroll();
+    // The cells a window of the given size moves over when it scrolls by the given number of cells.
+    [[nodiscard]] static std::vector<ObstacleList::Region> get_exposed_regions(Vector3i scroll, Vector3i size);
+    void reserve_obstacle_buffers(int64_t size, int64_t triangles_size);
+    [[nodiscard]] RID create_zeroed_storage_buffer(int64_t size) const;
     [[nodiscard]] RID create_pressure_buffer() const;
+    [[nodiscard]] RID create_level_buffer(const Vector3i& size) const;
+    [[nodiscard]] static PackedFloat32Array restrict_solid_data(const PackedFloat32Array& solid, const Vector3i& size, const Vector3i& coarse_size);
+    [[nodiscard]] RID create_reduction_buffer(int records) const;
+    [[nodiscard]] RID create_query_buffer(int points) const;
 
     [[nodiscard]] RID create_velocity_set(const VelocityBuffers &storage_buffers, const RID &shader, int set) const;
     [[nodiscard]] RID create_grid_parameters_set(const RID& parameter_buffer, const RID& shader, int set) const;
     [[nodiscard]] RID create_solid_set(const RID& solid_buffer, const RID& shader, int set) const;
     [[nodiscard]] RID create_emitter_set(const RID& emitter_buffer, const RID& shader, int set) const;
     [[nodiscard]] RID create_pressure_set(const RID& pressure_buffer, const RID& shader, int set) const;
+    [[nodiscard]] RID create_storage_set(const RID& buffer, const RID& shader, int set) const;
+    [[nodiscard]] RID create_image_set(const RID& texture, const RID& shader, int set) const;
+    [[nodiscard]] RID create_level_set(const MultigridLevel& level, const RID& shader, int set) const;
 
-    int to_index(int i, int j, int k) const;
     [[nodiscard]] static PackedByteArray get_incompressibility_push_constants(float delta_time, int iteration);
+    [[nodiscard]] static PackedByteArray get_smooth_push_constants(int iteration);
+    [[nodiscard]] static PackedByteArray get_reduce_push_constants(uint32_t ops, int stride, int count, int result_offset);
 
-    void read_velocity_buffer(const PackedByteArray& buffer);
+    void read_field_stats(const PackedByteArray& buffer, float delta_time, bool print);
 
 protected:
     static void _bind_methods();
+    void _notification(int what);
 
+    // The size the simulation runs at. Resizes of a running GPU field take effect on the render thread, which
+    // owns these two from then on. The main thread works with the requested size, which is the grid every step it
+    // queues from now on runs on.
     Vector3i m_field_size;
     float m_cell_size;
+    Vector3i m_requested_field_size;
+    float m_requested_cell_size;
     Ref<Texture3DRD> m_texture;
     Vector3 m_emitter_min { 0.44, 0.44, 0.1 };
     Vector3 m_emitter_max { 0.54, 0.54, 0.1 };
     Vector3 m_emitter_velocity { 0.0, 0.0, 15.82 };
+    TypedArray<ForceFieldEmitter> m_emitters;
+    TypedArray<NodePath> m_obstacles;
+    NodePath m_scroll_target;
+    NodePath m_parent_field;
+    Backend m_backend { BACKEND_GPU };
+    SimulationDevice m_simulation_device { SIMULATION_DEVICE_MAIN };
+    int m_cpu_thread_count { 0 };
+    Ref<ImageTexture3D> m_cpu_texture;
+    int m_max_iterations { 100 };
+    float m_tolerance { 0.001 };
+    int m_residual_check_interval { 10 };
+    float m_last_residual { 0.0 };
+    float m_last_residual_l2 { 0.0 };
+    int m_last_iteration_count { 0 };
+    Precision m_precision { PRECISION_FP32 };
+    // The precision the buffers actually use, taken from m_precision when the field is started or resized.
+    std::atomic<Precision> m_storage_precision { PRECISION_FP32 };
+    FieldLayout m_field_layout { FIELD_LAYOUT_LINEAR };
+    float m_over_relaxation { 1.7 };
+    float m_density { 1000.0 };
+    Vector3i m_workgroup_size { 8, 8, 8 };
+    bool m_advection_shared_tiles { false };
+    bool m_pressure_shared_tiles { false };
+    bool m_fused_kernels { false };
+    PressureSolver m_pressure_solver { PRESSURE_SOLVER_RED_BLACK };
+    int m_multigrid_level_count { 4 };
+    int m_multigrid_cycles { 2 };
+    int m_multigrid_smoothing_iterations { 4 };
+    bool m_sparse_bricks { false };
+    float m_activity_threshold { 0.0001 };
+    std::atomic<int> m_active_brick_count { 0 };
+    float m_time_step { 0.016 };
+    int m_max_substeps { 4 };
+    bool m_adaptive_time_step { false };
+    float m_cfl_target { 1.0 };
+    double m_time_accumulator { 0.0 };
+    float m_last_time_step { 0.016 };
+    int m_last_substep_count { 0 };
+
+    // Adaptive steps never drop below this, at worst the simulation runs slower than real time.
+    static constexpr float MIN_TIME_STEP = 0.0001;
 
 public:
     ForceField();
 
+    void _enter_tree() override;
+    void _exit_tree() override;
     void _ready() override;
     void _process(double delta) override;
     void _input(const Ref<InputEvent>& event) override;
@@ -136,6 +745,16 @@ public:
     float get_cell_size() const;
     void set_cell_size(float size);
 
+    void resize(Vector3i field_size, float cell_size);
+
+    // Snapshot of the velocity, pressure and solid buffers, see FieldState. Saving waits for the steps already
+    // queued. A loaded state replaces the field's buffers before its next step and resizes the field to the grid
+    // it was saved on, the precision and layout have to match.
+    Error save_state(const String& path, bool compressed);
+    Error load_state(const String& path);
+
+    static Dictionary get_shader_cache_stats();
+
     Ref<Texture3DRD> get_texture() const;
     void set_texture(const Ref<Texture3DRD>& texture);
 
@@ -147,6 +766,128 @@ public:
 
     Vector3 get_emitter_velocity() const;
     void set_emitter_velocity(Vector3 pos);
+
+    TypedArray<ForceFieldEmitter> get_emitters() const;
+    void set_emitters(const TypedArray<ForceFieldEmitter>& emitters);
+
+    TypedArray<NodePath> get_obstacles() const;
+    void set_obstacles(const TypedArray<NodePath>& obstacles);
+
+    NodePath get_scroll_target() const;
+    void set_scroll_target(const NodePath& target);
+
+    NodePath get_parent_field() const;
+    void set_parent_field(const NodePath& field);
+
+    Backend get_backend() const;
+    void set_backend(Backend backend);
+
+    SimulationDevice get_simulation_device() const;
+    void set_simulation_device(SimulationDevice device);
+
+    int get_cpu_thread_count() const;
+    void set_cpu_thread_count(int count);
+
+    Ref<ImageTexture3D> get_cpu_texture() const;
+    void set_cpu_texture(const Ref<ImageTexture3D>& texture);
+
+    PackedFloat32Array get_field_data() const;
+
+    bool get_benchmark_mode() const;
+    void set_benchmark_mode(bool enabled);
+
+    Dictionary get_benchmark_results() const;
+
+    bool get_pass_profiling() const;
+    void set_pass_profiling(bool enabled);
+
+    Dictionary get_pass_timings() const;
+
+    Dictionary get_step_traffic(bool fused) const;
+
+    PackedVector3Array sample_velocities(const PackedVector3Array& points);
+
+    Dictionary get_field_stats();
+
+    int get_max_iterations() const;
+    void set_max_iterations(int iterations);
+
+    float get_tolerance() const;
+    void set_tolerance(float tolerance);
+
+    int get_residual_check_interval() const;
+    void set_residual_check_interval(int interval);
+
+    float get_time_step() const;
+    void set_time_step(float time_step);
+
+    int get_max_substeps() const;
+    void set_max_substeps(int substeps);
+
+    bool get_adaptive_time_step() const;
+    void set_adaptive_time_step(bool enabled);
+
+    float get_cfl_target() const;
+    void set_cfl_target(float target);
+
+    float get_last_time_step() const;
+    int get_last_substep_count() const;
+
+    float get_last_residual() const;
+    float get_last_residual_l2() const;
+    int get_last_iteration_count() const;
+
+    Precision get_precision() const;
+    void set_precision(Precision precision);
+
+    Dictionary get_precision_error_report(int steps) const;
+
+    FieldLayout get_field_layout() const;
+    void set_field_layout(FieldLayout layout);
+
+    float get_over_relaxation() const;
+    void set_over_relaxation(float factor);
+
+    float get_density() const;
+    void set_density(float density);
+
+    Vector3i get_workgroup_size() const;
+    void set_workgroup_size(Vector3i size);
+
+    bool get_advection_shared_tiles() const;
+    void set_advection_shared_tiles(bool enabled);
+
+    bool get_pressure_shared_tiles() const;
+    void set_pressure_shared_tiles(bool enabled);
+
+    bool get_fused_kernels() const;
+    void set_fused_kernels(bool enabled);
+
+    PressureSolver get_pressure_solver() const;
+    void set_pressure_solver(PressureSolver solver);
+
+    int get_multigrid_levels() const;
+    void set_multigrid_levels(int levels);
+
+    int get_multigrid_cycles() const;
+    void set_multigrid_cycles(int cycles);
+
+    int get_multigrid_smoothing_iterations() const;
+    void set_multigrid_smoothing_iterations(int iterations);
+
+    bool get_sparse_bricks() const;
+    void set_sparse_bricks(bool enabled);
+
+    float get_activity_threshold() const;
+    void set_activity_threshold(float threshold);
+
+    int get_active_brick_count() const;
 };
 
 }
+
+VARIANT_ENUM_CAST(ForceField::Backend);
+VARIANT_ENUM_CAST(ForceField::SimulationDevice);
+VARIANT_ENUM_CAST(ForceField::Precision);
+VARIANT_ENUM_CAST(ForceField::FieldLayout);
+VARIANT_ENUM_CAST(ForceField::PressureSolver);
@@ -0,0 +1,108 @@
+#include "force_field_emitter.h"
+
+#include <algorithm>
+
+using namespace godot;
+
+void ForceFieldEmitter::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_shape"), &ForceFieldEmitter::get_shape);
+    ClassDB::bind_method(D_METHOD("set_shape", "shape"), &ForceFieldEmitter::set_shape);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "shape", PROPERTY_HINT_ENUM, "Box,Sphere"), "set_shape", "get_shape");
+
+    ClassDB::bind_method(D_METHOD("get_position"), &ForceFieldEmitter::get_position);
+    ClassDB::bind_method(D_METHOD("set_position", "position"), &ForceFieldEmitter::set_position);
+
+    ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "position", PROPERTY_HINT_NONE, "suffix:m"), "set_position", "get_position");
+
+    ClassDB::bind_method(D_METHOD("get_size"), &ForceFieldEmitter::get_size);
+    ClassDB::bind_method(D_METHOD("set_size", "size"), &ForceFieldEmitter::set_size);
+
+    ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "size", PROPERTY_HINT_NONE, "suffix:m"), "set_size", "get_size");
+
+    ClassDB::bind_method(D_METHOD("get_radius"), &ForceFieldEmitter::get_radius);
+    ClassDB::bind_method(D_METHOD("set_radius", "radius"), &ForceFieldEmitter::set_radius);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "radius", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater,suffix:m"), "set_radius", "get_radius");
+
+    ClassDB::bind_method(D_METHOD("get_velocity"), &ForceFieldEmitter::get_velocity);
+    ClassDB::bind_method(D_METHOD("set_velocity", "velocity"), &ForceFieldEmitter::set_velocity);
+
+    ADD_PROPERTY(PropertyInfo(Variant::VECTOR3, "velocity", PROPERTY_HINT_NONE, "suffix:m/s"), "set_velocity", "get_velocity");
+
+    ClassDB::bind_method(D_METHOD("get_falloff"), &ForceFieldEmitter::get_falloff);
+    ClassDB::bind_method(D_METHOD("set_falloff", "falloff"), &ForceFieldEmitter::set_falloff);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "falloff", PROPERTY_HINT_RANGE, "0,10,0.01,or_greater,suffix:m"), "set_falloff", "get_falloff");
+
+    ClassDB::bind_method(D_METHOD("is_enabled"), &ForceFieldEmitter::is_enabled);
+    ClassDB::bind_method(D_METHOD("set_enabled", "enabled"), &ForceFieldEmitter::set_enabled);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "enabled"), "set_enabled", "is_enabled");
+
+    BIND_ENUM_CONSTANT(SHAPE_BOX);
+    BIND_ENUM_CONSTANT(SHAPE_SPHERE);
+}
+
+ForceFieldEmitter::Shape ForceFieldEmitter::get_shape() const {
+    return m_shape;
+}
+
+void ForceFieldEmitter::set_shape(Shape shape) {
+    m_shape = shape;
+    emit_changed();
+}
+
+Vector3 ForceFieldEmitter::get_position() const {
+    return m_position;
+}
+
+void ForceFieldEmitter::set_position(Vector3 position) {
+    m_position = position;
+    emit_changed();
+}
+
+Vector3 ForceFieldEmitter::get_size() const {
+    return m_size;
+}
+
+void ForceFieldEmitter::set_size(Vector3 size) {
+    m_size = size.max(Vector3());
+    emit_changed();
+}
+
+float ForceFieldEmitter::get_radius() const {
+    return m_radius;
+}
+
+void ForceFieldEmitter::set_radius(float radius) {
+    m_radius = std::max(radius, 0.0f);
+    emit_changed();
+}
+
+Vector3 ForceFieldEmitter::get_velocity() const {
+    return m_velocity;
+}
+
+void ForceFieldEmitter::set_velocity(Vector3 velocity) {
+    m_velocity = velocity;
+    emit_changed();
+}
+
+float ForceFieldEmitter::get_falloff() const {
+    return m_falloff;
+}
+
+void ForceFieldEmitter::set_falloff(float falloff) {
+    m_falloff = std::max(falloff, 0.0f);
+    emit_changed();
+}
+
+bool ForceFieldEmitter::is_enabled() const {
+    return m_enabled;
+}
+
+void ForceFieldEmitter::set_enabled(bool enabled) {
+    m_enabled = enabled;
+    emit_changed();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <godot_cpp/classes/resource.hpp>
+#include <godot_cpp/variant/vector3.hpp>
+
+namespace godot {
+
+// A box or sphere that drives the velocity inside it, placed in the local space of the ForceField it belongs to.
+// Every property change emits `changed`, which the field coalesces into one emitter upload per frame.
+class ForceFieldEmitter : public Resource {
+    GDCLASS(ForceFieldEmitter, Resource)
+
+public:
+    enum Shape {
+        SHAPE_BOX,
+        SHAPE_SPHERE,
+    };
+
+private:
+    Shape m_shape { SHAPE_BOX };
+    Vector3 m_position;
+    Vector3 m_size { 1.0, 1.0, 1.0 };
+    float m_radius { 0.5 };
+    Vector3 m_velocity;
+    float m_falloff { 0.0 };
+    bool m_enabled { true };
+
+protected:
+    static void _bind_methods();
+
+public:
+    Shape get_shape() const;
+    void set_shape(Shape shape);
+
+    Vector3 get_position() const;
+    void set_position(Vector3 position);
+
+    Vector3 get_size() const;
+    void set_size(Vector3 size);
+
+    float get_radius() const;
+    void set_radius(float radius);
+
+    Vector3 get_velocity() const;
+    void set_velocity(Vector3 velocity);
+
+    float get_falloff() const;
+    void set_falloff(float falloff);
+
+    bool is_enabled() const;
+    void set_enabled(bool enabled);
+};
+
+}
+
+VARIANT_ENUM_CAST(ForceFieldEmitter::Shape);
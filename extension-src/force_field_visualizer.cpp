@@ -0,0 +1,451 @@
+#include "force_field_visualizer.h"
+
+#include <godot_cpp/classes/rendering_server.hpp>
+
+#include "godot_cpp/classes/array_mesh.hpp"
+#include "godot_cpp/classes/rd_sampler_state.hpp"
+#include "godot_cpp/classes/rd_texture_format.hpp"
+#include "godot_cpp/classes/rd_texture_view.hpp"
+#include "godot_cpp/classes/rd_uniform.hpp"
+#include "godot_cpp/classes/shader_material.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "compute_list_recorder.h"
+#include "force_field.h"
+
+using namespace godot;
+
+void ForceFieldVisualizer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_force_field"), &ForceFieldVisualizer::get_force_field);
+    ClassDB::bind_method(D_METHOD("set_force_field", "path"), &ForceFieldVisualizer::set_force_field);
+
+    ADD_PROPERTY(PropertyInfo(Variant::NODE_PATH, "force_field", PROPERTY_HINT_NODE_PATH_VALID_TYPES, "ForceField"), "set_force_field", "get_force_field");
+
+    ClassDB::bind_method(D_METHOD("get_mode"), &ForceFieldVisualizer::get_mode);
+    ClassDB::bind_method(D_METHOD("set_mode", "mode"), &ForceFieldVisualizer::set_mode);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "mode", PROPERTY_HINT_ENUM, "Cells,Particles"), "set_mode", "get_mode");
+
+    ClassDB::bind_method(D_METHOD("get_clip_x"), &ForceFieldVisualizer::get_clip_x);
+    ClassDB::bind_method(D_METHOD("set_clip_x", "clip_x"), &ForceFieldVisualizer::set_clip_x);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "clip_x", PROPERTY_HINT_RANGE, "0,1,0.001"), "set_clip_x", "get_clip_x");
+
+    ClassDB::bind_method(D_METHOD("get_magnitude_min"), &ForceFieldVisualizer::get_magnitude_min);
+    ClassDB::bind_method(D_METHOD("set_magnitude_min", "magnitude"), &ForceFieldVisualizer::set_magnitude_min);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "magnitude_min", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR), "set_magnitude_min", "get_magnitude_min");
+
+    ClassDB::bind_method(D_METHOD("get_magnitude_max"), &ForceFieldVisualizer::get_magnitude_max);
+    ClassDB::bind_method(D_METHOD("set_magnitude_max", "magnitude"), &ForceFieldVisualizer::set_magnitude_max);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "magnitude_max", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR), "set_magnitude_max", "get_magnitude_max");
+
+    ClassDB::bind_method(D_METHOD("get_show_pressure"), &ForceFieldVisualizer::get_show_pressure);
+    ClassDB::bind_method(D_METHOD("set_show_pressure", "enabled"), &ForceFieldVisualizer::set_show_pressure);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "show_pressure", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR), "set_show_pressure", "get_show_pressure");
+
+    ClassDB::bind_method(D_METHOD("get_particle_count"), &ForceFieldVisualizer::get_particle_count);
+    ClassDB::bind_method(D_METHOD("set_particle_count", "count"), &ForceFieldVisualizer::set_particle_count);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "particle_count", PROPERTY_HINT_RANGE, "1,4194304,1"), "set_particle_count", "get_particle_count");
+
+    ClassDB::bind_method(D_METHOD("get_particle_lifetime"), &ForceFieldVisualizer::get_particle_lifetime);
+    ClassDB::bind_method(D_METHOD("set_particle_lifetime", "lifetime"), &ForceFieldVisualizer::set_particle_lifetime);
+
+    ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "particle_lifetime", PROPERTY_HINT_RANGE, "0.1,60,0.1,or_greater,suffix:s"), "set_particle_lifetime", "get_particle_lifetime");
+
+    BIND_ENUM_CONSTANT(MODE_CELLS);
+    BIND_ENUM_CONSTANT(MODE_PARTICLES);
+}
+
+ForceFieldVisualizer::ForceFieldVisualizer() {
+    m_particle_texture.instantiate();
+}
+
+void ForceFieldVisualizer::_notification(int what) {
+    if (what != NOTIFICATION_PREDELETE || !m_particles_started) {
+        return;
+    }
+
+    // Lets the tracing still queued for this node finish, after that only this thread touches its resources.
+    RenderingServer::get_singleton()->force_sync();
+
+    m_particle_texture->set_texture_rd_rid(RID());
+
+    // Either set may already be gone with the texture it was created for.
+    Array uniform_sets;
+    uniform_sets.push_back(m_particle_state_set);
+    uniform_sets.push_back(m_field_set);
+
+    Array rids;
+
+    if (m_particle_state.is_valid()) {
+        rids.push_back(m_particle_state);
+    }
+
+    if (m_field_sampler.is_valid()) {
+        rids.push_back(m_field_sampler);
+    }
+
+    RenderingServer::get_singleton()->call_on_render_thread(callable_mp_static(&ForceFieldVisualizer::free_particle_resources)
+        .bind(uniform_sets, rids, m_particle_program.shader, m_particle_program.pipeline));
+
+    m_particle_program = ShaderCache::Program();
+    m_particle_state = RID();
+    m_particle_state_set = RID();
+    m_field_sampler = RID();
+    m_field_set = RID();
+    m_particles_started = false;
+}
+
+void ForceFieldVisualizer::free_particle_resources(const Array& uniform_sets, const Array& rids, const RID& shader, const RID& pipeline) {
+    RenderingDevice* device = RenderingServer::get_singleton()->get_rendering_device();
+
+    for (int64_t i = 0; i < uniform_sets.size(); ++i) {
+        const RID uniform_set = uniform_sets[i];
+
+        if (uniform_set.is_valid() && device->uniform_set_is_valid(uniform_set)) {
+            device->free_rid(uniform_set);
+        }
+    }
+
+    for (int64_t i = 0; i < rids.size(); ++i) {
+        device->free_rid(rids[i]);
+    }
+
+    if (shader.is_valid()) {
+        ShaderCache::get_singleton().release(device, ShaderCache::Program { shader, pipeline });
+    }
+}
+
+void ForceFieldVisualizer::_process(double delta) {
+    ForceField* field = get_force_field_node();
+
+    if (field == nullptr) {
+        return;
+    }
+
+    const Vector3i field_size = field->get_field_size();
+
+    if (m_mesh_dirty || field_size != m_mesh_field_size) {
+        m_mesh_dirty = false;
+        m_mesh_field_size = field_size;
+
+        set_shader_parameter("force_field", field->get_texture());
+        set_shader_parameter("field_size", field_size);
+
+        if (m_mode == MODE_PARTICLES) {
+            build_particle_mesh(m_particle_count);
+            set_shader_parameter("particles", m_particle_texture);
+        } else {
+            build_cell_mesh(field_size);
+        }
+    }
+
+    const Ref<Texture3DRD> texture = field->get_texture();
+
+    if (m_mode != MODE_PARTICLES || texture.is_null()) {
+        return;
+    }
+
+    const Vector3 extent = Vector3(field_size) * field->get_cell_size();
+    const float delta_time = std::min(static_cast<float>(delta), MAX_PARTICLE_STEP);
+
+    m_particles_started = true;
+
+    RenderingServer::get_singleton()->call_on_render_thread(callable_mp(this, &ForceFieldVisualizer::trace_particles)
+        .bind(texture, delta_time, Vector3(1.0, 1.0, 1.0) / extent, m_particle_count, m_particle_lifetime));
+}
+
+ForceField* ForceFieldVisualizer::get_force_field_node() const {
+    if (m_force_field.is_empty()) {
+        return nullptr;
+    }
+
+    return Object::cast_to<ForceField>(get_node_or_null(m_force_field));
+}
+
+void ForceFieldVisualizer::set_shader_parameter(const StringName& name, const Variant& value) const {
+    const Ref<ShaderMaterial> material = get_material_override();
+
+    if (material.is_valid()) {
+        material->set_shader_parameter(name, value);
+    }
+}
+
+Variant ForceFieldVisualizer::get_shader_parameter(const StringName& name, const Variant& fallback) const {
+    const Ref<ShaderMaterial> material = get_material_override();
+
+    if (material.is_null()) {
+        return fallback;
+    }
+
+    return material->get_shader_parameter(name);
+}
+
+void ForceFieldVisualizer::build_cell_mesh(Vector3i field_size) {
+    // Points of the interior cells at cell / (field_size - 1), starting at the first column on or behind clip_x.
+    const Vector3 scale = Vector3(1.0, 1.0, 1.0) / (Vector3(field_size) - Vector3(1.0, 1.0, 1.0));
+    const int first_x = std::max(1, static_cast<int>(std::ceil(m_clip_x * static_cast<float>(field_size.x - 1))));
+    const Vector3i end = field_size - Vector3i(2, 2, 2);
+
+    const int64_t columns = std::max(0, end.x - first_x);
+    const int64_t rows = std::max(0, end.y - 1);
+    const int64_t layers = std::max(0, end.z - 1);
+
+    PackedVector3Array vertices;
+    vertices.resize(columns * rows * layers);
+    Vector3* vertex = vertices.ptrw();
+
+    for (int x = first_x; x < end.x; ++x) {
+        for (int y = 1; y < end.y; ++y) {
+            for (int z = 1; z < end.z; ++z) {
+                *vertex++ = Vector3(x, y, z) * scale;
+            }
+        }
+    }
+
+    Ref<ArrayMesh> mesh;
+    mesh.instantiate();
+
+    if (!vertices.is_empty()) {
+        Array arrays;
+        arrays.resize(Mesh::ARRAY_MAX);
+        arrays[Mesh::ARRAY_VERTEX] = vertices;
+
+        mesh->add_surface_from_arrays(Mesh::PRIMITIVE_POINTS, arrays);
+    }
+
+    set_custom_aabb(AABB());
+    set_mesh(mesh);
+}
+
+void ForceFieldVisualizer::build_particle_mesh(int count) {
+    // Vertex i sits on the texel of particle i, the vertex shader moves it to where the particle is.
+    PackedVector3Array vertices;
+    vertices.resize(count);
+    Vector3* vertex = vertices.ptrw();
+
+    for (int i = 0; i < count; ++i) {
+        vertex[i] = Vector3(i % PARTICLE_TEXTURE_WIDTH + 0.5, i / PARTICLE_TEXTURE_WIDTH + 0.5, 0.0);
+    }
+
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
+    arrays[Mesh::ARRAY_VERTEX] = vertices;
+
+    Ref<ArrayMesh> mesh;
+    mesh.instantiate();
+    mesh->add_surface_from_arrays(Mesh::PRIMITIVE_POINTS, arrays);
+
+    // The vertex positions say nothing about where the particles are drawn.
+    set_custom_aabb(AABB(Vector3(), Vector3(1.0, 1.0, 1.0)));
+    set_mesh(mesh);
+}
+
+void ForceFieldVisualizer::init_particles(int count, float lifetime) {
+    RenderingDevice* device = RenderingServer::get_singleton()->get_rendering_device();
+    const int rows = (count + PARTICLE_TEXTURE_WIDTH - 1) / PARTICLE_TEXTURE_WIDTH;
+
+    // Random positions, with ages spread over the lifetime so the particles don't all respawn at once.
+    std::mt19937 generator(static_cast<uint32_t>(count));
+    std::uniform_real_distribution<float> distribution(0.0, 1.0);
+
+    PackedFloat32Array state;
+    state.resize(4 * PARTICLE_TEXTURE_WIDTH * rows);
+    float* values = state.ptrw();
+
+    for (int64_t i = 0; i < state.size(); i += 4) {
+        values[i] = distribution(generator);
+        values[i + 1] = distribution(generator);
+        values[i + 2] = distribution(generator);
+        values[i + 3] = distribution(generator) * lifetime;
+    }
+
+    Ref<RDTextureFormat> texture_format;
+    texture_format.instantiate();
+
+    texture_format->set_format(RenderingDevice::DATA_FORMAT_R32G32B32A32_SFLOAT);
+    texture_format->set_texture_type(RenderingDevice::TEXTURE_TYPE_2D);
+    texture_format->set_width(PARTICLE_TEXTURE_WIDTH);
+    texture_format->set_height(rows);
+    texture_format->set_depth(1);
+    texture_format->set_array_layers(1);
+    texture_format->set_mipmaps(1);
+    texture_format->set_usage_bits(
+        RenderingDevice::TEXTURE_USAGE_SAMPLING_BIT |
+        RenderingDevice::TEXTURE_USAGE_STORAGE_BIT |
+        RenderingDevice::TEXTURE_USAGE_CAN_UPDATE_BIT
+    );
+
+    Ref<RDTextureView> texture_view;
+    texture_view.instantiate();
+
+    TypedArray<PackedByteArray> data;
+    data.push_back(state.to_byte_array());
+
+    const RID previous_state = m_particle_state;
+    m_particle_state = device->texture_create(texture_format, texture_view, data);
+    m_particle_capacity = count;
+
+    TypedArray<RDUniform> uniforms;
+    Ref<RDUniform> uniform;
+    uniform.instantiate();
+
+    uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_IMAGE);
+    uniform->set_binding(0);
+    uniform->add_id(m_particle_state);
+    uniforms.push_back(uniform);
+
+    m_particle_state_set = device->uniform_set_create(uniforms, m_particle_program.shader, 0);
+    m_particle_texture->set_texture_rd_rid(m_particle_state);
+
+    // Takes the uniform set created for it along.
+    if (previous_state.is_valid()) {
+        device->free_rid(previous_state);
+    }
+}
+
+void ForceFieldVisualizer::trace_particles(const Ref<Texture3DRD>& field_texture, float delta_time, Vector3 inv_extent,
+                                           int count, float lifetime) {
+    RenderingDevice* device = RenderingServer::get_singleton()->get_rendering_device();
+
+    // Read here, a field on a local device swaps its display textures on this thread.
+    const RID field_rid = field_texture->get_texture_rd_rid();
+
+    if (!field_rid.is_valid()) {
+        return;
+    }
+
+    if (!m_particle_program.shader.is_valid()) {
+        m_particle_program = ShaderCache::get_singleton().acquire(device, "particles.glsl", String(), ShaderCache::Specialization());
+
+        Ref<RDSamplerState> sampler_state;
+        sampler_state.instantiate();
+
+        sampler_state->set_min_filter(RenderingDevice::SAMPLER_FILTER_LINEAR);
+        sampler_state->set_mag_filter(RenderingDevice::SAMPLER_FILTER_LINEAR);
+        sampler_state->set_repeat_u(RenderingDevice::SAMPLER_REPEAT_MODE_CLAMP_TO_EDGE);
+        sampler_state->set_repeat_v(RenderingDevice::SAMPLER_REPEAT_MODE_CLAMP_TO_EDGE);
+        sampler_state->set_repeat_w(RenderingDevice::SAMPLER_REPEAT_MODE_CLAMP_TO_EDGE);
+
+        m_field_sampler = device->sampler_create(sampler_state);
+    }
+
+    if (count != m_particle_capacity) {
+        init_particles(count, lifetime);
+    }
+
+    // The field replaces its texture when it is resized, which also frees the set.
+    if (field_rid != m_field_set_texture || !device->uniform_set_is_valid(m_field_set)) {
+        if (m_field_set.is_valid() && device->uniform_set_is_valid(m_field_set)) {
+            device->free_rid(m_field_set);
+        }
+
+        TypedArray<RDUniform> uniforms;
+        Ref<RDUniform> uniform;
+        uniform.instantiate();
+
+        uniform->set_uniform_type(RenderingDevice::UNIFORM_TYPE_SAMPLER_WITH_TEXTURE);
+        uniform->set_binding(0);
+        uniform->add_id(m_field_sampler);
+        uniform->add_id(field_rid);
+        uniforms.push_back(uniform);
+
+        m_field_set = device->uniform_set_create(uniforms, m_particle_program.shader, 1);
+        m_field_set_texture = field_rid;
+    }
+
+    const PackedFloat32Array push_floats{ inv_extent.x, inv_extent.y, inv_extent.z, delta_time, lifetime };
+    const PackedInt32Array push_ints{ count, static_cast<int32_t>(m_particle_frame++), 0 };
+
+    PackedByteArray push_constants{ push_floats.to_byte_array() };
+    push_constants.append_array(push_ints.to_byte_array());
+
+    ComputeListRecorder recorder(device, false);
+    recorder.bind_pipeline(m_particle_program.pipeline);
+    recorder.bind_uniform_set(m_particle_state_set, 0);
+    recorder.bind_uniform_set(m_field_set, 1);
+    recorder.set_push_constant(push_constants);
+    recorder.dispatch((count + 63) / 64, 1, 1);
+}
+
+NodePath ForceFieldVisualizer::get_force_field() const {
+    return m_force_field;
+}
+
+void ForceFieldVisualizer::set_force_field(const NodePath& path) {
+    m_force_field = path;
+    m_mesh_dirty = true;
+}
+
+ForceFieldVisualizer::Mode ForceFieldVisualizer::get_mode() const {
+    return m_mode;
+}
+
+void ForceFieldVisualizer::set_mode(Mode mode) {
+    m_mode = mode;
+    m_mesh_dirty = true;
+}
+
+float ForceFieldVisualizer::get_clip_x() const {
+    return m_clip_x;
+}
+
+void ForceFieldVisualizer::set_clip_x(float clip_x) {
+    m_clip_x = std::clamp(clip_x, 0.0f, 1.0f);
+    set_shader_parameter("clip_x", m_clip_x);
+
+    if (m_mode == MODE_CELLS) {
+        m_mesh_dirty = true;
+    }
+}
+
+float ForceFieldVisualizer::get_magnitude_min() const {
+    return get_shader_parameter("mag_min", 0.0);
+}
+
+void ForceFieldVisualizer::set_magnitude_min(float magnitude) {
+    set_shader_parameter("mag_min", magnitude);
+}
+
+float ForceFieldVisualizer::get_magnitude_max() const {
+    return get_shader_parameter("mag_max", 0.3);
+}
+
+void ForceFieldVisualizer::set_magnitude_max(float magnitude) {
+    set_shader_parameter("mag_max", magnitude);
+}
+
+bool ForceFieldVisualizer::get_show_pressure() const {
+    return get_shader_parameter("show_pressure", false);
+}
+
+void ForceFieldVisualizer::set_show_pressure(bool enabled) {
+    set_shader_parameter("show_pressure", enabled);
+}
+
+int ForceFieldVisualizer::get_particle_count() const {
+    return m_particle_count;
+}
+
+void ForceFieldVisualizer::set_particle_count(int count) {
+    m_particle_count = std::clamp(count, 1, MAX_PARTICLES);
+
+    if (m_mode == MODE_PARTICLES) {
+        m_mesh_dirty = true;
+    }
+}
+
+float ForceFieldVisualizer::get_particle_lifetime() const {
+    return m_particle_lifetime;
+}
+
+void ForceFieldVisualizer::set_particle_lifetime(float lifetime) {
+    m_particle_lifetime = std::max(lifetime, 0.1f);
+}
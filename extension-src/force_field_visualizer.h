@@ -0,0 +1,112 @@
+#pragma once
+
+#include <godot_cpp/classes/mesh_instance3d.hpp>
+#include <godot_cpp/classes/rendering_device.hpp>
+
+#include "godot_cpp/classes/texture2drd.hpp"
+#include "godot_cpp/classes/texture3drd.hpp"
+#include "godot_cpp/variant/node_path.hpp"
+
+#include "shader_cache.h"
+
+namespace godot {
+
+class ForceField;
+
+// Draws the output texture of a ForceField with the ShaderMaterial in material_override, which samples the
+// texture in its vertex shader and gets it as the force_field parameter.
+//
+// In MODE_CELLS the mesh has a point for every interior cell at its position in the unit cube, built here once per
+// field size and leaving out the cells in front of clip_x, so clipped cells cost nothing. In MODE_PARTICLES a fixed
+// pool of particle_count particles is advected through the field by shaders/particles.glsl on the main rendering
+// device. Their positions and ages live in a texture of PARTICLE_TEXTURE_WIDTH columns, passed as the particles
+// parameter, and vertex i of the mesh holds the texel of particle i, so the cost follows the particle budget
+// rather than the grid size.
+class ForceFieldVisualizer : public MeshInstance3D {
+    GDCLASS(ForceFieldVisualizer, MeshInstance3D)
+
+public:
+    enum Mode {
+        MODE_CELLS,
+        MODE_PARTICLES,
+    };
+
+    static constexpr int PARTICLE_TEXTURE_WIDTH = 1024;
+    static constexpr int MAX_PARTICLES = 1 << 22;
+
+    // A frame longer than this, for example after a hitch, moves the particles as if it took this long.
+    static constexpr float MAX_PARTICLE_STEP = 0.1;
+
+private:
+    NodePath m_force_field;
+    Mode m_mode { MODE_CELLS };
+    float m_clip_x { 0.0 };
+    int m_particle_count { 65536 };
+    float m_particle_lifetime { 4.0 };
+
+    // The mesh is rebuilt when the mode, the clip plane, the particle count or the field size changes.
+    bool m_mesh_dirty { true };
+    Vector3i m_mesh_field_size;
+    Ref<Texture2DRD> m_particle_texture;
+    bool m_particles_started { false };
+
+    // Render thread.
+    ShaderCache::Program m_particle_program;
+    RID m_particle_state;
+    int m_particle_capacity { 0 };
+    RID m_particle_state_set;
+    RID m_field_sampler;
+    RID m_field_set;
+    RID m_field_set_texture;
+    uint32_t m_particle_frame { 0 };
+
+    [[nodiscard]] ForceField* get_force_field_node() const;
+
+    void set_shader_parameter(const StringName& name, const Variant& value) const;
+    [[nodiscard]] Variant get_shader_parameter(const StringName& name, const Variant& fallback) const;
+
+    void build_cell_mesh(Vector3i field_size);
+    void build_particle_mesh(int count);
+
+    void init_particles(int count, float lifetime);
+    void trace_particles(const Ref<Texture3DRD>& field_texture, float delta_time, Vector3 inv_extent, int count, float lifetime);
+
+    static void free_particle_resources(const Array& uniform_sets, const Array& rids, const RID& shader, const RID& pipeline);
+
+protected:
+    static void _bind_methods();
+    void _notification(int what);
+
+public:
+    ForceFieldVisualizer();
+
+    void _process(double delta) override;
+
+    NodePath get_force_field() const;
+    void set_force_field(const NodePath& path);
+
+    Mode get_mode() const;
+    void set_mode(Mode mode);
+
+    float get_clip_x() const;
+    void set_clip_x(float clip_x);
+
+    float get_magnitude_min() const;
+    void set_magnitude_min(float magnitude);
+
+    float get_magnitude_max() const;
+    void set_magnitude_max(float magnitude);
+
+    bool get_show_pressure() const;
+    void set_show_pressure(bool enabled);
+
+    int get_particle_count() const;
+    void set_particle_count(int count);
+
+    float get_particle_lifetime() const;
+    void set_particle_lifetime(float lifetime);
+};
+
+}
+
+VARIANT_ENUM_CAST(ForceFieldVisualizer::Mode);
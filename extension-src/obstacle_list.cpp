@@ -0,0 +1,101 @@
+#include "obstacle_list.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+namespace {
+
+// Three rows of the affine matrix, the translation in w.
+void append_transform(float* values, const Transform3D& transform) {
+    for (int r = 0; r < 3; ++r) {
+        values[4 * r] = static_cast<float>(transform.basis.rows[r].x);
+        values[4 * r + 1] = static_cast<float>(transform.basis.rows[r].y);
+        values[4 * r + 2] = static_cast<float>(transform.basis.rows[r].z);
+        values[4 * r + 3] = static_cast<float>(transform.origin[r]);
+    }
+}
+
+}
+
+void ObstacleList::add(const Obstacle& obstacle) {
+    m_obstacles.push_back(obstacle);
+}
+
+uint32_t ObstacleList::add_triangles(const PackedVector3Array& faces) {
+    const auto first = static_cast<uint32_t>(m_triangles.size() / 12);
+    const int64_t vertices = faces.size() - faces.size() % 3;
+
+    for (int64_t v = 0; v < vertices; ++v) {
+        const Vector3 vertex = faces[v];
+        m_triangles.insert(m_triangles.end(), {
+            static_cast<float>(vertex.x), static_cast<float>(vertex.y), static_cast<float>(vertex.z), 0.0f
+        });
+    }
+
+    return first;
+}
+
+int ObstacleList::get_count() const {
+    return static_cast<int>(m_obstacles.size());
+}
+
+PackedByteArray ObstacleList::to_bytes() const {
+    std::vector<uint32_t> words(HEADER_WORDS + RECORD_WORDS * m_obstacles.size(), 0);
+    words[0] = static_cast<uint32_t>(m_obstacles.size());
+
+    for (size_t o = 0; o < m_obstacles.size(); ++o) {
+        const Obstacle& obstacle = m_obstacles[o];
+        uint32_t* record = words.data() + HEADER_WORDS + RECORD_WORDS * o;
+
+        float transforms[24];
+        append_transform(transforms, obstacle.to_shape);
+        append_transform(transforms + 12, obstacle.previous);
+        std::memcpy(record, transforms, sizeof(transforms));
+
+        record[24] = obstacle.shape;
+        record[25] = obstacle.first_triangle;
+        record[26] = obstacle.triangle_count;
+
+        const float size[3] = {
+            static_cast<float>(obstacle.size.x), static_cast<float>(obstacle.size.y), static_cast<float>(obstacle.size.z)
+        };
+        std::memcpy(record + 28, size, sizeof(size));
+
+        for (int a = 0; a < 3; ++a) {
+            record[32 + a] = static_cast<uint32_t>(obstacle.cell_min[a]);
+            record[36 + a] = static_cast<uint32_t>(obstacle.cell_max[a]);
+        }
+    }
+
+    PackedByteArray bytes;
+    bytes.resize(static_cast<int64_t>(words.size() * sizeof(uint32_t)));
+    std::memcpy(bytes.ptrw(), words.data(), words.size() * sizeof(uint32_t));
+
+    return bytes;
+}
+
+PackedByteArray ObstacleList::triangles_to_bytes() const {
+    PackedByteArray bytes;
+    bytes.resize(static_cast<int64_t>(m_triangles.size() * sizeof(float)));
+
+    if (!m_triangles.empty()) {
+        std::memcpy(bytes.ptrw(), m_triangles.data(), m_triangles.size() * sizeof(float));
+    }
+
+    return bytes;
+}
+
+void ObstacleList::get_cell_range(const AABB& bounds, const float cell_size, const Vector3i faces, Vector3i& cell_min,
+                                  Vector3i& cell_max) {
+    // Cell ijk is centred at (ijk + 0.5) * cell_size.
+    for (int a = 0; a < 3; ++a) {
+        const float lower = static_cast<float>(bounds.position[a]) / cell_size - 0.5f;
+        const float upper = static_cast<float>(bounds.position[a] + bounds.size[a]) / cell_size - 0.5f;
+
+        cell_min[a] = std::max(0, static_cast<int>(std::ceil(lower)));
+        cell_max[a] = std::min(faces[a] - 1, static_cast<int>(std::floor(upper)));
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <godot_cpp/variant/aabb.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_vector3_array.hpp>
+#include <godot_cpp/variant/transform3d.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Moving obstacles of a field and the triangles of their meshes, in the buffer layout
+// shaders/voxelize_obstacles.glsl reads: a header of four words (the obstacle count) followed by RECORD_WORDS
+// words per obstacle, and a separate buffer of three vec4 per triangle.
+class ObstacleList {
+public:
+    enum Shape : uint32_t {
+        SHAPE_BOX,
+        SHAPE_SPHERE,
+        SHAPE_CAPSULE,
+        SHAPE_CYLINDER,
+        SHAPE_MESH,
+    };
+
+    struct Obstacle {
+        Shape shape { SHAPE_BOX };
+        // From the field's local space into the shape's, and from the shape's back into the field's as it was
+        // the frame before, which gives the velocity of every point of the shape.
+        Transform3D to_shape;
+        Transform3D previous;
+        // Half extents of a box, otherwise radius in x and the height along the shape's y axis in y.
+        Vector3 size;
+        uint32_t first_triangle { 0 };
+        uint32_t triangle_count { 0 };
+        // Inclusive range of the cells whose centre may lie inside.
+        Vector3i cell_min;
+        Vector3i cell_max;
+    };
+
+    // A box of cells to voxelize again.
+    struct Region {
+        Vector3i origin;
+        Vector3i size;
+    };
+
+    static constexpr int HEADER_WORDS = 4;
+    static constexpr int RECORD_WORDS = 40;
+
+    void add(const Obstacle& obstacle);
+    // Appends the triangles of a mesh, three vertices each in the mesh's local space, and returns the first index.
+    uint32_t add_triangles(const PackedVector3Array& faces);
+
+    [[nodiscard]] int get_count() const;
+    [[nodiscard]] PackedByteArray to_bytes() const;
+    [[nodiscard]] PackedByteArray triangles_to_bytes() const;
+
+    // The cells of a field whose centre lies in bounds, given in the field's local space, clamped to the field.
+    // Empty ranges have a max below their min.
+    static void get_cell_range(const AABB& bounds, float cell_size, Vector3i faces, Vector3i& cell_min, Vector3i& cell_max);
+
+private:
+    std::vector<Obstacle> m_obstacles;
+    std::vector<float> m_triangles;
+};
+
+}
@@ -0,0 +1,156 @@
+#include "pass_profiler.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace godot;
+
+void PassProfiler::set_owner_id(uint64_t owner_id) {
+    // Names are matched against every captured timestamp, so they are built once.
+    const String prefix = String("ForceField ") + String::num_uint64(owner_id) + " ";
+
+    m_begin_name = prefix + "begin";
+
+    for (int pass = 0; pass < PASS_MAX; ++pass) {
+        m_pass_names[pass] = prefix + get_pass_name(static_cast<Pass>(pass));
+    }
+}
+
+const char* PassProfiler::get_pass_name(Pass pass) {
+    static constexpr const char* names[PASS_MAX] = {
+        "solid_mask",
+        "active_bricks",
+        "integrate",
+        "pressure",
+        "extrapolation",
+        "advection",
+        "copy_to_texture",
+    };
+
+    return names[pass];
+}
+
+void PassProfiler::begin(RenderingDevice* device, ComputeListRecorder& recorder) const {
+    recorder.end();
+    device->capture_timestamp(m_begin_name);
+}
+
+void PassProfiler::mark(RenderingDevice* device, ComputeListRecorder& recorder, Pass pass) const {
+    recorder.end();
+    device->capture_timestamp(m_pass_names[pass]);
+}
+
+void PassProfiler::read_timestamps(RenderingDevice* device) {
+    // Captured timestamps stay available until the next frame finishes, don't count them twice.
+    const uint64_t frame = device->get_captured_timestamps_frame();
+
+    if (frame == m_last_frame) {
+        return;
+    }
+
+    m_last_frame = frame;
+
+    std::array<uint64_t, PASS_MAX> frame_usec {};
+    std::array<bool, PASS_MAX> seen {};
+    uint64_t previous_time = 0;
+
+    const uint32_t count = device->get_captured_timestamps_count();
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const String name = device->get_captured_timestamp_name(i);
+
+        if (name == m_begin_name) {
+            previous_time = device->get_captured_timestamp_gpu_time(i);
+            continue;
+        }
+
+        for (int pass = 0; pass < PASS_MAX; ++pass) {
+            if (name != m_pass_names[pass]) {
+                continue;
+            }
+
+            const uint64_t time = device->get_captured_timestamp_gpu_time(i);
+
+            if (previous_time > 0 && time >= previous_time) {
+                frame_usec[pass] += time - previous_time;
+                seen[pass] = true;
+            }
+
+            previous_time = time;
+            break;
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    for (int pass = 0; pass < PASS_MAX; ++pass) {
+        if (!seen[pass]) {
+            continue;
+        }
+
+        Window& window = m_windows[pass];
+        window.samples[window.next] = frame_usec[pass];
+        window.next = (window.next + 1) % WINDOW_SIZE;
+        window.count = std::min(window.count + 1, WINDOW_SIZE);
+    }
+}
+
+Dictionary PassProfiler::get_timings() const {
+    std::lock_guard lock(m_mutex);
+
+    Dictionary timings;
+
+    for (int pass = 0; pass < PASS_MAX; ++pass) {
+        const Window& window = m_windows[pass];
+
+        if (window.count == 0) {
+            continue;
+        }
+
+        std::vector<uint64_t> sorted(window.samples.begin(), window.samples.begin() + window.count);
+        std::sort(sorted.begin(), sorted.end());
+
+        uint64_t sum = 0;
+
+        for (const uint64_t sample : sorted) {
+            sum += sample;
+        }
+
+        // Nearest rank, with a full window this is the second largest sample.
+        const int p99_rank = std::max(1, (99 * window.count + 99) / 100);
+
+        Dictionary stats;
+        stats["min_usec"] = double(sorted.front());
+        stats["avg_usec"] = double(sum) / window.count;
+        stats["p99_usec"] = double(sorted[p99_rank - 1]);
+        stats["samples"] = window.count;
+
+        timings[get_pass_name(static_cast<Pass>(pass))] = stats;
+    }
+
+    return timings;
+}
+
+double PassProfiler::get_average_usec(Pass pass) const {
+    std::lock_guard lock(m_mutex);
+
+    const Window& window = m_windows[pass];
+
+    if (window.count == 0) {
+        return 0.0;
+    }
+
+    uint64_t sum = 0;
+
+    for (int i = 0; i < window.count; ++i) {
+        sum += window.samples[i];
+    }
+
+    return double(sum) / window.count;
+}
+
+void PassProfiler::clear() {
+    std::lock_guard lock(m_mutex);
+
+    m_windows.fill(Window());
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <godot_cpp/classes/rendering_device.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+
+#include <array>
+#include <mutex>
+
+#include "compute_list_recorder.h"
+
+namespace godot {
+
+// Brackets the passes of a simulation step with GPU timestamps and keeps a rolling window of the time each pass
+// took. A timestamp can only be captured between compute lists, so every mark closes the current one.
+//
+// Marks are recorded and read on the render thread, the statistics can be queried from any thread.
+class PassProfiler {
+public:
+    enum Pass {
+        PASS_SOLID_MASK,
+        PASS_ACTIVE_BRICKS,
+        PASS_INTEGRATE,
+        PASS_PRESSURE,
+        PASS_EXTRAPOLATION,
+        PASS_ADVECTION,
+        PASS_COPY_TO_TEXTURE,
+        PASS_MAX,
+    };
+
+    static constexpr int WINDOW_SIZE = 120;
+
+    PassProfiler() = default;
+
+    PassProfiler(const PassProfiler&) = delete;
+    PassProfiler& operator=(const PassProfiler&) = delete;
+
+    [[nodiscard]] static const char* get_pass_name(Pass pass);
+
+    // Names the timestamps after the owning object, so several fields in one scene are kept apart.
+    void set_owner_id(uint64_t owner_id);
+
+    // Starts the timing of the first pass of a step.
+    void begin(RenderingDevice* device, ComputeListRecorder& recorder) const;
+
+    // Ends the timing of pass, the next pass starts here.
+    void mark(RenderingDevice* device, ComputeListRecorder& recorder, Pass pass) const;
+
+    // Collects the timestamps of the most recent frame the GPU has finished. Passes recorded several times in that
+    // frame count as one sample with the summed time.
+    void read_timestamps(RenderingDevice* device);
+
+    // Per pass name a Dictionary of min_usec, avg_usec, p99_usec and samples over the window.
+    [[nodiscard]] Dictionary get_timings() const;
+    [[nodiscard]] double get_average_usec(Pass pass) const;
+
+    void clear();
+
+private:
+    struct Window {
+        std::array<uint64_t, WINDOW_SIZE> samples {};
+        int next { 0 };
+        int count { 0 };
+    };
+
+    String m_begin_name;
+    std::array<String, PASS_MAX> m_pass_names;
+
+    mutable std::mutex m_mutex;
+    std::array<Window, PASS_MAX> m_windows;
+    uint64_t m_last_frame { 0 };
+};
+
+}
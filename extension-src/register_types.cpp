@@ -5,6 +5,8 @@
 #include <godot_cpp/godot.hpp>
 
 #include "force_field.h"
+#include "force_field_emitter.h"
+#include "force_field_visualizer.h"
 
 using namespace godot;
 
@@ -13,7 +15,9 @@ void initialize_force_field_module(ModuleInitializationLevel p_level) {
 		return;
 	}
 
+	GDREGISTER_CLASS(ForceFieldEmitter);
 	GDREGISTER_RUNTIME_CLASS(ForceField);
+	GDREGISTER_RUNTIME_CLASS(ForceFieldVisualizer);
 }
 
 void uninitialize_force_field_module(ModuleInitializationLevel p_level) {
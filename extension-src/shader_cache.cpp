@@ -0,0 +1,140 @@
+#include "shader_cache.h"
+
+#include "godot_cpp/classes/rd_pipeline_specialization_constant.hpp"
+#include "godot_cpp/classes/rd_shader_file.hpp"
+#include "godot_cpp/classes/rd_shader_spirv.hpp"
+#include "godot_cpp/classes/resource_loader.hpp"
+#include "godot_cpp/variant/typed_array.hpp"
+
+#include <algorithm>
+
+using namespace godot;
+
+ShaderCache& ShaderCache::get_singleton() {
+    static ShaderCache cache;
+    return cache;
+}
+
+ShaderCache::Program ShaderCache::acquire(RenderingDevice* device, const String& file, const String& version,
+                                          const Specialization& specialization) {
+    std::lock_guard lock(m_mutex);
+
+    auto shader_entry = std::find_if(m_shaders.begin(), m_shaders.end(), [&](const ShaderEntry& entry) {
+        return entry.device == device && entry.file == file && entry.version == version;
+    });
+
+    if (shader_entry == m_shaders.end()) {
+        const Ref<RDShaderFile> shader_file = ResourceLoader::get_singleton()->load("res://extensions/force-field/shaders/" + file);
+
+        ShaderEntry entry;
+        entry.device = device;
+        entry.file = file;
+        entry.version = version;
+        entry.shader = device->shader_create_from_spirv(shader_file->get_spirv(version));
+
+        m_shaders.push_back(entry);
+        shader_entry = m_shaders.end() - 1;
+        ++m_compile_count;
+    }
+
+    const RID shader = shader_entry->shader;
+
+    for (PipelineEntry& entry : m_pipelines) {
+        if (entry.device == device && entry.shader == shader && entry.specialization == specialization) {
+            ++entry.references;
+            ++m_hit_count;
+            return Program { shader, entry.pipeline };
+        }
+    }
+
+    PipelineEntry entry;
+    entry.device = device;
+    entry.shader = shader;
+    entry.specialization = specialization;
+    entry.pipeline = create_pipeline(device, shader, specialization);
+    entry.references = 1;
+
+    m_pipelines.push_back(entry);
+    ++shader_entry->pipelines;
+    ++m_pipeline_count;
+
+    return Program { shader, entry.pipeline };
+}
+
+RID ShaderCache::create_pipeline(RenderingDevice* device, const RID& shader, const Specialization& specialization) {
+    // The defaults are the ones the shaders declare, kernels without constants take this path.
+    if (specialization == Specialization()) {
+        return device->compute_pipeline_create(shader);
+    }
+
+    // Constants a shader doesn't declare are ignored.
+    const Variant values[] = {
+        specialization.faces.x,
+        specialization.faces.y,
+        specialization.faces.z,
+        specialization.cell_size,
+        specialization.over_relaxation,
+        specialization.density,
+        specialization.tile.x,
+        specialization.tile.y,
+        specialization.tile.z,
+    };
+
+    TypedArray<RDPipelineSpecializationConstant> constants;
+
+    for (uint32_t id = 0; id < std::size(values); ++id) {
+        Ref<RDPipelineSpecializationConstant> constant;
+        constant.instantiate();
+        constant->set_constant_id(id);
+        constant->set_value(values[id]);
+        constants.push_back(constant);
+    }
+
+    return device->compute_pipeline_create(shader, constants);
+}
+
+void ShaderCache::release(RenderingDevice* device, const Program& program) {
+    std::lock_guard lock(m_mutex);
+
+    const auto pipeline_entry = std::find_if(m_pipelines.begin(), m_pipelines.end(), [&](const PipelineEntry& entry) {
+        return entry.device == device && entry.pipeline == program.pipeline;
+    });
+
+    ERR_FAIL_COND_MSG(pipeline_entry == m_pipelines.end(), "Program was not acquired from the cache.");
+
+    if (--pipeline_entry->references > 0) {
+        return;
+    }
+
+    device->free_rid(pipeline_entry->pipeline);
+    m_pipelines.erase(pipeline_entry);
+
+    const auto shader_entry = std::find_if(m_shaders.begin(), m_shaders.end(), [&](const ShaderEntry& entry) {
+        return entry.device == device && entry.shader == program.shader;
+    });
+
+    if (shader_entry != m_shaders.end() && --shader_entry->pipelines == 0) {
+        device->free_rid(shader_entry->shader);
+        m_shaders.erase(shader_entry);
+    }
+}
+
+Dictionary ShaderCache::get_stats() const {
+    std::lock_guard lock(m_mutex);
+
+    int references = 0;
+
+    for (const PipelineEntry& entry : m_pipelines) {
+        references += entry.references;
+    }
+
+    Dictionary stats;
+    stats["shaders"] = static_cast<int64_t>(m_shaders.size());
+    stats["pipelines"] = static_cast<int64_t>(m_pipelines.size());
+    stats["references"] = references;
+    stats["compiled"] = static_cast<int64_t>(m_compile_count);
+    stats["pipelines_built"] = static_cast<int64_t>(m_pipeline_count);
+    stats["hits"] = static_cast<int64_t>(m_hit_count);
+
+    return stats;
+}
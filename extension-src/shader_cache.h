@@ -0,0 +1,101 @@
+#pragma once
+
+#include <godot_cpp/classes/rendering_device.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/vector3i.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace godot {
+
+// Compute shaders and their pipelines, shared by every field in the process. A shader is compiled the first time a
+// field asks for a file and version on a device, and a pipeline the first time it asks for that shader with a set of
+// specialization constants. Later fields on the same device get the same ones, and each is freed when the last field
+// releases it, while fields on a local rendering device get their own. Since freeing a shader frees every uniform set
+// created for it, fields free their own sets before releasing a program.
+//
+// Programs are acquired and released on the thread that drives their device, get_stats() can be called from any
+// thread.
+class ShaderCache {
+public:
+    struct Program {
+        RID shader;
+        RID pipeline;
+    };
+
+    // Values of the specialization constants in shaders/specialization.glslinc. Kernels that don't include it
+    // are acquired with the defaults, so they don't get a pipeline per grid size.
+    struct Specialization {
+        enum ConstantId : uint32_t {
+            CONSTANT_FACES_X,
+            CONSTANT_FACES_Y,
+            CONSTANT_FACES_Z,
+            CONSTANT_CELL_SIZE,
+            CONSTANT_OVER_RELAXATION,
+            CONSTANT_DENSITY,
+            CONSTANT_TILE_X,
+            CONSTANT_TILE_Y,
+            CONSTANT_TILE_Z,
+        };
+
+        // Zero leaves the kernels reading the GridParameter uniform.
+        Vector3i faces;
+        float cell_size { 0.0 };
+        float over_relaxation { 1.7 };
+        float density { 1000.0 };
+        // Local size of the tiled kernels, one thread per cell.
+        Vector3i tile { 8, 8, 8 };
+
+        bool operator==(const Specialization& other) const {
+            return faces == other.faces && cell_size == other.cell_size && over_relaxation == other.over_relaxation &&
+                   density == other.density && tile == other.tile;
+        }
+    };
+
+    static ShaderCache& get_singleton();
+
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    // file is relative to the shader directory of the extension.
+    [[nodiscard]] Program acquire(RenderingDevice* device, const String& file, const String& version,
+                                  const Specialization& specialization);
+    void release(RenderingDevice* device, const Program& program);
+
+    // Number of live shaders and pipelines, references to the pipelines, and how many acquires compiled a
+    // shader, built a pipeline or found one.
+    [[nodiscard]] Dictionary get_stats() const;
+
+private:
+    struct ShaderEntry {
+        RenderingDevice* device { nullptr };
+        String file;
+        String version;
+        RID shader;
+        int pipelines { 0 };
+    };
+
+    struct PipelineEntry {
+        RenderingDevice* device { nullptr };
+        RID shader;
+        Specialization specialization;
+        RID pipeline;
+        int references { 0 };
+    };
+
+    ShaderCache() = default;
+
+    [[nodiscard]] static RID create_pipeline(RenderingDevice* device, const RID& shader, const Specialization& specialization);
+
+    mutable std::mutex m_mutex;
+    std::vector<ShaderEntry> m_shaders;
+    std::vector<PipelineEntry> m_pipelines;
+    uint64_t m_compile_count { 0 };
+    uint64_t m_pipeline_count { 0 };
+    uint64_t m_hit_count { 0 };
+};
+
+}
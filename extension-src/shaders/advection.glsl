@@ -1,76 +1,215 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+fp32_tiled = "#define SHARED_TILE";
+fp16_tiled = "#define FIELD_FP16\n#define SHARED_TILE";
+fp32_brick4_tiled = "#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE";
+fp16_brick4_tiled = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE";
+fp32_brick8_tiled = "#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE";
+fp16_brick8_tiled = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE";
+fp32_fused = "#define FUSED_OUTPUT";
+fp16_fused = "#define FIELD_FP16\n#define FUSED_OUTPUT";
+fp32_brick4_fused = "#define FIELD_BRICK_SIZE 4\n#define FUSED_OUTPUT";
+fp16_brick4_fused = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4\n#define FUSED_OUTPUT";
+fp32_brick8_fused = "#define FIELD_BRICK_SIZE 8\n#define FUSED_OUTPUT";
+fp16_brick8_fused = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8\n#define FUSED_OUTPUT";
+fp32_tiled_fused = "#define SHARED_TILE\n#define FUSED_OUTPUT";
+fp16_tiled_fused = "#define FIELD_FP16\n#define SHARED_TILE\n#define FUSED_OUTPUT";
+fp32_brick4_tiled_fused = "#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE\n#define FUSED_OUTPUT";
+fp16_brick4_tiled_fused = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE\n#define FUSED_OUTPUT";
+fp32_brick8_tiled_fused = "#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE\n#define FUSED_OUTPUT";
+fp16_brick8_tiled_fused = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE\n#define FUSED_OUTPUT";
+
 #[compute]
 #version 450
 
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+#include "active_bricks.glslinc"
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
+// The fused variants also write the output texture, which replaces the extrapolation and copy_to_texture.glsl
+// passes of a dense step. They read back the output faces they leave as they are.
+#ifdef FUSED_OUTPUT
+#define VELOCITY_OUT_ACCESS
+#else
+#define VELOCITY_OUT_ACCESS writeonly
+#endif
+
 layout(set = 0, binding = 0, std430) buffer readonly VelocityUInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } u_in;
 layout(set = 0, binding = 1, std430) buffer readonly VelocityVInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } v_in;
 layout(set = 0, binding = 2, std430) buffer readonly VelocityWInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } w_in;
 
-layout(set = 1, binding = 0, std430) buffer writeonly VelocityUOutData {
-    float velocity[];
+layout(set = 1, binding = 0, std430) buffer VELOCITY_OUT_ACCESS VelocityUOutData {
+    FIELD_TYPE velocity[];
 } u_out;
-layout(set = 1, binding = 1, std430) buffer writeonly VelocityVOutData {
-    float velocity[];
+layout(set = 1, binding = 1, std430) buffer VELOCITY_OUT_ACCESS VelocityVOutData {
+    FIELD_TYPE velocity[];
 } v_out;
-layout(set = 1, binding = 2, std430) buffer writeonly VelocityWOutData {
-    float velocity[];
+layout(set = 1, binding = 2, std430) buffer VELOCITY_OUT_ACCESS VelocityWOutData {
+    FIELD_TYPE velocity[];
 } w_out;
 
-layout(set = 2, binding = 0, std430) buffer readonly SolidData {
-    float is_fluid[];
-} solid_data;
+layout(set = 2, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
 
 layout(set = 3, binding = 0) uniform GridParameter {
     ivec3 faces;
     float cell_size;
+    ivec3 wrap;
 } grid_parameters;
 
+layout(set = 4, binding = 0, std430) buffer readonly ActiveBrickData {
+    ACTIVE_BRICK_DATA
+} active_bricks;
+
+#ifdef FUSED_OUTPUT
+
+layout(set = 5, binding = 0, std430) buffer readonly PressureData {
+    FIELD_TYPE pressure[];
+} pressure_data;
+
+layout(set = 6, binding = 0, FIELD_IMAGE_FORMAT) uniform restrict writeonly image3D image;
+
+#endif
+
 layout(push_constant, std430) uniform Params {
     float delta_time;
+#ifdef FUSED_OUTPUT
+    // Non-zero on the last substep of a frame.
+    uint write_output;
+#endif
 } pc;
 
 int toIndex(ivec3 uvw) {
-    ivec3 items = grid_parameters.faces;
-    return (uvw.z * items.x * items.y) + (uvw.y * items.x) + uvw.x;
+    return GRID_INDEX(uvw);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
+}
+
+#ifdef SHARED_TILE
+
+// The brick plus one cell below and two above it on every axis. The neighbour averages reach one cell out and the
+// back-traced samples of a face moving less than a cell per step reach two, anything further falls back to
+// the global buffers.
+const int TILE_SIZE = ACTIVE_BRICK_SIZE + 3;
+const int TILE_CELLS = TILE_SIZE * TILE_SIZE * TILE_SIZE;
+
+shared float tile_u[TILE_CELLS];
+shared float tile_v[TILE_CELLS];
+shared float tile_w[TILE_CELLS];
+
+ivec3 tile_origin;
+
+// Must be reached by every invocation of the workgroup.
+void loadTile(ivec3 brick_origin) {
+    tile_origin = brick_origin - ivec3(1);
+
+    for (int t = int(gl_LocalInvocationIndex); t < TILE_CELLS; t += ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE) {
+        int idx = toIndex(tile_origin + linearCoord(t, ivec3(TILE_SIZE)));
+        tile_u[t] = FIELD_LOAD(u_in.velocity, idx);
+        tile_v[t] = FIELD_LOAD(v_in.velocity, idx);
+        tile_w[t] = FIELD_LOAD(w_in.velocity, idx);
+    }
+
+    barrier();
+}
+
+#define MAKE_LOAD_FN(DIM, SOURCE) float load_##DIM(ivec3 uvw) { \
+    ivec3 t = uvw - tile_origin;\
+    if (all(greaterThanEqual(t, ivec3(0))) && all(lessThan(t, ivec3(TILE_SIZE)))) {\
+        return tile_##DIM[linearIndex(t, ivec3(TILE_SIZE))];\
+    }\
+    return FIELD_LOAD(SOURCE.velocity, toIndex(uvw));\
+}
+
+#else
+
+void loadTile(ivec3 brick_origin) {
+}
+
+#define MAKE_LOAD_FN(DIM, SOURCE) float load_##DIM(ivec3 uvw) { \
+    return FIELD_LOAD(SOURCE.velocity, toIndex(uvw));\
+}
+
+#endif
+
+MAKE_LOAD_FN(u, u_in)
+MAKE_LOAD_FN(v, v_in)
+MAKE_LOAD_FN(w, w_in)
+
+#ifdef FUSED_OUTPUT
+
+// Without the extrapolation pass the faces on the domain boundary still hold what the pressure solve left there,
+// they read as the zero it would have written.
+#define MAKE_FETCH_FN(DIM, DIM_IDX) float fetch_##DIM(ivec3 uvw) { \
+    if (uvw[DIM_IDX] == 0 || uvw[DIM_IDX] == GRID_FACES[DIM_IDX] - 1) {\
+        return 0.0;\
+    }\
+    return load_##DIM(uvw);\
+}
+
+#else
+
+#define MAKE_FETCH_FN(DIM, DIM_IDX) float fetch_##DIM(ivec3 uvw) { \
+    return load_##DIM(uvw);\
 }
 
-#define MAKE_SAMPLE_FN(DIM, DIM_IDX, SOURCE) float sample_field_##DIM(vec3 pos) { \
-    pos = clamp(pos, vec3(0.0, 0.0, 0.0), grid_parameters.cell_size * vec3(grid_parameters.faces - ivec3(1)));\
+#endif
+
+MAKE_FETCH_FN(u, 0)
+MAKE_FETCH_FN(v, 1)
+MAKE_FETCH_FN(w, 2)
+
+#define MAKE_SAMPLE_FN(DIM, DIM_IDX) float sample_field_##DIM(vec3 pos) { \
+    pos = clamp(pos, vec3(0.0, 0.0, 0.0), GRID_CELL_SIZE * vec3(GRID_FACES - ivec3(1)));\
 \
-    vec3 d_xyz = 0.5 * vec3(grid_parameters.cell_size);\
+    vec3 d_xyz = 0.5 * vec3(GRID_CELL_SIZE);\
     d_xyz[DIM_IDX] = 0.0;\
 \
-    vec3 ijk_max = grid_parameters.faces - ivec3(1);\
+    vec3 ijk_max = GRID_FACES - ivec3(1);\
 \
-    vec3 ijk1 = min(floor((pos - d_xyz) / grid_parameters.cell_size), ijk_max);\
+    vec3 ijk1 = min(floor((pos - d_xyz) / GRID_CELL_SIZE), ijk_max);\
 \
-    int idx_1 = toIndex(ivec3(ijk1));\
-    int idx_2 = toIndex(ivec3(min(ijk1 + vec3(0.0, 1.0, 0.0), ijk_max)));\
-    int idx_3 = toIndex(ivec3(min(ijk1 + vec3(0.0, 0.0, 1.0), ijk_max)));\
-    int idx_4 = toIndex(ivec3(min(ijk1 + vec3(0.0, 1.0, 1.0), ijk_max)));\
-    int idx_5 = toIndex(ivec3(min(ijk1 + vec3(1.0, 0.0, 0.0), ijk_max)));\
-    int idx_6 = toIndex(ivec3(min(ijk1 + vec3(1.0, 1.0, 0.0), ijk_max)));\
-    int idx_7 = toIndex(ivec3(min(ijk1 + vec3(1.0, 0.0, 1.0), ijk_max)));\
-    int idx_8 = toIndex(ivec3(min(ijk1 + vec3(1.0, 1.0, 1.0), ijk_max)));\
-\
-    float w1 = ((pos - d_xyz - ijk1 * grid_parameters.cell_size) / grid_parameters.cell_size)[DIM_IDX];\
+    float w1 = ((pos - d_xyz - ijk1 * GRID_CELL_SIZE) / GRID_CELL_SIZE)[DIM_IDX];\
     float w2 = 1.0 - w1;\
 \
-    float vel1 = SOURCE.velocity[idx_1];\
-    float vel2 = SOURCE.velocity[idx_2];\
-    float vel3 = SOURCE.velocity[idx_3];\
-    float vel4 = SOURCE.velocity[idx_4];\
-    float vel5 = SOURCE.velocity[idx_5];\
-    float vel6 = SOURCE.velocity[idx_6];\
-    float vel7 = SOURCE.velocity[idx_7];\
-    float vel8 = SOURCE.velocity[idx_8];\
+    float vel1 = fetch_##DIM(ivec3(ijk1));\
+    float vel2 = fetch_##DIM(ivec3(min(ijk1 + vec3(0.0, 1.0, 0.0), ijk_max)));\
+    float vel3 = fetch_##DIM(ivec3(min(ijk1 + vec3(0.0, 0.0, 1.0), ijk_max)));\
+    float vel4 = fetch_##DIM(ivec3(min(ijk1 + vec3(0.0, 1.0, 1.0), ijk_max)));\
+    float vel5 = fetch_##DIM(ivec3(min(ijk1 + vec3(1.0, 0.0, 0.0), ijk_max)));\
+    float vel6 = fetch_##DIM(ivec3(min(ijk1 + vec3(1.0, 1.0, 0.0), ijk_max)));\
+    float vel7 = fetch_##DIM(ivec3(min(ijk1 + vec3(1.0, 0.0, 1.0), ijk_max)));\
+    float vel8 = fetch_##DIM(ivec3(min(ijk1 + vec3(1.0, 1.0, 1.0), ijk_max)));\
 \
     return w1 * w1 * w1 * vel1 +\
              w1 * w2 * w1 * vel2 +\
@@ -82,102 +221,186 @@ int toIndex(ivec3 uvw) {
              w2 * w2 * w2 * vel8;\
 }
 
-MAKE_SAMPLE_FN(u, 0, u_in)
-MAKE_SAMPLE_FN(v, 1, v_in)
-MAKE_SAMPLE_FN(w, 2, w_in)
+MAKE_SAMPLE_FN(u, 0)
+MAKE_SAMPLE_FN(v, 1)
+MAKE_SAMPLE_FN(w, 2)
 
-void main() {
-	ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
-    int i = toIndex(ijk);
+float advect_u(ivec3 ijk) {
+    float cell_size = GRID_CELL_SIZE;
 
-    if (
-            ijk.x == 0 || ijk.y == 0 || ijk.z == 0
-        ) {
-        return;
-    }
+    float vel_u_v1 = fetch_v(ijk);
+    float vel_u_v2 = fetch_v(ijk + ivec3( 0, 1, 0));
+    float vel_u_v3 = fetch_v(ijk + ivec3(-1, 0, 0));
+    float vel_u_v4 = fetch_v(ijk + ivec3(-1, 1, 0));
+
+    float vel_u_w1 = fetch_w(ijk);
+    float vel_u_w2 = fetch_w(ijk + ivec3( 0, 0, 1));
+    float vel_u_w3 = fetch_w(ijk + ivec3(-1, 0, 0));
+    float vel_u_w4 = fetch_w(ijk + ivec3(-1, 0, 1));
+
+    vec3 vel_u = vec3(
+            fetch_u(ijk),
+            (vel_u_v1 + vel_u_v2 + vel_u_v3 + vel_u_v4) * 0.25,
+            (vel_u_w1 + vel_u_w2 + vel_u_w3 + vel_u_w4) * 0.25
+            );
+    vec3 p_u = vec3(ijk * cell_size) + 0.5*vec3(0.0, cell_size, cell_size) - vel_u * pc.delta_time;
 
-    float u0 = u_in.velocity[i];
-    float v0 = v_in.velocity[i];
-    float w0 = w_in.velocity[i];
+    return sample_field_u(p_u);
+}
 
-    /*
-    u_out.velocity[i] = u_in.velocity[i];
-    v_out.velocity[i] = v_in.velocity[i];
-    w_out.velocity[i] = w_in.velocity[i];
+float advect_v(ivec3 ijk) {
+    float cell_size = GRID_CELL_SIZE;
 
-    return;
-    */
+    float vel_v_u1 = fetch_u(ijk);
+    float vel_v_u2 = fetch_u(ijk + ivec3(1,  0, 0));
+    float vel_v_u3 = fetch_u(ijk + ivec3(0, -1, 0));
+    float vel_v_u4 = fetch_u(ijk + ivec3(1, -1, 0));
 
-    bool is_fluid = solid_data.is_fluid[i] > 0.0;
-    float cell_size = grid_parameters.cell_size;
+    float vel_v_w1 = fetch_w(ijk);
+    float vel_v_w2 = fetch_w(ijk + ivec3(0,  0, 1));
+    float vel_v_w3 = fetch_w(ijk + ivec3(0, -1, 0));
+    float vel_v_w4 = fetch_w(ijk + ivec3(0, -1, 1));
 
-    // Advect U
+    vec3 vel_v = vec3(
+            (vel_v_u1 + vel_v_u2 + vel_v_u3 + vel_v_u4) * 0.25,
+            fetch_v(ijk),
+            (vel_v_w1 + vel_v_w2 + vel_v_w3 + vel_v_w4) * 0.25
+            );
+    vec3 p_v = vec3(ijk * cell_size) + 0.5*vec3(cell_size, 0.0, cell_size) - vel_v * pc.delta_time;
 
-    if (is_fluid && solid_data.is_fluid[toIndex(ijk - ivec3(1, 0, 0))] > 0.0) {
-        float vel_u_v1 = v0;
-        float vel_u_v2 = v_in.velocity[toIndex(ijk + ivec3( 0, 1, 0))];
-        float vel_u_v3 = v_in.velocity[toIndex(ijk + ivec3(-1, 0, 0))];
-        float vel_u_v4 = v_in.velocity[toIndex(ijk + ivec3(-1, 1, 0))];
+    return sample_field_v(p_v);
+}
 
-        float vel_u_w1 = w0;
-        float vel_u_w2 = w_in.velocity[toIndex(ijk + ivec3( 0, 0, 1))];
-        float vel_u_w3 = w_in.velocity[toIndex(ijk + ivec3(-1, 0, 0))];
-        float vel_u_w4 = w_in.velocity[toIndex(ijk + ivec3(-1, 0, 1))];
+float advect_w(ivec3 ijk) {
+    float cell_size = GRID_CELL_SIZE;
 
-        vec3 vel_u = vec3(
-                u0,
-                (vel_u_v1 + vel_u_v2 + vel_u_v3 + vel_u_v4) * 0.25,
-                (vel_u_w1 + vel_u_w2 + vel_u_w3 + vel_u_w4) * 0.25
-                );
-        vec3 p_u = vec3(ijk * cell_size) + 0.5*vec3(0.0, cell_size, cell_size) - vel_u * pc.delta_time;
+    float vel_w_u1 = fetch_u(ijk);
+    float vel_w_u2 = fetch_u(ijk + ivec3(1, 0,  0));
+    float vel_w_u3 = fetch_u(ijk + ivec3(0, 0, -1));
+    float vel_w_u4 = fetch_u(ijk + ivec3(1, 0, -1));
 
-        u_out.velocity[i] = sample_field_u(p_u);
-    }
+    float vel_w_v1 = fetch_v(ijk);
+    float vel_w_v2 = fetch_v(ijk + ivec3(0, 1, 0));
+    float vel_w_v3 = fetch_v(ijk + ivec3(0, 0, -1));
+    float vel_w_v4 = fetch_v(ijk + ivec3(0, 1, -1));
+
+    vec3 vel_w = vec3(
+            (vel_w_u1 + vel_w_u2 + vel_w_u3 + vel_w_u4) * 0.25,
+            (vel_w_v1 + vel_w_v2 + vel_w_v3 + vel_w_v4) * 0.25,
+            fetch_w(ijk)
+            );
+
+    vec3 p_w = vec3(ijk * cell_size) + 0.5*vec3(cell_size, cell_size, 0.0) - vel_w * pc.delta_time;
+
+    return sample_field_w(p_w);
+}
+
+// A face is advected when the cells on both sides of it are fluid, the lower faces of the border cells never are.
+bool advectsFace(ivec3 ijk, uint mask, uint neighbour) {
+    return ijk.x > 0 && ijk.y > 0 && ijk.z > 0 && (mask & FLUID_SELF) != 0u && (mask & neighbour) != 0u;
+}
 
-    // Advect V
+#ifdef FUSED_OUTPUT
+#define LOAD_KEPT_FACE(OUT, IDX) FIELD_LOAD(OUT.velocity, IDX)
+#else
+#define LOAD_KEPT_FACE(OUT, IDX) 0.0
+#endif
 
-    if (is_fluid && solid_data.is_fluid[toIndex(ijk - ivec3(0, 1, 0))] > 0.0) {
-        float vel_v_u1 = u0;
-        float vel_v_u2 = u_in.velocity[toIndex(ijk + ivec3(1,  0, 0))];
-        float vel_v_u3 = u_in.velocity[toIndex(ijk + ivec3(0, -1, 0))];
-        float vel_v_u4 = u_in.velocity[toIndex(ijk + ivec3(1, -1, 0))];
+// The new value of the lower DIM face of a cell, stored when store is set. A face that isn't advected keeps what
+// the output buffer holds, which only the fused variants need.
+#define MAKE_UPDATE_FN(DIM, NEIGHBOUR, OUT) float update_##DIM(ivec3 ijk, bool store) { \
+    int idx = toIndex(ijk);\
+    if (advectsFace(ijk, solidMask(idx), NEIGHBOUR)) {\
+        float value = advect_##DIM(ijk);\
+        if (store) {\
+            FIELD_STORE(OUT.velocity, idx, value);\
+        }\
+        return value;\
+    }\
+    return LOAD_KEPT_FACE(OUT, idx);\
+}
+
+MAKE_UPDATE_FN(u, FLUID_NEG_X, u_out)
+MAKE_UPDATE_FN(v, FLUID_NEG_Y, v_out)
+MAKE_UPDATE_FN(w, FLUID_NEG_Z, w_out)
+
+#ifdef FUSED_OUTPUT
+
+// The new faces of the brick plus the layer above it on their own axis, which belongs to the next brick.
+const ivec3 OUTPUT_U_SIZE = ivec3(ACTIVE_BRICK_SIZE + 1, ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE);
+const ivec3 OUTPUT_V_SIZE = ivec3(ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE + 1, ACTIVE_BRICK_SIZE);
+const ivec3 OUTPUT_W_SIZE = ivec3(ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE + 1);
+
+shared float output_u[(ACTIVE_BRICK_SIZE + 1) * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE];
+shared float output_v[(ACTIVE_BRICK_SIZE + 1) * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE];
+shared float output_w[(ACTIVE_BRICK_SIZE + 1) * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE];
+
+// Writes the cell the same way copy_to_texture.glsl does, from the faces this step just produced. The upper
+// faces of the brick are being written by the next workgroup, so the last layer works them out itself.
+//
+// Must be reached by every invocation of the workgroup.
+void storeOutput(ivec3 ijk, vec3 velocity) {
+    ivec3 faces = GRID_FACES;
+    ivec3 local = ivec3(gl_LocalInvocationID);
+    ivec3 upper = min(ijk + ivec3(1), faces - ivec3(1));
+
+    output_u[linearIndex(local, OUTPUT_U_SIZE)] = velocity.x;
+    output_v[linearIndex(local, OUTPUT_V_SIZE)] = velocity.y;
+    output_w[linearIndex(local, OUTPUT_W_SIZE)] = velocity.z;
+
+    if (local.x == ACTIVE_BRICK_SIZE - 1) {
+        output_u[linearIndex(local + ivec3(1, 0, 0), OUTPUT_U_SIZE)] = update_u(ivec3(upper.x, ijk.yz), false);
+    }
+    if (local.y == ACTIVE_BRICK_SIZE - 1) {
+        output_v[linearIndex(local + ivec3(0, 1, 0), OUTPUT_V_SIZE)] = update_v(ivec3(ijk.x, upper.y, ijk.z), false);
+    }
+    if (local.z == ACTIVE_BRICK_SIZE - 1) {
+        output_w[linearIndex(local + ivec3(0, 0, 1), OUTPUT_W_SIZE)] = update_w(ivec3(ijk.xy, upper.z), false);
+    }
+
+    barrier();
 
-        float vel_v_w1 = w0;
-        float vel_v_w2 = w_in.velocity[toIndex(ijk + ivec3(0,  0, 1))];
-        float vel_v_w3 = w_in.velocity[toIndex(ijk + ivec3(0, -1, 0))];
-        float vel_v_w4 = w_in.velocity[toIndex(ijk + ivec3(0, -1, 1))];
+    if (any(equal(ijk, ivec3(0))) || any(equal(ijk, faces - ivec3(1)))) {
+        return;
+    }
 
-        vec3 vel_v = vec3(
-                (vel_v_u1 + vel_v_u2 + vel_v_u3 + vel_v_u4) * 0.25,
-                v0,
-                (vel_v_w1 + vel_v_w2 + vel_v_w3 + vel_v_w4) * 0.25
-                );
-        vec3 p_v = vec3(ijk * cell_size) + 0.5*vec3(cell_size, 0.0, cell_size) - vel_v * pc.delta_time;
+    int idx = toIndex(ijk);
 
-        v_out.velocity[i] = sample_field_v(p_v);
+    if ((solidMask(idx) & FLUID_NEIGHBOURS) == 0u) {
+        imageStore(image, ijk, vec4(0.0, 0.0, 0.0, 0.0));
+        return;
     }
 
-    // Advect W
+    vec3 velocity0 = vec3(
+            output_u[linearIndex(local, OUTPUT_U_SIZE)],
+            output_v[linearIndex(local, OUTPUT_V_SIZE)],
+            output_w[linearIndex(local, OUTPUT_W_SIZE)]
+            );
+    vec3 velocity1 = vec3(
+            output_u[linearIndex(local + ivec3(1, 0, 0), OUTPUT_U_SIZE)],
+            output_v[linearIndex(local + ivec3(0, 1, 0), OUTPUT_V_SIZE)],
+            output_w[linearIndex(local + ivec3(0, 0, 1), OUTPUT_W_SIZE)]
+            );
+    float pressure = FIELD_LOAD(pressure_data.pressure, idx);
+
+    imageStore(image, ijk, vec4((velocity0 + velocity1) * 0.5, pressure));
+}
 
-    if (is_fluid && solid_data.is_fluid[toIndex(ijk - ivec3(0, 0, 1))] > 0.0) {
-        float vel_w_u1 = u0;
-        float vel_w_u2 = u_in.velocity[toIndex(ijk + ivec3(1, 0,  0))];
-        float vel_w_u3 = u_in.velocity[toIndex(ijk + ivec3(0, 0, -1))];
-        float vel_w_u4 = u_in.velocity[toIndex(ijk + ivec3(1, 0, -1))];
+#endif
 
-        float vel_w_v1 = v0;
-        float vel_w_v2 = v_in.velocity[toIndex(ijk + ivec3(0, 1, 0))];
-        float vel_w_v3 = v_in.velocity[toIndex(ijk + ivec3(0, 0, -1))];
-        float vel_w_v4 = v_in.velocity[toIndex(ijk + ivec3(0, 1, -1))];
+void main() {
+    // One workgroup per listed brick.
+    ivec3 brick_origin = activeBrickOrigin(active_bricks.bricks[gl_WorkGroupID.x], GRID_FACES);
+    ivec3 ijk = brick_origin + ivec3(gl_LocalInvocationID);
 
-        vec3 vel_w = vec3(
-                (vel_w_u1 + vel_w_u2 + vel_w_u3 + vel_w_u4) * 0.25,
-                (vel_w_v1 + vel_w_v2 + vel_w_v3 + vel_w_v4) * 0.25,
-                w0
-                );
+    loadTile(brick_origin);
 
-        vec3 p_w = vec3(ijk * cell_size) + 0.5*vec3(cell_size, cell_size, 0.0) - vel_w * pc.delta_time;
+    vec3 velocity = vec3(update_u(ijk, true), update_v(ijk, true), update_w(ijk, true));
 
-        w_out.velocity[i] = sample_field_w(p_w);
+#ifdef FUSED_OUTPUT
+    // The same for the whole dispatch, so the barrier in storeOutput is reached by all invocations or none.
+    if (pc.write_output != 0u) {
+        storeOutput(ijk, velocity);
     }
+#endif
 }
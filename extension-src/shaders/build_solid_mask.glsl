@@ -0,0 +1,99 @@
+#[versions]
+
+linear = "";
+brick4 = "#define FIELD_BRICK_SIZE 4";
+brick8 = "#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_index.glslinc"
+
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly SolidData {
+    float is_fluid[];
+} solid_data;
+
+layout(set = 1, binding = 0, std430) buffer writeonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+layout(set = 2, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+// The box of cells to rebuild, the whole field at start-up and the regions moving obstacles touched afterwards.
+layout(push_constant, std430) uniform Params {
+    ivec3 origin;
+    int padding;
+    ivec3 size;
+} pc;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+
+uint fluidFlag(ivec3 ijk, uint flag) {
+    if (any(lessThan(ijk, ivec3(0))) || any(greaterThanEqual(ijk, grid_parameters.faces))) {
+        return 0u;
+    }
+
+    return solid_data.is_fluid[wrappedIndex(ijk, grid_parameters.wrap, grid_parameters.faces)] > 0.0 ? flag : 0u;
+}
+
+// One byte per cell, four cells per word: the six face neighbours and the cell itself. One thread per cell of the
+// region, each rebuilds the whole word its cell is packed into. Threads sharing a word write the same value.
+void main() {
+    ivec3 faces = grid_parameters.faces;
+    ivec3 local = ivec3(gl_GlobalInvocationID);
+    ivec3 cell = pc.origin + local;
+
+    if (any(greaterThanEqual(local, pc.size)) || any(greaterThanEqual(cell, faces))) {
+        return;
+    }
+
+    int cell_count = fieldCapacity(faces);
+    int word = wrappedIndex(cell, grid_parameters.wrap, faces) >> 2;
+    uint packed_cells = 0u;
+
+    for (int c = 0; c < 4; c++) {
+        int idx = 4 * word + c;
+
+        if (idx >= cell_count) {
+            break;
+        }
+
+        ivec3 stored = fieldCoord(idx, faces);
+
+        // Padding of a partial brick, never part of the domain.
+        if (any(greaterThanEqual(stored, faces))) {
+            continue;
+        }
+
+        // The cells sharing the word are neighbours in the buffer, the flags are about their neighbours in the
+        // window of a scrolling field.
+        ivec3 ijk = unwrapCoord(stored, grid_parameters.wrap, faces);
+
+        uint mask =
+            fluidFlag(ijk - ivec3(1, 0, 0), FLUID_NEG_X) |
+            fluidFlag(ijk - ivec3(0, 1, 0), FLUID_NEG_Y) |
+            fluidFlag(ijk - ivec3(0, 0, 1), FLUID_NEG_Z) |
+            fluidFlag(ijk + ivec3(1, 0, 0), FLUID_POS_X) |
+            fluidFlag(ijk + ivec3(0, 1, 0), FLUID_POS_Y) |
+            fluidFlag(ijk + ivec3(0, 0, 1), FLUID_POS_Z) |
+            fluidFlag(ijk, FLUID_SELF);
+
+        packed_cells |= mask << (8 * c);
+    }
+
+    solid_mask.cells[word] = packed_cells;
+}
@@ -0,0 +1,88 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout(set = 0, binding = 0, std430) buffer VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0, std430) buffer VelocityU2Data {
+    FIELD_TYPE velocity[];
+} data2_u;
+layout(set = 1, binding = 1, std430) buffer VelocityV2Data {
+    FIELD_TYPE velocity[];
+} data2_v;
+layout(set = 1, binding = 2, std430) buffer VelocityW2Data {
+    FIELD_TYPE velocity[];
+} data2_w;
+
+layout(set = 2, binding = 0, std430) buffer PressureData {
+    FIELD_TYPE pressure[];
+} pressure_data;
+
+layout(set = 3, binding = 0, std430) buffer writeonly SolidData {
+    float is_fluid[];
+} solid_data;
+
+layout(set = 4, binding = 0, std430) buffer writeonly StaticSolidData {
+    float is_fluid[];
+} static_solid;
+
+layout(set = 5, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+// The box of cells a scrolling field has just moved over, in cells of its window after the move.
+layout(push_constant, std430) uniform Params {
+    ivec3 origin;
+    int padding;
+    ivec3 size;
+} pc;
+
+// One thread per cell: the cells still hold what the window left behind on its far side, they start over as
+// resting fluid. Obstacles reaching into them are voxelized again afterwards.
+void main() {
+    ivec3 local = ivec3(gl_GlobalInvocationID);
+    ivec3 ijk = pc.origin + local;
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(greaterThanEqual(local, pc.size)) || any(greaterThanEqual(ijk, faces))) {
+        return;
+    }
+
+    int idx = wrappedIndex(ijk, grid_parameters.wrap, faces);
+
+    FIELD_STORE(data_u.velocity, idx, 0.0);
+    FIELD_STORE(data_v.velocity, idx, 0.0);
+    FIELD_STORE(data_w.velocity, idx, 0.0);
+    FIELD_STORE(data2_u.velocity, idx, 0.0);
+    FIELD_STORE(data2_v.velocity, idx, 0.0);
+    FIELD_STORE(data2_w.velocity, idx, 0.0);
+    FIELD_STORE(pressure_data.pressure, idx, 0.0);
+
+    solid_data.is_fluid[idx] = 1.0;
+    static_solid.is_fluid[idx] = 1.0;
+}
@@ -0,0 +1,54 @@
+#[compute]
+#version 450
+
+#include "field_index.glslinc"
+#include "active_bricks.glslinc"
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly BrickFlagData {
+    uint flags[];
+} brick_flags;
+
+layout(set = 1, binding = 0, std430) buffer ActiveBrickData {
+    ACTIVE_BRICK_DATA
+} active_bricks;
+
+layout(set = 2, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+} grid_parameters;
+
+// One thread per brick. Bricks next to a marked one are listed as well, so motion can spread into them
+// during the step.
+void main() {
+    ivec3 bricks = grid_parameters.faces / ACTIVE_BRICK_SIZE;
+    int brick = int(gl_GlobalInvocationID.x);
+
+    if (brick >= bricks.x * bricks.y * bricks.z) {
+        return;
+    }
+
+    ivec3 b = linearCoord(brick, bricks);
+    ivec3 b0 = max(b - ivec3(1), ivec3(0));
+    ivec3 b1 = min(b + ivec3(1), bricks - ivec3(1));
+    uint active = 0u;
+
+    for (int k = b0.z; k <= b1.z; k++) {
+        for (int j = b0.y; j <= b1.y; j++) {
+            for (int i = b0.x; i <= b1.x; i++) {
+                active |= brick_flags.flags[linearIndex(ivec3(i, j, k), bricks)];
+            }
+        }
+    }
+
+    if (active == 0u) {
+        return;
+    }
+
+    uint slot = atomicAdd(active_bricks.count, 1u);
+    active_bricks.bricks[slot] = uint(brick);
+
+    atomicMax(active_bricks.brick_groups[0], slot + 1u);
+    atomicMax(active_bricks.block_groups[0], slot / 8u + 1u);
+}
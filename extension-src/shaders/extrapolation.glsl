@@ -1,21 +1,37 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
 #[compute]
 #version 450
 
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
 
 layout(set = 0, binding = 0, std430) buffer VelocityUData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_u;
 layout(set = 0, binding = 1, std430) buffer VelocityVData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_v;
 layout(set = 0, binding = 2, std430) buffer VelocityWData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_w;
 
 layout(set = 1, binding = 0) uniform GridParameter {
     ivec3 faces;
     float cell_size;
+    ivec3 wrap;
 } grid_parameters;
 
 layout(push_constant, std430) uniform Params {
@@ -23,7 +39,7 @@ layout(push_constant, std430) uniform Params {
 } pc;
 
 uint toIndex(uint i, uint j, uint k) {
-    return (k * grid_parameters.faces.x * grid_parameters.faces.y) + (j * grid_parameters.faces.x) + i;
+    return uint(GRID_INDEX(ivec3(i, j, k)));
 }
 
 void main() {
@@ -32,9 +48,9 @@ void main() {
     uint a = gl_GlobalInvocationID.x;
     uint b = gl_GlobalInvocationID.y;
 
-    uint max_i = grid_parameters.faces.x - 1;
-    uint max_j = grid_parameters.faces.y - 1;
-    uint max_k = grid_parameters.faces.z - 1;
+    uint max_i = GRID_FACES.x - 1;
+    uint max_j = GRID_FACES.y - 1;
+    uint max_k = GRID_FACES.z - 1;
 
     /*
     data_u.velocity[toIndex(0, a, b)] = data_u.velocity[toIndex(1, a, b)];
@@ -46,12 +62,12 @@ void main() {
     data_w.velocity[toIndex(a, b, 0)] = data_w.velocity[toIndex(a, b, 1)];
     data_w.velocity[toIndex(a, b, max_k)] = data_w.velocity[toIndex(a, b, max_k - 1)];
     */
-    data_u.velocity[toIndex(0, a, b)] = 0.0;
-    data_u.velocity[toIndex(max_i, a, b)] = 0.0;
+    FIELD_STORE(data_u.velocity, toIndex(0, a, b), 0.0);
+    FIELD_STORE(data_u.velocity, toIndex(max_i, a, b), 0.0);
 
-    data_v.velocity[toIndex(a, 0, b)] = 0.0;
-    data_v.velocity[toIndex(a, max_j, b)] = 0.0;
+    FIELD_STORE(data_v.velocity, toIndex(a, 0, b), 0.0);
+    FIELD_STORE(data_v.velocity, toIndex(a, max_j, b), 0.0);
 
-    data_w.velocity[toIndex(a, b, 0)] = 0.0;
-    data_w.velocity[toIndex(a, b, max_k)] = 0.0;
+    FIELD_STORE(data_w.velocity, toIndex(a, b, 0), 0.0);
+    FIELD_STORE(data_w.velocity, toIndex(a, b, max_k), 0.0);
 }
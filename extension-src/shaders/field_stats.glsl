@@ -0,0 +1,140 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer readonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer readonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0, std430) buffer readonly PressureData {
+    FIELD_TYPE pressure[];
+} pressure_data;
+
+layout(set = 2, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
+
+layout(set = 3, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+// One record of four vec4s per workgroup, reduced by reduce.glsl:
+//   0: min of u, v, w and pressure
+//   1: max of u, v, w and pressure
+//   2: sum of u, v, w and pressure
+//   3: kinetic energy, max |divergence|, max |face velocity|, fluid cell count
+layout(set = 4, binding = 0, std430) buffer writeonly PartialData {
+    vec4 values[];
+} partials;
+
+const int STATS_COLUMNS = 4;
+const float FLOAT_MAX = 3.402823e38;
+
+int toIndex(ivec3 ijk) {
+    return GRID_INDEX(ijk);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
+}
+
+shared vec4 scratch[512];
+
+vec4 combine(int column, vec4 a, vec4 b) {
+    if (column == 0) {
+        return min(a, b);
+    }
+
+    if (column == 1) {
+        return max(a, b);
+    }
+
+    if (column == 2) {
+        return a + b;
+    }
+
+    return vec4(a.x + b.x, max(a.yz, b.yz), a.w + b.w);
+}
+
+// Only fluid cells away from the border count, the same cells the solver updates.
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 faces = GRID_FACES;
+
+    vec4 record[STATS_COLUMNS] = vec4[STATS_COLUMNS](
+        vec4(FLOAT_MAX), vec4(-FLOAT_MAX), vec4(0.0), vec4(0.0)
+    );
+
+    if (all(greaterThan(ijk, ivec3(0))) && all(lessThan(ijk, faces - ivec3(1)))) {
+        int idx = toIndex(ijk);
+        uint mask = solidMask(idx);
+
+        if ((mask & FLUID_SELF) != 0u) {
+            float u0 = FIELD_LOAD(data_u.velocity, idx);
+            float v0 = FIELD_LOAD(data_v.velocity, idx);
+            float w0 = FIELD_LOAD(data_w.velocity, idx);
+            float u1 = FIELD_LOAD(data_u.velocity, toIndex(ijk + ivec3(1, 0, 0)));
+            float v1 = FIELD_LOAD(data_v.velocity, toIndex(ijk + ivec3(0, 1, 0)));
+            float w1 = FIELD_LOAD(data_w.velocity, toIndex(ijk + ivec3(0, 0, 1)));
+            float p = FIELD_LOAD(pressure_data.pressure, idx);
+
+            vec4 values = vec4(u0, v0, w0, p);
+            vec3 centre = 0.5 * vec3(u0 + u1, v0 + v1, w0 + w1);
+            float cell_size = GRID_CELL_SIZE;
+
+            float energy = 0.5 * DENSITY * dot(centre, centre) * cell_size * cell_size * cell_size;
+            float divergence = (mask & FLUID_NEIGHBOURS) != 0u ? abs(u1 - u0 + v1 - v0 + w1 - w0) / cell_size : 0.0;
+            float face_speed = max(abs(u0), max(abs(v0), abs(w0)));
+
+            record = vec4[STATS_COLUMNS](values, values, values, vec4(energy, divergence, face_speed, 1.0));
+        }
+    }
+
+    uint local = gl_LocalInvocationIndex;
+    uint group = gl_WorkGroupID.x + gl_NumWorkGroups.x * (gl_WorkGroupID.y + gl_NumWorkGroups.y * gl_WorkGroupID.z);
+
+    for (int column = 0; column < STATS_COLUMNS; ++column) {
+        scratch[local] = record[column];
+        barrier();
+
+        for (uint stride = 256; stride > 0; stride >>= 1) {
+            if (local < stride) {
+                scratch[local] = combine(column, scratch[local], scratch[local + stride]);
+            }
+            barrier();
+        }
+
+        if (local == 0) {
+            partials.values[group * STATS_COLUMNS + column] = scratch[0];
+        }
+        barrier();
+    }
+}
@@ -1,77 +1,103 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
 #[compute]
 #version 450
 
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+#include "active_bricks.glslinc"
+
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
 
 layout(set = 0, binding = 0, std430) buffer readonly VelocityUInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } u_in;
 layout(set = 0, binding = 1, std430) buffer readonly VelocityVInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } v_in;
 layout(set = 0, binding = 2, std430) buffer readonly VelocityWInData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } w_in;
 
 layout(set = 1, binding = 0, std430) buffer writeonly VelocityUOutData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } u_out;
 layout(set = 1, binding = 1, std430) buffer writeonly VelocityVOutData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } v_out;
 layout(set = 1, binding = 2, std430) buffer writeonly VelocityWOutData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } w_out;
 
 layout(set = 2, binding = 0, std430) buffer writeonly PressureInData {
-    float pressure[];
+    FIELD_TYPE pressure[];
 } pressure_data;
 
-layout(set = 3, binding = 0, std430) buffer readonly SolidData {
-    float is_fluid[];
-} solid_data;
+layout(set = 3, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
 
 layout(set = 4, binding = 0) uniform GridParameter {
     ivec3 faces;
     float cell_size;
+    ivec3 wrap;
 } grid_parameters;
 
-layout(set = 5, binding = 0) uniform Emitter {
-    vec3 min;
-    vec3 max;
-    vec3 velocity;
-} emitter;
+#define EMITTER_SET 5
+#include "emitters.glslinc"
+
+layout(set = 6, binding = 0, std430) buffer readonly ActiveBrickData {
+    ACTIVE_BRICK_DATA
+} active_bricks;
 
 layout(push_constant, std430) uniform Params {
     float delta_time;
 } pc;
 
 int toIndex(ivec3 ijk) {
-    ivec3 items = grid_parameters.faces;
-    return (ijk.z * items.x * items.y) + (ijk.y * items.x) + ijk.x;
+    return GRID_INDEX(ijk);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
 }
 
 void main() {
     vec3 g = vec3(0.0, -9.81, 0.0);
-	ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    // One workgroup per listed brick.
+    ivec3 ijk = activeBrickOrigin(active_bricks.bricks[gl_WorkGroupID.x], GRID_FACES) + ivec3(gl_LocalInvocationID);
     int i = toIndex(ijk);
 
-    float s = ijk.y > 1 && ijk.y < grid_parameters.faces.y - 1 && ijk.x > 0 && ijk.z > 0 ? 1.0 : 0.0;
-    s = s * solid_data.is_fluid[i] * solid_data.is_fluid[toIndex(ijk - ivec3(0.0, 1.0, 0.0))];
+    float s = ijk.y > 1 && ijk.y < GRID_FACES.y - 1 && ijk.x > 0 && ijk.z > 0 ? 1.0 : 0.0;
+    s = (solidMask(i) & (FLUID_SELF | FLUID_NEG_Y)) == (FLUID_SELF | FLUID_NEG_Y) ? s : 0.0;
     s = 0;
 
-    u_out.velocity[i] = u_in.velocity[i] + s * pc.delta_time * g.x;
-    v_out.velocity[i] = v_in.velocity[i] + s * pc.delta_time * g.y;
-    w_out.velocity[i] = w_in.velocity[i] + s * pc.delta_time * g.z;
-
-    ivec3 emitter0 = ivec3(floor(vec3(grid_parameters.faces) * emitter.min));
-    ivec3 emitter1 = ivec3(floor(vec3(grid_parameters.faces) * emitter.max));
+    vec3 velocity = vec3(FIELD_LOAD(u_in.velocity, i), FIELD_LOAD(v_in.velocity, i), FIELD_LOAD(w_in.velocity, i));
+    velocity = applyEmitters(ijk, GRID_FACES, velocity + s * pc.delta_time * g, pc.delta_time);
 
-    if (length(emitter.velocity) > 0.0 && ijk.x > emitter0.x && ijk.x < emitter1.x && ijk.y > emitter0.y && ijk.y < emitter1.y && ijk.z > emitter0.z && ijk.z < emitter1.z) {
-        u_out.velocity[i] = emitter.velocity.x * pc.delta_time;
-        v_out.velocity[i] = emitter.velocity.y * pc.delta_time;
-        w_out.velocity[i] = emitter.velocity.z * pc.delta_time;
-    }
+    FIELD_STORE(u_out.velocity, i, velocity.x);
+    FIELD_STORE(v_out.velocity, i, velocity.y);
+    FIELD_STORE(w_out.velocity, i, velocity.z);
 
-    pressure_data.pressure[i] = 0.0;
+    FIELD_STORE(pressure_data.pressure, i, 0.0);
 }
@@ -0,0 +1,87 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "active_bricks.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer readonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer readonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+#define EMITTER_SET 2
+#include "emitters.glslinc"
+
+layout(set = 3, binding = 0, std430) buffer writeonly BrickFlagData {
+    uint flags[];
+} brick_flags;
+
+layout(set = 4, binding = 0, std430) buffer ActiveBrickData {
+    ACTIVE_BRICK_DATA
+} active_bricks;
+
+layout(push_constant, std430) uniform Params {
+    float threshold;
+} pc;
+
+shared uint brick_active;
+
+// One workgroup per brick: a brick is active if any face velocity in it exceeds the threshold or an emitter is
+// binned to it. compact_active_bricks.glsl turns the flags into the list.
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 faces = grid_parameters.faces;
+
+    if (gl_LocalInvocationIndex == 0u) {
+        brick_active = 0u;
+    }
+
+    // Cleared here so the compaction that follows can append.
+    if (all(equal(gl_GlobalInvocationID, uvec3(0u)))) {
+        active_bricks.brick_groups = uint[3](0u, 1u, 1u);
+        active_bricks.block_groups = uint[3](0u, 1u, 1u);
+        active_bricks.count = 0u;
+    }
+
+    barrier();
+
+    int idx = wrappedIndex(ijk, grid_parameters.wrap, faces);
+    float speed = max(abs(FIELD_LOAD(data_u.velocity, idx)), max(abs(FIELD_LOAD(data_v.velocity, idx)), abs(FIELD_LOAD(data_w.velocity, idx))));
+
+    bool in_emitter = emitterRange(ivec3(gl_WorkGroupID), faces).y > 0u;
+
+    if (speed > pc.threshold || in_emitter) {
+        atomicOr(brick_active, 1u);
+    }
+
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0u) {
+        brick_flags.flags[linearIndex(ivec3(gl_WorkGroupID), faces / ACTIVE_BRICK_SIZE)] = brick_active;
+    }
+}
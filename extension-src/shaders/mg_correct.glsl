@@ -0,0 +1,141 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
+
+layout(set = 2, binding = 0, std430) buffer PressureData {
+    FIELD_TYPE pressure[];
+} pressure_data;
+
+layout(set = 3, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+layout(set = 4, binding = 0, std430) buffer readonly CoarsePhiData {
+    float phi[];
+} coarse_phi;
+layout(set = 4, binding = 1, std430) buffer readonly CoarseRhsData {
+    float rhs[];
+} coarse_rhs;
+layout(set = 4, binding = 2, std430) buffer readonly CoarseSolidData {
+    float is_fluid[];
+} coarse_solid;
+layout(set = 4, binding = 3) uniform CoarseGridParameter {
+    ivec3 faces;
+    float cell_size;
+} coarse_parameters;
+
+layout(push_constant, std430) uniform Params {
+    float delta_time;
+} pc;
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
+}
+
+float sampleCoarse(ivec3 ijk) {
+    ivec3 faces = coarse_parameters.faces;
+    vec3 x = clamp((vec3(ijk) + 0.5) * 0.5 - 0.5, vec3(0.0), vec3(faces - ivec3(1)));
+    ivec3 base = min(ivec3(floor(x)), faces - ivec3(2));
+    vec3 t = x - vec3(base);
+
+    float c000 = coarse_phi.phi[linearIndex(base + ivec3(0, 0, 0), faces)];
+    float c100 = coarse_phi.phi[linearIndex(base + ivec3(1, 0, 0), faces)];
+    float c010 = coarse_phi.phi[linearIndex(base + ivec3(0, 1, 0), faces)];
+    float c110 = coarse_phi.phi[linearIndex(base + ivec3(1, 1, 0), faces)];
+    float c001 = coarse_phi.phi[linearIndex(base + ivec3(0, 0, 1), faces)];
+    float c101 = coarse_phi.phi[linearIndex(base + ivec3(1, 0, 1), faces)];
+    float c011 = coarse_phi.phi[linearIndex(base + ivec3(0, 1, 1), faces)];
+    float c111 = coarse_phi.phi[linearIndex(base + ivec3(1, 1, 1), faces)];
+
+    return mix(
+        mix(mix(c000, c100, t.x), mix(c010, c110, t.x), t.y),
+        mix(mix(c001, c101, t.x), mix(c011, c111, t.x), t.y),
+        t.z
+    );
+}
+
+// Correction on the fine grid, zero on the border cells which the red-black kernel never relaxes.
+float finePhi(ivec3 ijk) {
+    ivec3 faces = GRID_FACES;
+
+    if (any(lessThanEqual(ijk, ivec3(0))) || any(greaterThanEqual(ijk, faces - ivec3(1)))) {
+        return 0.0;
+    }
+
+    return sampleCoarse(ijk);
+}
+
+// Applies the coarse grid correction as face velocity updates with the weights solve_incompressibility.glsl gives
+// its per-cell p. A face (n|c) gets +s_pos(n) * phi_n from the cell below it and -s_neg(c) * phi_c from the cell
+// above, where the flags say whether the cell on the other side is fluid. The positive flag of n is whether c is
+// fluid, so only the mask of c is needed. Cells without a fluid neighbour are never relaxed and get no correction.
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 faces = GRID_FACES;
+
+    if (any(greaterThanEqual(ijk, faces))) {
+        return;
+    }
+
+    int idx = GRID_INDEX(ijk);
+    uint mask = solidMask(idx);
+    float phi_c = (mask & FLUID_NEIGHBOURS) != 0u ? finePhi(ijk) : 0.0;
+    float s_pos = float((mask & FLUID_SELF) >> 6);
+
+    if (ijk.x > 0) {
+        ivec3 n = ijk - ivec3(1, 0, 0);
+        FIELD_STORE(data_u.velocity, idx, FIELD_LOAD(data_u.velocity, idx) + s_pos * finePhi(n) - float(mask & FLUID_NEG_X) * phi_c);
+    }
+    if (ijk.y > 0) {
+        ivec3 n = ijk - ivec3(0, 1, 0);
+        FIELD_STORE(data_v.velocity, idx, FIELD_LOAD(data_v.velocity, idx) + s_pos * finePhi(n) - float((mask & FLUID_NEG_Y) >> 1) * phi_c);
+    }
+    if (ijk.z > 0) {
+        ivec3 n = ijk - ivec3(0, 0, 1);
+        FIELD_STORE(data_w.velocity, idx, FIELD_LOAD(data_w.velocity, idx) + s_pos * finePhi(n) - float((mask & FLUID_NEG_Z) >> 2) * phi_c);
+    }
+
+    FIELD_STORE(pressure_data.pressure, idx, FIELD_LOAD(pressure_data.pressure, idx) + phi_c * DENSITY * GRID_CELL_SIZE / pc.delta_time);
+}
@@ -0,0 +1,68 @@
+#[compute]
+#version 450
+
+#include "field_index.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer PhiData {
+    float phi[];
+} level_phi;
+layout(set = 0, binding = 1, std430) buffer readonly RhsData {
+    float rhs[];
+} level_rhs;
+layout(set = 0, binding = 2, std430) buffer readonly SolidData {
+    float is_fluid[];
+} level_solid;
+layout(set = 0, binding = 3) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+} grid_parameters;
+
+layout(set = 1, binding = 0, std430) buffer readonly CoarsePhiData {
+    float phi[];
+} coarse_phi;
+layout(set = 1, binding = 1, std430) buffer readonly CoarseRhsData {
+    float rhs[];
+} coarse_rhs;
+layout(set = 1, binding = 2, std430) buffer readonly CoarseSolidData {
+    float is_fluid[];
+} coarse_solid;
+layout(set = 1, binding = 3) uniform CoarseGridParameter {
+    ivec3 faces;
+    float cell_size;
+} coarse_parameters;
+
+// Trilinear interpolation between cell centres of the coarse grid.
+float sampleCoarse(ivec3 ijk) {
+    ivec3 faces = coarse_parameters.faces;
+    vec3 x = clamp((vec3(ijk) + 0.5) * 0.5 - 0.5, vec3(0.0), vec3(faces - ivec3(1)));
+    ivec3 base = min(ivec3(floor(x)), faces - ivec3(2));
+    vec3 t = x - vec3(base);
+
+    float c000 = coarse_phi.phi[linearIndex(base + ivec3(0, 0, 0), faces)];
+    float c100 = coarse_phi.phi[linearIndex(base + ivec3(1, 0, 0), faces)];
+    float c010 = coarse_phi.phi[linearIndex(base + ivec3(0, 1, 0), faces)];
+    float c110 = coarse_phi.phi[linearIndex(base + ivec3(1, 1, 0), faces)];
+    float c001 = coarse_phi.phi[linearIndex(base + ivec3(0, 0, 1), faces)];
+    float c101 = coarse_phi.phi[linearIndex(base + ivec3(1, 0, 1), faces)];
+    float c011 = coarse_phi.phi[linearIndex(base + ivec3(0, 1, 1), faces)];
+    float c111 = coarse_phi.phi[linearIndex(base + ivec3(1, 1, 1), faces)];
+
+    return mix(
+        mix(mix(c000, c100, t.x), mix(c010, c110, t.x), t.y),
+        mix(mix(c001, c101, t.x), mix(c011, c111, t.x), t.y),
+        t.z
+    );
+}
+
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(lessThanEqual(ijk, ivec3(0))) || any(greaterThanEqual(ijk, faces - ivec3(1)))) {
+        return;
+    }
+
+    level_phi.phi[linearIndex(ijk, faces)] += sampleCoarse(ijk);
+}
@@ -0,0 +1,88 @@
+#[compute]
+#version 450
+
+#include "field_index.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly PhiData {
+    float phi[];
+} level_phi;
+layout(set = 0, binding = 1, std430) buffer readonly RhsData {
+    float rhs[];
+} level_rhs;
+layout(set = 0, binding = 2, std430) buffer readonly SolidData {
+    float is_fluid[];
+} level_solid;
+layout(set = 0, binding = 3) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+} grid_parameters;
+
+layout(set = 1, binding = 0, std430) buffer writeonly CoarsePhiData {
+    float phi[];
+} coarse_phi;
+layout(set = 1, binding = 1, std430) buffer writeonly CoarseRhsData {
+    float rhs[];
+} coarse_rhs;
+layout(set = 1, binding = 2, std430) buffer readonly CoarseSolidData {
+    float is_fluid[];
+} coarse_solid;
+layout(set = 1, binding = 3) uniform CoarseGridParameter {
+    ivec3 faces;
+    float cell_size;
+} coarse_parameters;
+
+float residual(ivec3 ijk) {
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(lessThanEqual(ijk, ivec3(0))) || any(greaterThanEqual(ijk, faces - ivec3(1)))) {
+        return 0.0;
+    }
+
+    ivec3 offsets[6] = ivec3[6](
+        ivec3(-1, 0, 0), ivec3(0, -1, 0), ivec3(0, 0, -1),
+        ivec3(1, 0, 0), ivec3(0, 1, 0), ivec3(0, 0, 1)
+    );
+
+    int idx = linearIndex(ijk, faces);
+    float phi_c = level_phi.phi[idx];
+    float a_phi = 0.0;
+    float s_sum = 0.0;
+
+    for (int n = 0; n < 6; n++) {
+        int idx_n = linearIndex(ijk + offsets[n], faces);
+        float s = level_solid.is_fluid[idx_n];
+
+        s_sum += s;
+        a_phi += s * (phi_c - level_phi.phi[idx_n]);
+    }
+
+    if (s_sum == 0.0) {
+        return 0.0;
+    }
+
+    return level_rhs.rhs[idx] - a_phi;
+}
+
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+
+    if (any(greaterThanEqual(ijk, coarse_parameters.faces))) {
+        return;
+    }
+
+    float sum = 0.0;
+
+    for (int k = 0; k < 2; k++) {
+        for (int j = 0; j < 2; j++) {
+            for (int i = 0; i < 2; i++) {
+                sum += residual(2 * ijk + ivec3(i, j, k));
+            }
+        }
+    }
+
+    int idx = linearIndex(ijk, coarse_parameters.faces);
+    coarse_rhs.rhs[idx] = 0.5 * sum;
+    coarse_phi.phi[idx] = 0.0;
+}
@@ -0,0 +1,114 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer readonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer readonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
+
+layout(set = 2, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+layout(set = 3, binding = 0, std430) buffer writeonly CoarsePhiData {
+    float phi[];
+} coarse_phi;
+layout(set = 3, binding = 1, std430) buffer writeonly CoarseRhsData {
+    float rhs[];
+} coarse_rhs;
+layout(set = 3, binding = 2, std430) buffer readonly CoarseSolidData {
+    float is_fluid[];
+} coarse_solid;
+layout(set = 3, binding = 3) uniform CoarseGridParameter {
+    ivec3 faces;
+    float cell_size;
+} coarse_parameters;
+
+int toIndex(ivec3 ijk) {
+    return wrappedIndex(ijk, grid_parameters.wrap, grid_parameters.faces);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
+}
+
+// The residual of the velocity form is the negative divergence, see mg_smooth.glsl for the operator.
+float residual(ivec3 ijk) {
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(lessThanEqual(ijk, ivec3(0))) || any(greaterThanEqual(ijk, faces - ivec3(1)))) {
+        return 0.0;
+    }
+
+    int idx = toIndex(ijk);
+
+    if ((solidMask(idx) & FLUID_NEIGHBOURS) == 0u) {
+        return 0.0;
+    }
+
+    float d = FIELD_LOAD(data_u.velocity, toIndex(ijk + ivec3(1, 0, 0))) - FIELD_LOAD(data_u.velocity, idx) +
+              FIELD_LOAD(data_v.velocity, toIndex(ijk + ivec3(0, 1, 0))) - FIELD_LOAD(data_v.velocity, idx) +
+              FIELD_LOAD(data_w.velocity, toIndex(ijk + ivec3(0, 0, 1))) - FIELD_LOAD(data_w.velocity, idx);
+
+    return -d;
+}
+
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+
+    if (any(greaterThanEqual(ijk, coarse_parameters.faces))) {
+        return;
+    }
+
+    float sum = 0.0;
+
+    for (int k = 0; k < 2; k++) {
+        for (int j = 0; j < 2; j++) {
+            for (int i = 0; i < 2; i++) {
+                sum += residual(2 * ijk + ivec3(i, j, k));
+            }
+        }
+    }
+
+    // The operator on a grid with twice the spacing is four times as strong, times the average of 8 children.
+    int idx = linearIndex(ijk, coarse_parameters.faces);
+    coarse_rhs.rhs[idx] = 0.5 * sum;
+    coarse_phi.phi[idx] = 0.0;
+}
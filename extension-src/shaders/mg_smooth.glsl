@@ -0,0 +1,68 @@
+#[compute]
+#version 450
+
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8,
+       local_size_x_id = 6, local_size_y_id = 7, local_size_z_id = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer PhiData {
+    float phi[];
+} level_phi;
+layout(set = 0, binding = 1, std430) buffer readonly RhsData {
+    float rhs[];
+} level_rhs;
+layout(set = 0, binding = 2, std430) buffer readonly SolidData {
+    float is_fluid[];
+} level_solid;
+layout(set = 0, binding = 3) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+} grid_parameters;
+
+layout(push_constant, std430) uniform Params {
+    int iteration;
+} pc;
+
+// Red-black Gauss-Seidel on sum_n s_n * (phi_c - phi_n) = rhs_c. This is the pressure form of the update
+// solve_incompressibility.glsl applies to the face velocities, with the same cell coloring. Border cells stay
+// at zero like the untouched border cells of the fine grid.
+void processCell(ivec3 ijk) {
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(lessThanEqual(ijk, ivec3(0))) || any(greaterThanEqual(ijk, faces - ivec3(1)))) {
+        return;
+    }
+
+    if (((ijk.x + ijk.y + ijk.z) & 1) != (pc.iteration & 1)) {
+        return;
+    }
+
+    ivec3 offsets[6] = ivec3[6](
+        ivec3(-1, 0, 0), ivec3(0, -1, 0), ivec3(0, 0, -1),
+        ivec3(1, 0, 0), ivec3(0, 1, 0), ivec3(0, 0, 1)
+    );
+
+    float s_sum = 0.0;
+    float phi_sum = 0.0;
+
+    for (int n = 0; n < 6; n++) {
+        int idx_n = linearIndex(ijk + offsets[n], grid_parameters.faces);
+        float s = level_solid.is_fluid[idx_n];
+
+        s_sum += s;
+        phi_sum += s * level_phi.phi[idx_n];
+    }
+
+    if (s_sum == 0.0) {
+        return;
+    }
+
+    int idx = linearIndex(ijk, grid_parameters.faces);
+    level_phi.phi[idx] = (level_rhs.rhs[idx] + phi_sum) / s_sum;
+}
+
+void main() {
+    processCell(ivec3(gl_GlobalInvocationID));
+}
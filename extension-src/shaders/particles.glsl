@@ -0,0 +1,66 @@
+#[compute]
+#version 450
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// Must match ForceFieldVisualizer::PARTICLE_TEXTURE_WIDTH.
+const uint PARTICLE_TEXTURE_WIDTH = 1024u;
+
+// One texel per particle: its position in the unit cube of the field in xyz, its age in seconds in w.
+layout(set = 0, binding = 0, rgba32f) uniform restrict image2D particles;
+
+// The output texture of the field, cell-centred velocity in xyz.
+layout(set = 1, binding = 0) uniform sampler3D field;
+
+layout(push_constant, std430) uniform Params {
+    // One over the size of the field in metres, turns a velocity into a speed across the unit cube.
+    vec3 inv_extent;
+    float delta_time;
+    float lifetime;
+    uint count;
+    uint seed;
+    uint padding;
+} pc;
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(inout uint state) {
+    state = hash(state);
+    return float(state >> 8) / 16777216.0;
+}
+
+vec3 velocityAt(vec3 pos) {
+    return texture(field, pos).xyz * pc.inv_extent;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+
+    if (i >= pc.count) {
+        return;
+    }
+
+    ivec2 texel = ivec2(i % PARTICLE_TEXTURE_WIDTH, i / PARTICLE_TEXTURE_WIDTH);
+    vec4 particle = imageLoad(particles, texel);
+
+    // Midpoint steps through the trilinearly filtered texture.
+    vec3 half_step = particle.xyz + 0.5 * pc.delta_time * velocityAt(particle.xyz);
+    particle.xyz += pc.delta_time * velocityAt(half_step);
+    particle.w += pc.delta_time;
+
+    // Particles that age out or leave the field start over somewhere else. The ages were spread over the lifetime
+    // when the pool was created, so they don't all restart in the same frame.
+    if (particle.w >= pc.lifetime || any(lessThan(particle.xyz, vec3(0.0))) || any(greaterThan(particle.xyz, vec3(1.0)))) {
+        uint state = hash(i ^ hash(pc.seed));
+        particle = vec4(random(state), random(state), random(state), 0.0);
+    }
+
+    imageStore(particles, texel, particle);
+}
@@ -0,0 +1,70 @@
+#[compute]
+#version 450
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// count records of stride vec4s each, written by the per-workgroup passes.
+layout(set = 0, binding = 0, std430) buffer readonly PartialData {
+    vec4 values[];
+} partials;
+
+layout(set = 1, binding = 0, std430) buffer ResultData {
+    vec4 values[];
+} results;
+
+// ops holds eight bits per record column, two per component: 0 = max, 1 = sum, 2 = min.
+layout(push_constant, std430) uniform Params {
+    uint ops;
+    int stride;
+    int count;
+    int result_offset;
+} pc;
+
+const float FLOAT_MAX = 3.402823e38;
+
+shared vec4 scratch[256];
+
+float identity(uint op) {
+    return op == 0u ? -FLOAT_MAX : (op == 1u ? 0.0 : FLOAT_MAX);
+}
+
+float combine(uint op, float a, float b) {
+    return op == 0u ? max(a, b) : (op == 1u ? a + b : min(a, b));
+}
+
+vec4 combine(uint ops, vec4 a, vec4 b) {
+    return vec4(
+        combine(ops & 3u, a.x, b.x),
+        combine((ops >> 2) & 3u, a.y, b.y),
+        combine((ops >> 4) & 3u, a.z, b.z),
+        combine((ops >> 6) & 3u, a.w, b.w)
+    );
+}
+
+void main() {
+    uint local = gl_LocalInvocationIndex;
+
+    for (int column = 0; column < pc.stride; ++column) {
+        uint ops = (pc.ops >> (8 * column)) & 0xFFu;
+        vec4 value = vec4(identity(ops & 3u), identity((ops >> 2) & 3u), identity((ops >> 4) & 3u), identity((ops >> 6) & 3u));
+
+        for (int i = int(local); i < pc.count; i += 256) {
+            value = combine(ops, value, partials.values[i * pc.stride + column]);
+        }
+
+        scratch[local] = value;
+        barrier();
+
+        for (uint stride = 128; stride > 0; stride >>= 1) {
+            if (local < stride) {
+                scratch[local] = combine(ops, scratch[local], scratch[local + stride]);
+            }
+            barrier();
+        }
+
+        if (local == 0) {
+            results.values[pc.result_offset + column] = scratch[0];
+        }
+        barrier();
+    }
+}
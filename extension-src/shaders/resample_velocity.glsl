@@ -0,0 +1,152 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+// The velocity of the field before the resize, or of the other grid of a nested pair, see ForceField::parent_field.
+layout(set = 0, binding = 0, std430) buffer readonly SourceUData {
+    FIELD_TYPE velocity[];
+} source_u;
+layout(set = 0, binding = 1, std430) buffer readonly SourceVData {
+    FIELD_TYPE velocity[];
+} source_v;
+layout(set = 0, binding = 2, std430) buffer readonly SourceWData {
+    FIELD_TYPE velocity[];
+} source_w;
+
+layout(set = 1, binding = 0) uniform SourceGridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} source_grid;
+
+layout(set = 2, binding = 0, std430) buffer writeonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 2, binding = 1, std430) buffer writeonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 2, binding = 2, std430) buffer writeonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 3, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+layout(push_constant, std430) uniform Params {
+    // Where the origin of this grid lies in the space of the source grid.
+    vec3 source_origin;
+    // Half the distance between the four samples a face averages across its area, zero for one sample.
+    float footprint;
+    // The box of cells to write.
+    ivec3 origin;
+    // Non-zero writes only the faces of the border cells and the faces between them and the interior.
+    int border_only;
+    ivec3 size;
+} pc;
+
+int toSourceIndex(ivec3 uvw) {
+    return wrappedIndex(uvw, source_grid.wrap, source_grid.faces);
+}
+
+// Trilinear interpolation in the source grid, the same as in sample_velocities.glsl.
+#define MAKE_SAMPLE_FN(DIM, DIM_IDX, SOURCE) float sample_##DIM(vec3 pos) { \
+    vec3 offset = vec3(0.5);\
+    offset[DIM_IDX] = 0.0;\
+\
+    vec3 grid_pos = clamp(pos / source_grid.cell_size - offset, vec3(0.0), vec3(source_grid.faces - ivec3(1)));\
+    ivec3 ijk = min(ivec3(floor(grid_pos)), source_grid.faces - ivec3(2));\
+    vec3 t = grid_pos - vec3(ijk);\
+\
+    float c000 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk));\
+    float c100 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(1, 0, 0)));\
+    float c010 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(0, 1, 0)));\
+    float c110 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(1, 1, 0)));\
+    float c001 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(0, 0, 1)));\
+    float c101 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(1, 0, 1)));\
+    float c011 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(0, 1, 1)));\
+    float c111 = FIELD_LOAD(SOURCE.velocity, toSourceIndex(ijk + ivec3(1, 1, 1)));\
+\
+    float c00 = mix(c000, c100, t.x);\
+    float c10 = mix(c010, c110, t.x);\
+    float c01 = mix(c001, c101, t.x);\
+    float c11 = mix(c011, c111, t.x);\
+\
+    return mix(mix(c00, c10, t.y), mix(c01, c11, t.y), t.z);\
+}
+
+MAKE_SAMPLE_FN(u, 0, source_u)
+MAKE_SAMPLE_FN(v, 1, source_v)
+MAKE_SAMPLE_FN(w, 2, source_w)
+
+float sampleComponent(int axis, vec3 pos) {
+    return axis == 0 ? sample_u(pos) : (axis == 1 ? sample_v(pos) : sample_w(pos));
+}
+
+// A source grid with half the cell size has exactly the four faces at these samples across a face of this grid.
+float sampleFace(int axis, vec3 pos) {
+    if (pc.footprint <= 0.0) {
+        return sampleComponent(axis, pos);
+    }
+
+    vec3 s = vec3(0.0);
+    vec3 t = vec3(0.0);
+    s[(axis + 1) % 3] = pc.footprint;
+    t[(axis + 2) % 3] = pc.footprint;
+
+    return 0.25 * (sampleComponent(axis, pos - s - t) + sampleComponent(axis, pos + s - t) +
+                   sampleComponent(axis, pos - s + t) + sampleComponent(axis, pos + s + t));
+}
+
+// One thread per cell of the box, each of its three lower faces is sampled from the source grid at the face's
+// position. After a resize both grids start at the origin of the field and faces beyond the old grid take the
+// nearest old value.
+void main() {
+    ivec3 local = ivec3(gl_GlobalInvocationID);
+    ivec3 ijk = pc.origin + local;
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(greaterThanEqual(local, pc.size)) || any(greaterThanEqual(ijk, faces))) {
+        return;
+    }
+
+    int idx = wrappedIndex(ijk, grid_parameters.wrap, faces);
+    float h = grid_parameters.cell_size;
+    bool border = any(equal(ijk, ivec3(0))) || any(equal(ijk, faces - ivec3(1)));
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (pc.border_only != 0 && !border && ijk[axis] != 1) {
+            continue;
+        }
+
+        vec3 offset = vec3(0.5);
+        offset[axis] = 0.0;
+
+        float value = sampleFace(axis, pc.source_origin + (vec3(ijk) + offset) * h);
+
+        if (axis == 0) {
+            FIELD_STORE(data_u.velocity, idx, value);
+        } else if (axis == 1) {
+            FIELD_STORE(data_v.velocity, idx, value);
+        } else {
+            FIELD_STORE(data_w.velocity, idx, value);
+        }
+    }
+}
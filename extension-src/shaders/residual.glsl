@@ -0,0 +1,99 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer readonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer readonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
+
+layout(set = 2, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+// One entry per workgroup: x = max |divergence|, y = sum of squared divergence.
+layout(set = 3, binding = 0, std430) buffer writeonly PartialData {
+    vec4 values[];
+} partials;
+
+int toIndex(ivec3 ijk) {
+    return wrappedIndex(ijk, grid_parameters.wrap, grid_parameters.faces);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
+}
+
+shared float max_divergence[512];
+shared float sum_squared[512];
+
+void main() {
+    ivec3 ijk = ivec3(gl_GlobalInvocationID.xyz);
+    ivec3 faces = grid_parameters.faces;
+    float d = 0.0;
+
+    // Same cells and weights the red-black kernel relaxes.
+    if (all(greaterThan(ijk, ivec3(0))) && all(lessThan(ijk, faces - ivec3(1)))) {
+        if ((solidMask(toIndex(ijk)) & FLUID_NEIGHBOURS) != 0u) {
+            int idx = toIndex(ijk);
+
+            d = FIELD_LOAD(data_u.velocity, toIndex(ijk + ivec3(1, 0, 0))) - FIELD_LOAD(data_u.velocity, idx) +
+                FIELD_LOAD(data_v.velocity, toIndex(ijk + ivec3(0, 1, 0))) - FIELD_LOAD(data_v.velocity, idx) +
+                FIELD_LOAD(data_w.velocity, toIndex(ijk + ivec3(0, 0, 1))) - FIELD_LOAD(data_w.velocity, idx);
+        }
+    }
+
+    uint local = gl_LocalInvocationIndex;
+    max_divergence[local] = abs(d);
+    sum_squared[local] = d * d;
+    barrier();
+
+    for (uint stride = 256; stride > 0; stride >>= 1) {
+        if (local < stride) {
+            max_divergence[local] = max(max_divergence[local], max_divergence[local + stride]);
+            sum_squared[local] += sum_squared[local + stride];
+        }
+        barrier();
+    }
+
+    if (local == 0) {
+        uint group = gl_WorkGroupID.x + gl_NumWorkGroups.x * (gl_WorkGroupID.y + gl_NumWorkGroups.y * gl_WorkGroupID.z);
+        partials.values[group] = vec4(max_divergence[0], sum_squared[0], 0.0, 0.0);
+    }
+}
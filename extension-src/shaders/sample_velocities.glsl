@@ -0,0 +1,96 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(set = 0, binding = 0, std430) buffer readonly VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 0, binding = 1, std430) buffer readonly VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 0, binding = 2, std430) buffer readonly VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 1, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+// Query points in the local space of the field, w unused.
+layout(set = 2, binding = 0, std430) buffer readonly QueryPointData {
+    vec4 points[];
+} query_points;
+
+layout(set = 3, binding = 0, std430) buffer writeonly QueryResultData {
+    vec4 velocities[];
+} query_results;
+
+layout(push_constant, std430) uniform Params {
+    uint count;
+} pc;
+
+int toIndex(ivec3 uvw) {
+    return wrappedIndex(uvw, grid_parameters.wrap, grid_parameters.faces);
+}
+
+// Trilinear interpolation between the eight faces around pos. The faces of component DIM_IDX sit on the cell
+// boundary along that axis and at the cell centre along the other two. Points outside the grid take the value
+// at the nearest face.
+#define MAKE_SAMPLE_FN(DIM, DIM_IDX, SOURCE) float sample_##DIM(vec3 pos) { \
+    vec3 offset = vec3(0.5);\
+    offset[DIM_IDX] = 0.0;\
+\
+    vec3 grid_pos = clamp(pos / grid_parameters.cell_size - offset, vec3(0.0), vec3(grid_parameters.faces - ivec3(1)));\
+    ivec3 ijk = min(ivec3(floor(grid_pos)), grid_parameters.faces - ivec3(2));\
+    vec3 t = grid_pos - vec3(ijk);\
+\
+    float c000 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk));\
+    float c100 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(1, 0, 0)));\
+    float c010 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(0, 1, 0)));\
+    float c110 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(1, 1, 0)));\
+    float c001 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(0, 0, 1)));\
+    float c101 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(1, 0, 1)));\
+    float c011 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(0, 1, 1)));\
+    float c111 = FIELD_LOAD(SOURCE.velocity, toIndex(ijk + ivec3(1, 1, 1)));\
+\
+    float c00 = mix(c000, c100, t.x);\
+    float c10 = mix(c010, c110, t.x);\
+    float c01 = mix(c001, c101, t.x);\
+    float c11 = mix(c011, c111, t.x);\
+\
+    return mix(mix(c00, c10, t.y), mix(c01, c11, t.y), t.z);\
+}
+
+MAKE_SAMPLE_FN(u, 0, data_u)
+MAKE_SAMPLE_FN(v, 1, data_v)
+MAKE_SAMPLE_FN(w, 2, data_w)
+
+// One thread per query point.
+void main() {
+    uint idx = gl_GlobalInvocationID.x;
+
+    if (idx >= pc.count) {
+        return;
+    }
+
+    vec3 pos = query_points.points[idx].xyz;
+
+    query_results.velocities[idx] = vec4(sample_u(pos), sample_v(pos), sample_w(pos), 0.0);
+}
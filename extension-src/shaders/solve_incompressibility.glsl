@@ -1,41 +1,142 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+fp32_tiled = "#define SHARED_TILE";
+fp16_tiled = "#define FIELD_FP16\n#define SHARED_TILE";
+fp32_brick4_tiled = "#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE";
+fp16_brick4_tiled = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4\n#define SHARED_TILE";
+fp32_brick8_tiled = "#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE";
+fp16_brick8_tiled = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8\n#define SHARED_TILE";
+
 #[compute]
 #version 450
 
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+#include "specialization.glslinc"
+#include "active_bricks.glslinc"
+
+// The tiled variants run one workgroup per listed brick, the others eight bricks per workgroup. Either way a thread
+// relaxes the cells of one colour in a 2x2x2 block.
+#ifdef SHARED_TILE
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+#else
 layout(local_size_x = 8, local_size_y = 8, local_size_z = 8) in;
+#endif
 
 layout(set = 0, binding = 0, std430) buffer VelocityUData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_u;
 layout(set = 0, binding = 1, std430) buffer VelocityVData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_v;
 layout(set = 0, binding = 2, std430) buffer VelocityWData {
-    float velocity[];
+    FIELD_TYPE velocity[];
 } data_w;
 
-layout(set = 1, binding = 0, std430) buffer readonly SolidData {
-    float is_fluid[];
-} solid_data;
-
-layout(set = 2, binding = 0, std430) buffer writeonly PressureData {
-    float pressure[];
+layout(set = 1, binding = 0, std430) buffer readonly SolidMaskData {
+    uint cells[];
+} solid_mask;
+
+const uint FLUID_NEG_X = 1u;
+const uint FLUID_NEG_Y = 2u;
+const uint FLUID_NEG_Z = 4u;
+const uint FLUID_POS_X = 8u;
+const uint FLUID_POS_Y = 16u;
+const uint FLUID_POS_Z = 32u;
+const uint FLUID_SELF = 64u;
+const uint FLUID_NEIGHBOURS = 63u;
+
+layout(set = 2, binding = 0, std430) buffer PressureData {
+    FIELD_TYPE pressure[];
 } pressure_data;
 
 layout(set = 3, binding = 0) uniform GridParameter {
     ivec3 faces;
     float cell_size;
+    ivec3 wrap;
 } grid_parameters;
 
+layout(set = 4, binding = 0, std430) buffer readonly ActiveBrickData {
+    ACTIVE_BRICK_DATA
+} active_bricks;
+
 layout(push_constant, std430) uniform Params {
     float delta_time;
     int iteration;
 } pc;
 
 int toIndex(ivec3 ijk) {
-    ivec3 items = grid_parameters.faces;
-    return (ijk.z * items.x * items.y) + (ijk.y * items.x) + ijk.x;
+    return GRID_INDEX(ijk);
+}
+
+// Packed by build_solid_mask.glsl, one byte per cell.
+uint solidMask(int idx) {
+    return (solid_mask.cells[idx >> 2] >> (8 * (idx & 3))) & 0xFFu;
 }
 
+#ifdef SHARED_TILE
+
+// The faces of the brick plus the layer above it along each face's own axis, which the cells on the far side of
+// the brick write as well. A colour sweep reads and writes every face through exactly one cell, so the tile holds
+// what the global variant would read and the results match it exactly. The tile is loaded whole with consecutive
+// threads on consecutive faces, and updated faces go straight back to the buffers.
+const int TILE_FACES = (ACTIVE_BRICK_SIZE + 1) * ACTIVE_BRICK_SIZE * ACTIVE_BRICK_SIZE;
+const ivec3 TILE_U_ITEMS = ivec3(ACTIVE_BRICK_SIZE + 1, ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE);
+const ivec3 TILE_V_ITEMS = ivec3(ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE + 1, ACTIVE_BRICK_SIZE);
+const ivec3 TILE_W_ITEMS = ivec3(ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE, ACTIVE_BRICK_SIZE + 1);
+
+shared float tile_u[TILE_FACES];
+shared float tile_v[TILE_FACES];
+shared float tile_w[TILE_FACES];
+
+ivec3 tile_origin;
+
+// Faces past the last one of the grid belong to border cells, which are never relaxed.
+#define MAKE_TILE_LOAD(DIM, SOURCE, ITEMS, T) { \
+    ivec3 uvw = tile_origin + linearCoord(T, ITEMS);\
+    tile_##DIM[T] = all(lessThan(uvw, GRID_FACES)) ? FIELD_LOAD(SOURCE.velocity, toIndex(uvw)) : 0.0;\
+}
+
+// Must be reached by every invocation of the workgroup.
+void loadTile(ivec3 brick_origin) {
+    tile_origin = brick_origin;
+
+    for (int t = int(gl_LocalInvocationIndex); t < TILE_FACES; t += 64) {
+        MAKE_TILE_LOAD(u, data_u, TILE_U_ITEMS, t)
+        MAKE_TILE_LOAD(v, data_v, TILE_V_ITEMS, t)
+        MAKE_TILE_LOAD(w, data_w, TILE_W_ITEMS, t)
+    }
+
+    barrier();
+}
+
+#define MAKE_LOAD_FN(DIM, SOURCE, ITEMS) float load_##DIM(ivec3 uvw, int idx) { \
+    return tile_##DIM[linearIndex(uvw - tile_origin, ITEMS)];\
+}
+
+#else
+
+void loadTile(ivec3 brick_origin) {
+}
+
+#define MAKE_LOAD_FN(DIM, SOURCE, ITEMS) float load_##DIM(ivec3 uvw, int idx) { \
+    return FIELD_LOAD(SOURCE.velocity, idx);\
+}
+
+#endif
+
+MAKE_LOAD_FN(u, data_u, TILE_U_ITEMS)
+MAKE_LOAD_FN(v, data_v, TILE_V_ITEMS)
+MAKE_LOAD_FN(w, data_w, TILE_W_ITEMS)
+
 const ivec3 offsets1[2] = ivec3[2](
     ivec3(0, 0, 0),
     ivec3(1, 0, 0)
@@ -54,10 +155,23 @@ const ivec3 offsets4[2] = ivec3[2](
 );
 
 void main() {
-    float overRelaxation = 1.7;
-    float density = 1000.0;
+#ifdef SHARED_TILE
+    uint slot = gl_WorkGroupID.x;
+#else
+    // Each thread relaxes a 2x2x2 block, so a workgroup covers eight listed bricks with 64 threads each.
+    uint slot = gl_WorkGroupID.x * 8u + gl_LocalInvocationIndex / 64u;
+#endif
+
+    if (slot >= active_bricks.count) {
+        return;
+    }
+
+    ivec3 brick_origin = activeBrickOrigin(active_bricks.bricks[slot], GRID_FACES);
+    loadTile(brick_origin);
 
-	ivec3 ijk_base = 2 * ivec3(gl_GlobalInvocationID.xyz);
+    uint block = gl_LocalInvocationIndex % 64u;
+    ivec3 block_ijk = ivec3(block % 4u, (block / 4u) % 4u, block / 16u);
+	ivec3 ijk_base = brick_origin + 2 * block_ijk;
     ivec3 ijk_starts[4] = { 
         ijk_base + offsets1[pc.iteration],
         ijk_base + offsets2[pc.iteration],
@@ -69,20 +183,21 @@ void main() {
         ivec3 ijk_uvw0 = ijk_starts[i];
 
         if (ijk_uvw0.x == 0 || ijk_uvw0.y == 0 || ijk_uvw0.z == 0 ||
-            ijk_uvw0.x == grid_parameters.faces.x - 1 || ijk_uvw0.y == grid_parameters.faces.y - 1 || ijk_uvw0.z == grid_parameters.faces.z - 1
+            ijk_uvw0.x == GRID_FACES.x - 1 || ijk_uvw0.y == GRID_FACES.y - 1 || ijk_uvw0.z == GRID_FACES.z - 1
         ) {
             continue;
         }
 
+        uint mask = solidMask(toIndex(ijk_uvw0));
         float s[6] = {
-            solid_data.is_fluid[toIndex(ijk_uvw0 - ivec3(1, 0, 0))],
-            solid_data.is_fluid[toIndex(ijk_uvw0 - ivec3(0, 1, 0))],
-            solid_data.is_fluid[toIndex(ijk_uvw0 - ivec3(0, 0, 1))],
-            solid_data.is_fluid[toIndex(ijk_uvw0 + ivec3(1, 0, 0))],
-            solid_data.is_fluid[toIndex(ijk_uvw0 + ivec3(0, 1, 0))],
-            solid_data.is_fluid[toIndex(ijk_uvw0 + ivec3(0, 0, 1))],
+            float(mask & FLUID_NEG_X),
+            float((mask & FLUID_NEG_Y) >> 1),
+            float((mask & FLUID_NEG_Z) >> 2),
+            float((mask & FLUID_POS_X) >> 3),
+            float((mask & FLUID_POS_Y) >> 4),
+            float((mask & FLUID_POS_Z) >> 5),
         };
-        float s_sum = s[0] + s[1] + s[2] + s[3] + s[4] + s[5];
+        float s_sum = float(bitCount(mask & FLUID_NEIGHBOURS));
 
         if (s_sum == 0.0) {
             continue;
@@ -97,23 +212,24 @@ void main() {
         int idx_v1 = toIndex(ijk_v1);
         int idx_w1 = toIndex(ijk_w1);
 
-        float u0 = data_u.velocity[idx_uvw0];
-        float u1 = data_u.velocity[idx_u1];
-        float v0 = data_v.velocity[idx_uvw0];
-        float v1 = data_v.velocity[idx_v1];
-        float w0 = data_w.velocity[idx_uvw0];
-        float w1 = data_w.velocity[idx_w1];
+        float u0 = load_u(ijk_uvw0, idx_uvw0);
+        float u1 = load_u(ijk_u1, idx_u1);
+        float v0 = load_v(ijk_uvw0, idx_uvw0);
+        float v1 = load_v(ijk_v1, idx_v1);
+        float w0 = load_w(ijk_uvw0, idx_uvw0);
+        float w1 = load_w(ijk_w1, idx_w1);
 
         float d = u1 - u0 + v1 - v0 + w1 - w0;
-        float p = (-1.0 / s_sum) * d * overRelaxation;
+        float p = (-1.0 / s_sum) * d * OVER_RELAXATION;
 
-        data_u.velocity[idx_uvw0] = data_u.velocity[idx_uvw0] - s[0] * p;
-        data_u.velocity[idx_u1] = data_u.velocity[idx_u1] + s[3] * p;
-        data_v.velocity[idx_uvw0] = data_v.velocity[idx_uvw0] - s[1] * p;
-        data_v.velocity[idx_v1] = data_v.velocity[idx_v1] + s[4] * p;
-        data_w.velocity[idx_uvw0] = data_w.velocity[idx_uvw0] - s[2] * p;
-        data_w.velocity[idx_w1] = data_w.velocity[idx_w1] + s[5] * p;
+        // No other cell of this colour touches these faces, so the values read above are still current.
+        FIELD_STORE(data_u.velocity, idx_uvw0, u0 - s[0] * p);
+        FIELD_STORE(data_u.velocity, idx_u1, u1 + s[3] * p);
+        FIELD_STORE(data_v.velocity, idx_uvw0, v0 - s[1] * p);
+        FIELD_STORE(data_v.velocity, idx_v1, v1 + s[4] * p);
+        FIELD_STORE(data_w.velocity, idx_uvw0, w0 - s[2] * p);
+        FIELD_STORE(data_w.velocity, idx_w1, w1 + s[5] * p);
 
-        pressure_data.pressure[idx_uvw0] += p * density * grid_parameters.cell_size / pc.delta_time;
+        FIELD_STORE(pressure_data.pressure, idx_uvw0, FIELD_LOAD(pressure_data.pressure, idx_uvw0) + p * DENSITY * GRID_CELL_SIZE / pc.delta_time);
     }
 }
@@ -0,0 +1,192 @@
+#[versions]
+
+fp32 = "";
+fp16 = "#define FIELD_FP16";
+fp32_brick4 = "#define FIELD_BRICK_SIZE 4";
+fp16_brick4 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 4";
+fp32_brick8 = "#define FIELD_BRICK_SIZE 8";
+fp16_brick8 = "#define FIELD_FP16\n#define FIELD_BRICK_SIZE 8";
+
+#[compute]
+#version 450
+
+#VERSION_DEFINES
+
+#include "field_storage.glslinc"
+#include "field_index.glslinc"
+
+layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// The solids the field was created with, obstacles are carved out of a copy of them.
+layout(set = 0, binding = 0, std430) buffer readonly StaticSolidData {
+    float is_fluid[];
+} static_solid;
+
+layout(set = 1, binding = 0, std430) buffer writeonly SolidData {
+    float is_fluid[];
+} solid_data;
+
+layout(set = 2, binding = 0, std430) buffer VelocityUData {
+    FIELD_TYPE velocity[];
+} data_u;
+layout(set = 2, binding = 1, std430) buffer VelocityVData {
+    FIELD_TYPE velocity[];
+} data_v;
+layout(set = 2, binding = 2, std430) buffer VelocityWData {
+    FIELD_TYPE velocity[];
+} data_w;
+
+layout(set = 3, binding = 0) uniform GridParameter {
+    ivec3 faces;
+    float cell_size;
+    ivec3 wrap;
+} grid_parameters;
+
+const uint SHAPE_BOX = 0u;
+const uint SHAPE_SPHERE = 1u;
+const uint SHAPE_CAPSULE = 2u;
+const uint SHAPE_CYLINDER = 3u;
+const uint SHAPE_MESH = 4u;
+
+// Written by ObstacleList::to_bytes() in obstacle_list.h.
+struct Obstacle {
+    vec4 to_shape[3];
+    vec4 previous[3];
+    uvec4 shape;
+    vec4 size;
+    ivec4 cell_min;
+    ivec4 cell_max;
+};
+
+layout(set = 4, binding = 0, std430) buffer readonly ObstacleData {
+    uint count;
+    uint padding[3];
+    Obstacle obstacles[];
+} obstacle_data;
+
+// Three vertices per triangle in the local space of its mesh.
+layout(set = 5, binding = 0, std430) buffer readonly TriangleData {
+    vec4 vertices[];
+} triangle_data;
+
+layout(push_constant, std430) uniform Params {
+    ivec3 origin;
+    float inv_delta_time;
+    ivec3 size;
+} pc;
+
+vec3 transformPoint(vec4 rows[3], vec3 p) {
+    return vec3(dot(rows[0].xyz, p) + rows[0].w, dot(rows[1].xyz, p) + rows[1].w, dot(rows[2].xyz, p) + rows[2].w);
+}
+
+// Whether a ray from p along +x crosses the triangle, Moeller-Trumbore with the direction fixed.
+bool crossesTriangle(vec3 p, vec3 a, vec3 b, vec3 c) {
+    const vec3 dir = vec3(1.0, 0.0, 0.0);
+    vec3 e1 = b - a;
+    vec3 e2 = c - a;
+    vec3 q = cross(dir, e2);
+    float det = dot(e1, q);
+
+    if (abs(det) < 1e-12) {
+        return false;
+    }
+
+    vec3 s = p - a;
+    float u = dot(s, q) / det;
+    vec3 r = cross(s, e1);
+    float v = dot(dir, r) / det;
+    float t = dot(e2, r) / det;
+
+    return u >= 0.0 && v >= 0.0 && u + v <= 1.0 && t > 0.0;
+}
+
+// A closed mesh contains p if a ray from it leaves through an odd number of triangles.
+bool insideMesh(uint first, uint count, vec3 p) {
+    uint crossings = 0u;
+
+    for (uint t = first; t < first + count; ++t) {
+        if (crossesTriangle(p, triangle_data.vertices[3u * t].xyz, triangle_data.vertices[3u * t + 1u].xyz, triangle_data.vertices[3u * t + 2u].xyz)) {
+            ++crossings;
+        }
+    }
+
+    return (crossings & 1u) == 1u;
+}
+
+bool insideShape(uint o, vec3 p) {
+    Obstacle obstacle = obstacle_data.obstacles[o];
+    vec3 size = obstacle.size.xyz;
+
+    switch (obstacle.shape.x) {
+        case SHAPE_BOX:
+            return all(lessThanEqual(abs(p), size));
+        case SHAPE_SPHERE:
+            return length(p) <= size.x;
+        case SHAPE_CAPSULE:
+            return length(vec3(p.x, max(abs(p.y) - (0.5 * size.y - size.x), 0.0), p.z)) <= size.x;
+        case SHAPE_CYLINDER:
+            return length(p.xz) <= size.x && abs(p.y) <= 0.5 * size.y;
+        default:
+            return insideMesh(obstacle.shape.y, obstacle.shape.z, p);
+    }
+}
+
+// Index of the first obstacle containing the centre of the cell, or -1.
+int obstacleAt(ivec3 ijk) {
+    vec3 centre = (vec3(ijk) + 0.5) * grid_parameters.cell_size;
+
+    for (uint o = 0u; o < obstacle_data.count; ++o) {
+        Obstacle obstacle = obstacle_data.obstacles[o];
+
+        if (any(lessThan(ijk, obstacle.cell_min.xyz)) || any(greaterThan(ijk, obstacle.cell_max.xyz))) {
+            continue;
+        }
+
+        if (insideShape(o, transformPoint(obstacle.to_shape, centre))) {
+            return int(o);
+        }
+    }
+
+    return -1;
+}
+
+// Velocity of the obstacle's surface at a point, from where that point of the shape was a frame ago.
+vec3 obstacleVelocity(int o, vec3 p) {
+    Obstacle obstacle = obstacle_data.obstacles[o];
+    vec3 previous = transformPoint(obstacle.previous, transformPoint(obstacle.to_shape, p));
+    return (p - previous) * pc.inv_delta_time;
+}
+
+// One thread per cell of a dirty region: the cell is solid if an obstacle contains its centre, and each of its
+// lower faces that borders an obstacle cell takes the obstacle's velocity, so the pressure solve pushes the fluid
+// around it.
+void main() {
+    ivec3 local = ivec3(gl_GlobalInvocationID);
+    ivec3 ijk = pc.origin + local;
+    ivec3 faces = grid_parameters.faces;
+
+    if (any(greaterThanEqual(local, pc.size)) || any(greaterThanEqual(ijk, faces))) {
+        return;
+    }
+
+    int idx = wrappedIndex(ijk, grid_parameters.wrap, faces);
+    int obstacle = obstacleAt(ijk);
+    float h = grid_parameters.cell_size;
+
+    solid_data.is_fluid[idx] = obstacle >= 0 ? 0.0 : static_solid.is_fluid[idx];
+
+    int face_obstacle = obstacle >= 0 ? obstacle : (ijk.x > 0 ? obstacleAt(ijk - ivec3(1, 0, 0)) : -1);
+    if (face_obstacle >= 0) {
+        FIELD_STORE(data_u.velocity, idx, obstacleVelocity(face_obstacle, vec3(ijk) * h + vec3(0.0, 0.5, 0.5) * h).x);
+    }
+
+    face_obstacle = obstacle >= 0 ? obstacle : (ijk.y > 0 ? obstacleAt(ijk - ivec3(0, 1, 0)) : -1);
+    if (face_obstacle >= 0) {
+        FIELD_STORE(data_v.velocity, idx, obstacleVelocity(face_obstacle, vec3(ijk) * h + vec3(0.5, 0.0, 0.5) * h).y);
+    }
+
+    face_obstacle = obstacle >= 0 ? obstacle : (ijk.z > 0 ? obstacleAt(ijk - ivec3(0, 0, 1)) : -1);
+    if (face_obstacle >= 0) {
+        FIELD_STORE(data_w.velocity, idx, obstacleVelocity(face_obstacle, vec3(ijk) * h + vec3(0.5, 0.5, 0.0) * h).z);
+    }
+}
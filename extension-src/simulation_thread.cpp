@@ -0,0 +1,78 @@
+#include "simulation_thread.h"
+
+using namespace godot;
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start() {
+    if (m_thread.joinable()) {
+        return;
+    }
+
+    m_stop = false;
+    m_thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    m_thread.join();
+}
+
+bool SimulationThread::is_running() const {
+    return m_thread.joinable();
+}
+
+bool SimulationThread::is_idle() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.empty() && !m_busy;
+}
+
+void SimulationThread::push(const Callable& callable) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(callable);
+    }
+    m_condition.notify_all();
+}
+
+void SimulationThread::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle_condition.wait(lock, [this] { return !m_thread.joinable() || (m_queue.empty() && !m_busy); });
+}
+
+void SimulationThread::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+
+        if (m_queue.empty()) {
+            return;
+        }
+
+        const Callable callable = m_queue.front();
+        m_queue.pop_front();
+        m_busy = true;
+
+        lock.unlock();
+        callable.call();
+        lock.lock();
+
+        m_busy = false;
+
+        if (m_queue.empty()) {
+            m_idle_condition.notify_all();
+        }
+    }
+}
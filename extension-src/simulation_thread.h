@@ -0,0 +1,47 @@
+#pragma once
+
+#include <godot_cpp/variant/callable.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace godot {
+
+// A thread that runs queued callables one after another, in the order they were pushed. Stands in for the render
+// thread of a field whose simulation runs on a local rendering device, so its steps never wait for scene rendering
+// or the other way round.
+class SimulationThread {
+public:
+    SimulationThread() = default;
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    // Runs what is still queued, then joins the thread.
+    void stop();
+
+    [[nodiscard]] bool is_running() const;
+    // True when nothing is queued or running.
+    [[nodiscard]] bool is_idle() const;
+
+    void push(const Callable& callable);
+    // Blocks until everything pushed so far has run.
+    void wait();
+
+private:
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_idle_condition;
+    std::deque<Callable> m_queue;
+    bool m_busy { false };
+    bool m_stop { false };
+
+    void run();
+};
+
+}
@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace godot;
+
+ThreadPool::ThreadPool(int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // The calling thread always takes slab 0, so only thread_count - 1 workers are spawned.
+    for (int slab = 1; slab < thread_count; ++slab) {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this, slab);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::get_thread_count() const {
+    return static_cast<int>(m_workers.size()) + 1;
+}
+
+void ThreadPool::parallel_for(int begin, int end, const SlabFunction& function) {
+    if (end <= begin) {
+        return;
+    }
+
+    if (m_workers.empty() || end - begin == 1) {
+        function(begin, end);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &function;
+        m_begin = begin;
+        m_end = end;
+        m_pending = static_cast<int>(m_workers.size());
+        ++m_generation;
+    }
+    m_start_condition.notify_all();
+
+    run_slab(0, begin, end, function);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_condition.wait(lock, [this] { return m_pending == 0; });
+    m_function = nullptr;
+}
+
+void ThreadPool::worker_loop(int slab) {
+    uint64_t generation = 0;
+
+    while (true) {
+        const SlabFunction* function;
+        int begin;
+        int end;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start_condition.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+
+            if (m_stop) {
+                return;
+            }
+
+            generation = m_generation;
+            function = m_function;
+            begin = m_begin;
+            end = m_end;
+        }
+
+        run_slab(slab, begin, end, *function);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_done_condition.notify_one();
+    }
+}
+
+void ThreadPool::run_slab(int slab, int begin, int end, const SlabFunction& function) const {
+    const int64_t count = end - begin;
+    const int64_t slab_count = get_thread_count();
+    const int slab_begin = begin + static_cast<int>(count * slab / slab_count);
+    const int slab_end = begin + static_cast<int>(count * (slab + 1) / slab_count);
+
+    if (slab_begin < slab_end) {
+        function(slab_begin, slab_end);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// Fixed set of worker threads that split an index range into contiguous slabs, one slab per thread.
+// The calling thread processes the first slab itself and returns once every slab is done.
+class ThreadPool {
+public:
+    using SlabFunction = std::function<void(int begin, int end)>;
+
+    explicit ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] int get_thread_count() const;
+
+    void parallel_for(int begin, int end, const SlabFunction& function);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start_condition;
+    std::condition_variable m_done_condition;
+
+    const SlabFunction* m_function { nullptr };
+    int m_begin { 0 };
+    int m_end { 0 };
+    int m_pending { 0 };
+    uint64_t m_generation { 0 };
+    bool m_stop { false };
+
+    void worker_loop(int slab);
+    void run_slab(int slab, int begin, int end, const SlabFunction& function) const;
+};
+
+}
@@ -0,0 +1,77 @@
+extends SceneTree
+
+# Shared driver for the benchmark scripts in this directory. Run without user arguments a script calls run(), which
+# measures each configuration in its own process through run_configuration(). ForceField keeps its device buffers
+# for its whole lifetime, so configurations can't share one.
+#
+# A worker process builds a field through configure(), steps it with benchmark mode and pass profiling on and
+# prints the average GPU time of a step and of each pass, in microseconds. run_configuration() returns them as a
+# Dictionary with the step time under "step" and the pass times under the names get_pass_timings() uses.
+
+# Benchmark mode alternates two recording paths and resets its averages every 120 samples of each,
+# so a run stays below that.
+const FRAMES := 200
+const PRESSURE_ITERATIONS := 40
+const RESULT_PREFIX := "result="
+
+func _initialize() -> void:
+	var args := OS.get_cmdline_user_args()
+
+	if args.is_empty():
+		run.call_deferred()
+	else:
+		measure.call_deferred(args)
+
+func run() -> void:
+	quit()
+
+# Sets up the field for the user arguments passed to run_configuration().
+func configure(_field: ForceField, _args: PackedStringArray) -> void:
+	pass
+
+func run_configuration(args: PackedStringArray) -> Dictionary:
+	var output := []
+	var command := PackedStringArray([
+		"--path", ProjectSettings.globalize_path("res://"),
+		"-s", get_script().resource_path,
+		"--",
+	])
+	command.append_array(args)
+
+	OS.execute(OS.get_executable_path(), command, output, true)
+
+	for line in "\n".join(output).split("\n"):
+		if line.begins_with(RESULT_PREFIX):
+			return JSON.parse_string(line.trim_prefix(RESULT_PREFIX))
+
+	push_error("No result for %s" % " ".join(args))
+	return {}
+
+func measure(args: PackedStringArray) -> void:
+	var size := int(args[0])
+	var field := ForceField.new()
+	field.field_size = Vector3i(size, size, size)
+	field.cell_size = 1.0 / size
+	field.emitter_pos_max = Vector3(0.54, 0.54, 0.2)
+	# A tolerance of zero keeps every step at the same iteration count.
+	field.tolerance = 0.0
+	field.max_iterations = PRESSURE_ITERATIONS
+	field.benchmark_mode = true
+	field.pass_profiling = true
+
+	configure(field, args)
+
+	root.add_child(field)
+
+	for frame in FRAMES:
+		await process_frame
+
+	var result := { "step": field.get_benchmark_results()["single_list_gpu_usec"] }
+	var timings: Dictionary = field.get_pass_timings()
+
+	for pass_name in timings:
+		result[pass_name] = timings[pass_name]["avg_usec"]
+
+	print(RESULT_PREFIX, JSON.stringify(result))
+
+	quit()
@@ -0,0 +1,42 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Compares the GPU time per step of the field layouts over a range of grid sizes, along with the pressure and
+# advection passes. The neighbour and advection gathers are what the layouts differ in, so the numbers mostly
+# reflect how well those hit the L2 cache.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/field_layout_benchmark.gd
+
+const SIZES: Array[int] = [64, 128, 192, 256]
+const LAYOUTS := {
+	"linear": ForceField.FIELD_LAYOUT_LINEAR,
+	"brick4": ForceField.FIELD_LAYOUT_BRICK4,
+	"brick8": ForceField.FIELD_LAYOUT_BRICK8,
+}
+
+func run() -> void:
+	print("size\tlayout\tgpu_ms\tpressure_ms\tadvection_ms\tMcells/s\tvs linear")
+
+	for size in SIZES:
+		var linear_usec := 0.0
+
+		for layout_name in LAYOUTS:
+			var result := run_configuration(PackedStringArray([str(size), layout_name]))
+			var usec: float = result.get("step", 0.0)
+
+			if layout_name == "linear":
+				linear_usec = usec
+
+			var cells := float(size * size * size)
+			var throughput := cells / usec if usec > 0.0 else 0.0
+			var speedup := linear_usec / usec if usec > 0.0 else 0.0
+
+			print("%d^3\t%s\t%.3f\t%.3f\t%.3f\t%.1f\t%.2fx" % [
+				size, layout_name, usec / 1000.0, result.get("pressure", 0.0) / 1000.0,
+				result.get("advection", 0.0) / 1000.0, throughput, speedup,
+			])
+
+	quit()
+
+func configure(field: ForceField, args: PackedStringArray) -> void:
+	field.field_layout = LAYOUTS[args[1]]
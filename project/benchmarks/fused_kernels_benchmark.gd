@@ -0,0 +1,48 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Compares a dense step with the separate extrapolation, advection and copy-to-texture passes against the fused
+# advection that replaces them, for each precision over a range of grid sizes. The "passes" columns are the GPU
+# times of those passes, the "MB" columns the traffic get_step_traffic() estimates for them.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/fused_kernels_benchmark.gd
+
+const SIZES: Array[int] = [64, 128, 192, 256]
+const PRECISIONS := {
+	"fp32": ForceField.PRECISION_FP32,
+	"fp16": ForceField.PRECISION_FP16,
+}
+const FUSED_PASSES: Array[String] = ["extrapolation", "advection", "copy_to_texture"]
+
+func run() -> void:
+	print("size\tprecision\tsplit_step_ms\tfused_step_ms\tsplit_passes_ms\tfused_passes_ms\tsplit_MB\tfused_MB")
+
+	for size in SIZES:
+		for precision_name in PRECISIONS:
+			var split_result := run_configuration(PackedStringArray([str(size), precision_name, "split"]))
+			var fused_result := run_configuration(PackedStringArray([str(size), precision_name, "fused"]))
+
+			var field := ForceField.new()
+			field.field_size = Vector3i(size, size, size)
+			field.precision = PRECISIONS[precision_name]
+
+			print("%d^3\t%s\t%.3f\t%.3f\t%.3f\t%.3f\t%.1f\t%.1f" % [size, precision_name,
+				split_result.get("step", 0.0) / 1000.0, fused_result.get("step", 0.0) / 1000.0,
+				sum_passes(split_result) / 1000.0, sum_passes(fused_result) / 1000.0,
+				sum_passes(field.get_step_traffic(false)) / 1e6, sum_passes(field.get_step_traffic(true)) / 1e6])
+
+			field.free()
+
+	quit()
+
+func sum_passes(values: Dictionary) -> float:
+	var total := 0.0
+
+	for pass_name in FUSED_PASSES:
+		total += values.get(pass_name, 0.0)
+
+	return total
+
+func configure(field: ForceField, args: PackedStringArray) -> void:
+	field.precision = PRECISIONS[args[1]]
+	field.fused_kernels = args[2] == "fused"
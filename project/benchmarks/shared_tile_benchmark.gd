@@ -0,0 +1,42 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Compares the GPU time of the advection and pressure passes with and without shared memory tiles, for each field
+# layout over a range of grid sizes. Each kernel is switched on its own, so a row shows what its tiles change.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/shared_tile_benchmark.gd
+
+const SIZES: Array[int] = [64, 128, 192, 256]
+const LAYOUTS := {
+	"linear": ForceField.FIELD_LAYOUT_LINEAR,
+	"brick8": ForceField.FIELD_LAYOUT_BRICK8,
+}
+# Pass name in get_pass_timings() for each kernel that has a tiled variant.
+const KERNELS := {
+	"advection": "advection",
+	"pressure": "pressure",
+}
+
+func run() -> void:
+	print("size\tlayout\tkernel\tglobal_ms\ttiled_ms\tspeedup")
+
+	for size in SIZES:
+		for layout_name in LAYOUTS:
+			for kernel in KERNELS:
+				var global_result := run_configuration(PackedStringArray([str(size), layout_name, kernel, "global"]))
+				var tiled_result := run_configuration(PackedStringArray([str(size), layout_name, kernel, "tiled"]))
+				var global_usec: float = global_result.get(KERNELS[kernel], 0.0)
+				var tiled_usec: float = tiled_result.get(KERNELS[kernel], 0.0)
+				var speedup := global_usec / tiled_usec if tiled_usec > 0.0 else 0.0
+
+				print("%d^3\t%s\t%s\t%.3f\t%.3f\t%.2fx" % [size, layout_name, kernel, global_usec / 1000.0, tiled_usec / 1000.0, speedup])
+
+	quit()
+
+func configure(field: ForceField, args: PackedStringArray) -> void:
+	field.field_layout = LAYOUTS[args[1]]
+
+	if args[2] == "advection":
+		field.advection_shared_tiles = args[3] == "tiled"
+	else:
+		field.pressure_shared_tiles = args[3] == "tiled"
@@ -0,0 +1,67 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Compares the frame time of a scene with one field simulated on the main rendering device against the same field on
+# a local device, along with how many steps the field took. On the main device the steps are part of every frame.
+# On a local device the frame only uploads the latest finished output, and steps are skipped while the device is
+# still busy.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/simulation_device_benchmark.gd
+
+const SIZES: Array[int] = [64, 128]
+const DEVICES := {
+	"main": ForceField.SIMULATION_DEVICE_MAIN,
+	"local": ForceField.SIMULATION_DEVICE_LOCAL,
+}
+const WARMUP_FRAMES := 30
+const MEASURED_FRAMES := 300
+
+func run() -> void:
+	print("size\tdevice\tframe_ms\tmax_frame_ms\tsteps/frame")
+
+	for size in SIZES:
+		for device_name in DEVICES:
+			var result := run_configuration(PackedStringArray([str(size), device_name]))
+
+			print("%d^3\t%s\t%.3f\t%.3f\t%.2f" % [
+				size, device_name, result.get("frame_usec", 0.0) / 1000.0,
+				result.get("max_frame_usec", 0.0) / 1000.0, result.get("steps_per_frame", 0.0),
+			])
+
+	quit()
+
+func measure(args: PackedStringArray) -> void:
+	var size := int(args[0])
+	var field := ForceField.new()
+	field.field_size = Vector3i(size, size, size)
+	field.cell_size = 1.0 / size
+	field.tolerance = 0.0
+	field.max_iterations = PRESSURE_ITERATIONS
+	field.simulation_device = DEVICES[args[1]]
+
+	root.add_child(field)
+
+	for frame in WARMUP_FRAMES:
+		await RenderingServer.frame_post_draw
+
+	var total_usec := 0
+	var max_usec := 0
+	var steps := 0
+	var last := Time.get_ticks_usec()
+
+	for frame in MEASURED_FRAMES:
+		await RenderingServer.frame_post_draw
+
+		var now := Time.get_ticks_usec()
+		total_usec += now - last
+		max_usec = max(max_usec, now - last)
+		last = now
+		steps += field.last_substep_count
+
+	print(RESULT_PREFIX, JSON.stringify({
+		"frame_usec": float(total_usec) / MEASURED_FRAMES,
+		"max_frame_usec": max_usec,
+		"steps_per_frame": float(steps) / MEASURED_FRAMES,
+	}))
+
+	quit()
@@ -0,0 +1,60 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Measures the time from adding a number of small fields to the scene until every one of them has run its first
+# step, which covers loading and compiling the shaders, creating the pipelines and buffers and recording the step.
+# Shaders and pipelines come from the shared cache, so only the first field of a process compiles them. The
+# "compiled" and "hits" columns are the cache counters after all fields started.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/startup_benchmark.gd
+
+const COUNTS: Array[int] = [1, 5, 10, 20, 40]
+const FIELD_SIZE := 32
+
+func run() -> void:
+	print("fields\ttotal_ms\tper_field_ms\tcompiled\thits")
+
+	for count in COUNTS:
+		var result := run_configuration(PackedStringArray([str(count)]))
+		var usec: float = result.get("usec", 0.0)
+
+		print("%d\t%.2f\t%.2f\t%d\t%d" % [count, usec / 1000.0, usec / 1000.0 / count,
+			result.get("compiled", 0), result.get("hits", 0)])
+
+	quit()
+
+func measure(args: PackedStringArray) -> void:
+	var count := int(args[0])
+
+	# Lets the window and the rendering device come up before the clock starts.
+	await process_frame
+	await RenderingServer.frame_post_draw
+
+	var start := Time.get_ticks_usec()
+	var fields: Array[ForceField] = []
+	var stepped: Array[bool] = []
+
+	for i in count:
+		var field := ForceField.new()
+		field.field_size = Vector3i(FIELD_SIZE, FIELD_SIZE, FIELD_SIZE)
+		field.cell_size = 1.0 / FIELD_SIZE
+		root.add_child(field)
+
+		fields.append(field)
+		stepped.append(false)
+
+	# A field queues its first step once its compute setup is done, the frame after has run it.
+	while stepped.has(false):
+		await process_frame
+
+		for i in count:
+			stepped[i] = stepped[i] or fields[i].last_substep_count > 0
+
+	await RenderingServer.frame_post_draw
+
+	var usec := Time.get_ticks_usec() - start
+	var stats := ForceField.get_shader_cache_stats()
+
+	print(RESULT_PREFIX, JSON.stringify({ "usec": usec, "compiled": stats["compiled"], "hits": stats["hits"] }))
+
+	quit()
@@ -0,0 +1,50 @@
+extends "res://benchmarks/benchmark.gd"
+
+# Sweeps the workgroup_size of a field with the multigrid solver, which covers both tiled kernels: the smoother of
+# the pressure pass and the copy to the output texture. The best shape differs between GPUs, run this on the one
+# you ship on and set the fastest on the field.
+#
+# Run with a rendering driver, not headless:
+#   godot --path project -s res://benchmarks/workgroup_size_benchmark.gd
+
+const SIZE := 128
+const SHAPES: Array[Vector3i] = [
+	Vector3i(4, 4, 4),
+	Vector3i(8, 8, 1),
+	Vector3i(16, 4, 1),
+	Vector3i(8, 8, 2),
+	Vector3i(8, 4, 4),
+	Vector3i(8, 8, 8),
+	Vector3i(16, 16, 1),
+	Vector3i(16, 4, 4),
+]
+
+func run() -> void:
+	print("workgroup\tgpu_ms\tpressure_ms\tcopy_ms\tvs 8x8x8")
+
+	var results := []
+	var reference_usec := 0.0
+
+	for shape in SHAPES:
+		var result := run_configuration(PackedStringArray([str(SIZE), str(shape.x), str(shape.y), str(shape.z)]))
+		results.append(result)
+
+		if shape == Vector3i(8, 8, 8):
+			reference_usec = result.get("step", 0.0)
+
+	for i in SHAPES.size():
+		var shape := SHAPES[i]
+		var result: Dictionary = results[i]
+		var usec: float = result.get("step", 0.0)
+		var speedup := reference_usec / usec if usec > 0.0 else 0.0
+
+		print("%dx%dx%d\t%.3f\t%.3f\t%.3f\t%.2fx" % [
+			shape.x, shape.y, shape.z, usec / 1000.0, result.get("pressure", 0.0) / 1000.0,
+			result.get("copy_to_texture", 0.0) / 1000.0, speedup,
+		])
+
+	quit()
+
+func configure(field: ForceField, args: PackedStringArray) -> void:
+	field.pressure_solver = ForceField.PRESSURE_SOLVER_MULTIGRID
+	field.workgroup_size = Vector3i(int(args[1]), int(args[2]), int(args[3]))